@@ -0,0 +1,30 @@
+##
+# Writes OUTPUT, a header defining HALIDE_BUILD_ID as the commit of
+# SOURCE_DIR being built, if known. This runs on every build, so the id
+# follows the checkout rather than the last configure. The header is
+# only rewritten when the id changes, so that an unchanged id doesn't
+# cause a rebuild.
+##
+
+set(BUILD_ID "")
+find_package(Git QUIET)
+if (GIT_FOUND)
+    execute_process(COMMAND "${GIT_EXECUTABLE}" rev-parse HEAD
+                    WORKING_DIRECTORY "${SOURCE_DIR}"
+                    OUTPUT_VARIABLE BUILD_ID
+                    OUTPUT_STRIP_TRAILING_WHITESPACE
+                    ERROR_QUIET)
+endif ()
+
+set(CONTENT "// Generated by WriteBuildId.cmake\n")
+if (BUILD_ID)
+    string(APPEND CONTENT "#define HALIDE_BUILD_ID ${BUILD_ID}\n")
+endif ()
+
+set(OLD_CONTENT "")
+if (EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" OLD_CONTENT)
+endif ()
+if (NOT OLD_CONTENT STREQUAL CONTENT)
+    file(WRITE "${OUTPUT}" "${CONTENT}")
+endif ()
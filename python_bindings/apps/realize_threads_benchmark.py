@@ -0,0 +1,66 @@
+import threading
+import time
+
+import halide as hl
+import numpy as np
+
+# Measure how the throughput of realizing one pipeline scales with the
+# number of Python threads calling realize. The bindings release the
+# GIL while Halide runs a pipeline, so the threads should overlap.
+
+
+def get_pipeline():
+    x, y = hl.Var("x"), hl.Var("y")
+    inp = hl.ImageParam(hl.Float(32), 2, "inp")
+    f = hl.Func("f")
+    f[x, y] = inp[x, y]
+    for i in range(8):
+        g = hl.Func("g%d" % i)
+        g[x, y] = hl.sqrt(f[x, y] * f[x, y] + 1.0) * 0.5
+        f = g
+    # Run each realization on a single thread, so that any speedup
+    # comes from the Python threads.
+    f.vectorize(x, 8)
+    return inp, hl.Pipeline(f)
+
+
+def realizations_per_second(pipeline, width, height, num_threads, iterations):
+    outputs = [hl.Buffer(hl.Float(32), [width, height]) for _ in range(num_threads)]
+
+    def worker(i):
+        for _ in range(iterations):
+            pipeline.realize(outputs[i])
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(num_threads)]
+    start = time.perf_counter()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.perf_counter() - start
+    return num_threads * iterations / elapsed
+
+
+def main():
+    inp, pipeline = get_pipeline()
+
+    data = np.random.random((256, 512)).astype(np.float32)
+    input_buffer = hl.Buffer(data)
+    inp.set(input_buffer)
+
+    # Compile up front so that only realization is timed.
+    pipeline.compile_jit()
+    width, height = input_buffer.width(), input_buffer.height()
+    pipeline.realize([width, height])
+
+    iterations = 50
+    serial = realizations_per_second(pipeline, width, height, 1, iterations)
+    print("1 thread:  %8.1f realizations/s" % serial)
+    for num_threads in [2, 4, 8]:
+        throughput = realizations_per_second(pipeline, width, height, num_threads, iterations)
+        print("%d threads: %8.1f realizations/s (%.2fx)" %
+              (num_threads, throughput, throughput / serial))
+
+
+if __name__ == "__main__":
+    main()
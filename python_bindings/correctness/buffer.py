@@ -258,6 +258,49 @@ def test_buffer_to_str():
     b = hl.Buffer(hl.Int(32), [128, 256])
     assert str(b) == '<halide.Buffer of type int32 shape:[[0,128,1],[0,256,128]]>'
 
+def test_dlpack():
+    if not hasattr(np, "from_dlpack"):
+        print("skipping test_dlpack() (numpy is too old)")
+        return
+
+    # ndarray -> Buffer shares storage, and keeps the ndarray's layout.
+    a0 = np.arange(200 * 300, dtype=np.int32).reshape((200, 300))
+    b0 = hl.Buffer.from_dlpack(a0)
+    assert b0.type() == hl.Int(32)
+    assert b0.dim(0).extent() == 200
+    assert b0.dim(0).stride() == 300
+    assert b0.dim(1).extent() == 300
+    assert b0.dim(1).stride() == 1
+    assert b0[12, 34] == 12 * 300 + 34
+    b0[56, 34] = 12
+    assert a0[56, 34] == 12
+
+    # The Buffer keeps the tensor alive.
+    del a0
+    gc.collect()
+    assert b0[56, 34] == 12
+
+    # Buffer -> ndarray shares storage too, including for crops.
+    buf = hl.Buffer(hl.Float(32), [4, 6])
+    buf.fill(0)
+    assert buf.__dlpack_device__() == (1, 0)
+    cropped = buf.copy()
+    cropped.crop(dimension = 0, min = 1, extent = 2)
+    cropped_shared = np.from_dlpack(cropped)
+    assert cropped_shared.shape == (2, 6)
+    assert cropped_shared.dtype == np.float32
+    cropped[1, 2] = 42
+    assert cropped_shared[0, 2] == 42
+
+    # Round trip, through a non-contiguous view.
+    a1 = np.zeros((8, 10), dtype=np.uint8)[::2, 1:]
+    b1 = hl.Buffer.from_dlpack(a1)
+    assert b1.dim(0).extent() == 4
+    assert b1.dim(0).stride() == 20
+    a2 = np.from_dlpack(b1)
+    a2[3, 4] = 7
+    assert a1[3, 4] == 7
+
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
@@ -271,3 +314,4 @@ if __name__ == "__main__":
     test_reorder()
     test_overflow()
     test_buffer_to_str()
+    test_dlpack()
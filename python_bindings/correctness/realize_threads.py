@@ -0,0 +1,67 @@
+import threading
+
+import halide as hl
+import numpy as np
+
+# Realize the same pipeline from several Python threads at once. The
+# bindings release the GIL while Halide is compiling or running a
+# pipeline, so the threads run concurrently; each must still get the
+# right answer.
+
+def make_pipeline():
+    x, y = hl.Var("x"), hl.Var("y")
+    inp = hl.ImageParam(hl.Float(32), 2, "inp")
+    f = hl.Func("f")
+    f[x, y] = inp[x, y]
+    for i in range(8):
+        g = hl.Func("g%d" % i)
+        g[x, y] = hl.sqrt(f[x, y] * f[x, y] + 1.0) * 0.5
+        f = g
+    f.vectorize(x, 8)
+    return inp, hl.Pipeline(f)
+
+
+def run(pipeline, input_buffer, num_threads, iterations):
+    outputs = [hl.Buffer(hl.Float(32), [input_buffer.width(), input_buffer.height()])
+               for _ in range(num_threads)]
+
+    def worker(i):
+        for _ in range(iterations):
+            pipeline.realize(outputs[i])
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(num_threads)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return outputs
+
+
+def test_realize_threads():
+    inp, pipeline = make_pipeline()
+
+    data = np.random.random((256, 512)).astype(np.float32)
+    input_buffer = hl.Buffer(data)
+    inp.set(input_buffer)
+
+    pipeline.compile_jit()
+    expected = np.array(pipeline.realize([input_buffer.width(), input_buffer.height()]))
+
+    for out in run(pipeline, input_buffer, 4, 10):
+        assert np.allclose(np.array(out), expected)
+
+
+def test_compile_threads():
+    # Compiling doesn't hold the GIL either, so several threads can
+    # compile distinct pipelines at once.
+    pipelines = [make_pipeline()[1] for _ in range(4)]
+    threads = [threading.Thread(target=p.compile_jit) for p in pipelines]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+
+if __name__ == "__main__":
+    test_realize_threads()
+    test_compile_threads()
@@ -1,5 +1,7 @@
 #include "PyBuffer.h"
 
+#include <climits>
+#include <memory>
 #include <utility>
 
 #include "PyFunc.h"
@@ -230,12 +232,246 @@ py::object buffer_setitem_operator(Buffer<> &buf, const std::vector<int> &pos, c
     return py::object();
 }
 
+// The parts of the DLPack ABI (https://github.com/dmlc/dlpack) that we
+// need. The ABI is stable, so we declare it here rather than depending
+// on dlpack.h.
+namespace dlpack {
+
+enum DeviceType : int32_t {
+    kDLCPU = 1,
+    kDLCUDA = 2,
+    kDLCUDAHost = 3,
+    kDLCUDAManaged = 13,
+};
+
+enum DataTypeCode : uint8_t {
+    kDLInt = 0,
+    kDLUInt = 1,
+    kDLFloat = 2,
+    kDLBool = 6,
+};
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+}  // namespace dlpack
+
+dlpack::DLDataType type_to_dlpack(const Type &type) {
+    // Only the types the rest of the bindings understand.
+    type_to_format_descriptor(type);
+    if (type.is_bool()) {
+        return {dlpack::kDLBool, 8, 1};
+    }
+    const uint8_t code = type.is_float() ? dlpack::kDLFloat : type.is_uint() ? dlpack::kDLUInt : dlpack::kDLInt;
+    return {code, (uint8_t)type.bits(), 1};
+}
+
+Type dlpack_to_type(const dlpack::DLDataType &dtype) {
+    if (dtype.lanes != 1) {
+        throw py::value_error("Vector DLPack types are not supported.");
+    }
+    Type type;
+    switch (dtype.code) {
+    case dlpack::kDLInt:
+        type = Int(dtype.bits);
+        break;
+    case dlpack::kDLUInt:
+        type = UInt(dtype.bits);
+        break;
+    case dlpack::kDLFloat:
+        type = Float(dtype.bits);
+        break;
+    case dlpack::kDLBool:
+        if (dtype.bits != 8) {
+            throw py::value_error("Unsupported DLPack type.");
+        }
+        type = Bool();
+        break;
+    default:
+        throw py::value_error("Unsupported DLPack type.");
+    }
+    // Only the types the rest of the bindings understand.
+    type_to_format_descriptor(type);
+    return type;
+}
+
+const halide_device_interface_t *cuda_device_interface() {
+    return get_device_interface_for_device_api(DeviceAPI::CUDA, get_jit_target_from_environment().with_feature(Target::CUDA));
+}
+
+// The ordinal of the CUDA device that owns a device pointer, or of the
+// device the Halide runtime's context is on if device_ptr is zero.
+int32_t cuda_device_ordinal(uint64_t device_ptr) {
+    // Make sure the CUDA runtime is loaded.
+    cuda_device_interface();
+    int ordinal = 0;
+    if (Internal::JITSharedRuntime::cuda_get_device_ordinal(device_ptr, &ordinal) != 0) {
+        throw py::value_error("Could not determine the CUDA device ordinal.");
+    }
+    return ordinal;
+}
+
+// Where a Buffer's current data lives, for the purposes of DLPack. We
+// never copy to make data available, so a Buffer that's dirty on a
+// device must be exported from that device.
+dlpack::DLDevice buffer_dlpack_device(const Buffer<> &b) {
+    const halide_buffer_t *raw = b.raw_buffer();
+    if (raw->host && !b.device_dirty()) {
+        return {dlpack::kDLCPU, 0};
+    }
+    if (raw->device_interface && !b.host_dirty()) {
+        if (raw->device_interface == cuda_device_interface()) {
+            return {dlpack::kDLCUDA, cuda_device_ordinal(raw->device)};
+        }
+        throw py::value_error("Only host and CUDA Buffers can be exported via DLPack; call copy_to_host() first.");
+    }
+    throw py::value_error("Cannot export a Buffer via DLPack unless its data is up to date on the host or on exactly one device.");
+}
+
+// Keeps the exported Buffer alive for as long as the consumer needs it.
+struct DLPackExport {
+    dlpack::DLManagedTensor tensor;
+    py::object owner;
+    std::vector<int64_t> shape, strides;
+};
+
+void delete_dlpack_export(dlpack::DLManagedTensor *self) {
+    // Consumers may call this from any thread.
+    py::gil_scoped_acquire acquire;
+    delete (DLPackExport *)self->manager_ctx;
+}
+
+void dlpack_capsule_destructor(PyObject *capsule) {
+    // A consumer renames the capsule when it takes ownership of the
+    // tensor, so only an unconsumed capsule still owns it.
+    if (PyCapsule_IsValid(capsule, "dltensor")) {
+        auto *tensor = (dlpack::DLManagedTensor *)PyCapsule_GetPointer(capsule, "dltensor");
+        if (tensor->deleter) {
+            tensor->deleter(tensor);
+        }
+    }
+}
+
+py::capsule buffer_to_dlpack(const py::object &self) {
+    Buffer<> &b = self.cast<Buffer<> &>();
+    if (!b.defined()) {
+        throw py::value_error("Cannot export an undefined Buffer via DLPack.");
+    }
+    const dlpack::DLDevice device = buffer_dlpack_device(b);
+
+    std::unique_ptr<DLPackExport> e(new DLPackExport);
+    e->owner = self;
+    for (int i = 0; i < b.dimensions(); i++) {
+        e->shape.push_back(b.raw_buffer()->dim[i].extent);
+        e->strides.push_back(b.raw_buffer()->dim[i].stride);
+    }
+
+    dlpack::DLTensor &t = e->tensor.dl_tensor;
+    if (device.device_type == dlpack::kDLCPU) {
+        t.data = b.data();
+    } else {
+        // Make sure any pending work on the device is done before
+        // the consumer sees the data.
+        if (b.device_sync() != 0) {
+            throw py::value_error("device_sync() failed.");
+        }
+        t.data = (void *)(uintptr_t)b.raw_buffer()->device;
+    }
+    t.device = device;
+    t.ndim = b.dimensions();
+    t.dtype = type_to_dlpack(b.type());
+    t.shape = e->shape.data();
+    t.strides = e->strides.data();
+    t.byte_offset = 0;
+    e->tensor.manager_ctx = e.get();
+    e->tensor.deleter = delete_dlpack_export;
+
+    PyObject *capsule = PyCapsule_New(&e->tensor, "dltensor", dlpack_capsule_destructor);
+    if (!capsule) {
+        throw py::error_already_set();
+    }
+    e.release();
+    return py::reinterpret_steal<py::capsule>(capsule);
+}
+
+Buffer<> dlpack_to_buffer(const dlpack::DLTensor &t) {
+    const Type type = dlpack_to_type(t.dtype);
+
+    // DLPack strides are in elements. A null strides pointer means the
+    // tensor is compact and row-major.
+    std::vector<halide_dimension_t> dims(t.ndim);
+    int64_t compact_stride = 1;
+    for (int i = t.ndim - 1; i >= 0; i--) {
+        const int64_t extent = t.shape[i];
+        const int64_t stride = t.strides ? t.strides[i] : compact_stride;
+        if (extent > INT_MAX || stride > INT_MAX || stride < INT_MIN) {
+            throw py::value_error("Out of range arguments to dlpack_to_buffer.");
+        }
+        dims[i] = halide_dimension_t(0, (int32_t)extent, (int32_t)stride);
+        compact_stride *= extent;
+    }
+
+    char *data = (char *)t.data + t.byte_offset;
+    switch (t.device.device_type) {
+    case dlpack::kDLCPU:
+    case dlpack::kDLCUDAHost:
+    case dlpack::kDLCUDAManaged: {
+        Buffer<> b(type, data, t.ndim, dims.data());
+        // As for py::buffer, assume the host data is newer than any
+        // device copy we might make.
+        b.set_host_dirty();
+        return b;
+    }
+    case dlpack::kDLCUDA: {
+        if (t.device.device_id != cuda_device_ordinal(0)) {
+            throw py::value_error("The DLPack tensor is on a different CUDA device than the one Halide uses (see HL_GPU_DEVICE).");
+        }
+        Buffer<> b(type, nullptr, t.ndim, dims.data());
+        if (b.device_wrap_native(DeviceAPI::CUDA, (uint64_t)(uintptr_t)data,
+                                 get_jit_target_from_environment().with_feature(Target::CUDA)) != 0) {
+            throw py::value_error("device_wrap_native() failed.");
+        }
+        b.set_device_dirty();
+        return b;
+    }
+    default:
+        throw py::value_error("Only CPU and CUDA DLPack tensors are supported.");
+    }
+}
+
 // Use an alias class so that if we are created via a py::buffer, we can
 // keep the py::buffer_info class alive for the life of the Buffer<>,
 // ensuring the data isn't collected out from under us.
 class PyBuffer : public Buffer<> {
     py::buffer_info info;
 
+    // Likewise for a tensor imported via DLPack.
+    std::shared_ptr<dlpack::DLManagedTensor> dlpack_tensor;
+
     static std::vector<halide_dimension_t> make_dim_vec(const py::buffer_info &info) {
         const Type t = format_descriptor_to_type(info.format);
         std::vector<halide_dimension_t> dims;
@@ -286,9 +522,37 @@ public:
         this->set_host_dirty();
     }
 
+    PyBuffer(const Buffer<> &b, std::shared_ptr<dlpack::DLManagedTensor> tensor)
+        : Buffer<>(b), info(), dlpack_tensor(std::move(tensor)) {
+    }
+
     ~PyBuffer() override = default;
 };
 
+// Wrap an object that supports __dlpack__ (or a DLPack capsule) without copying.
+py::object buffer_from_dlpack(const py::object &obj) {
+    py::object capsule = py::hasattr(obj, "__dlpack__") ? obj.attr("__dlpack__")() : obj;
+    if (!PyCapsule_IsValid(capsule.ptr(), "dltensor")) {
+        throw py::value_error("Expected an object that supports __dlpack__, or an unconsumed DLPack capsule.");
+    }
+    auto *managed = (dlpack::DLManagedTensor *)PyCapsule_GetPointer(capsule.ptr(), "dltensor");
+    // Check the type, shape and device before taking ownership, so that
+    // the producer keeps the tensor if we can't use it.
+    Buffer<> wrapped = dlpack_to_buffer(managed->dl_tensor);
+    // Mark the capsule as consumed; we own the tensor now.
+    if (PyCapsule_SetName(capsule.ptr(), "used_dltensor") != 0) {
+        throw py::error_already_set();
+    }
+    std::shared_ptr<dlpack::DLManagedTensor> tensor(managed, [](dlpack::DLManagedTensor *t) {
+        if (t->deleter) {
+            py::gil_scoped_acquire acquire;
+            t->deleter(t);
+        }
+    });
+    Buffer<> *b = new PyBuffer(wrapped, std::move(tensor));
+    return py::cast(b, py::return_value_policy::take_ownership);
+}
+
 }  // namespace
 
 void define_buffer(py::module &m) {
@@ -329,6 +593,22 @@ void define_buffer(py::module &m) {
                 );
             })
 
+            // DLPack interchange, e.g. with numpy.from_dlpack() or torch.from_dlpack().
+            // Neither direction copies: the exported tensor keeps this Buffer alive,
+            // and an imported Buffer keeps the producer's tensor alive.
+            .def(
+                "__dlpack__", [](const py::object &self, const py::object &stream) -> py::capsule {
+                    // Device data is synchronized before it's exported, so it's
+                    // safe to use on any stream.
+                    return buffer_to_dlpack(self);
+                },
+                py::arg("stream") = py::none())
+            .def("__dlpack_device__", [](const Buffer<> &b) -> py::tuple {
+                const dlpack::DLDevice device = buffer_dlpack_device(b);
+                return py::make_tuple(device.device_type, device.device_id);
+            })
+            .def_static("from_dlpack", &buffer_from_dlpack, py::arg("tensor"))
+
             // This allows us to use any buffer-like python entity to create a Buffer<>
             // (most notably, an ndarray)
             .def(py::init_alias<py::buffer, const std::string &>(), py::arg("buffer"), py::arg("name") = "")
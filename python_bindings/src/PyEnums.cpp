@@ -151,6 +151,8 @@ void define_enums(py::module &m) {
         .value("ARMDotProd", Target::Feature::ARMDotProd)
         .value("LLVMLargeCodeModel", Target::Feature::LLVMLargeCodeModel)
         .value("RVV", Target::Feature::RVV)
+        .value("ProfileLowering", Target::Feature::ProfileLowering)
+        .value("BatchEntryPoint", Target::Feature::BatchEntryPoint)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -9,13 +9,18 @@ void halide_python_error(void *, const char *msg) {
     throw Error(msg);
 }
 
+// Pipelines are compiled and run with the GIL released (and may print
+// from Halide's own threads), so take it back before calling into
+// Python.
 void halide_python_print(void *, const char *msg) {
+    py::gil_scoped_acquire acquire;
     py::print(msg, py::arg("end") = "");
 }
 
 class HalidePythonCompileTimeErrorReporter : public CompileTimeErrorReporter {
 public:
     void warning(const char *msg) override {
+        py::gil_scoped_acquire acquire;
         py::print(msg, py::arg("end") = "");
     }
 
@@ -119,7 +119,7 @@ void define_func(py::module &m) {
                 [](Func &f, Buffer<> buffer, const Target &target) -> void {
                     f.realize(buffer, target);
                 },
-                py::arg("dst"), py::arg("target") = Target())
+                py::call_guard<py::gil_scoped_release>(), py::arg("dst"), py::arg("target") = Target())
 
             // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
             .def(
@@ -127,12 +127,12 @@ void define_func(py::module &m) {
                 [](Func &f, std::vector<Buffer<>> buffers, const Target &t) -> void {
                     f.realize(Realization(buffers), t);
                 },
-                py::arg("dst"), py::arg("target") = Target())
+                py::call_guard<py::gil_scoped_release>(), py::arg("dst"), py::arg("target") = Target())
 
             .def(
                 "realize",
                 [](Func &f, const std::vector<int32_t> &sizes, const Target &target) -> py::object {
-                    return realization_to_object(f.realize(sizes, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(sizes, target); }));
                 },
                 py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target())
 
@@ -142,7 +142,7 @@ void define_func(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(f.realize(std::vector<int32_t>{x_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize(std::vector<int32_t>{x_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("target") = Target())
 
@@ -152,7 +152,7 @@ void define_func(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(f.realize({x_size, y_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize({x_size, y_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target())
 
@@ -162,7 +162,7 @@ void define_func(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(f.realize({x_size, y_size, z_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize({x_size, y_size, z_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target())
 
@@ -172,7 +172,7 @@ void define_func(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(f.realize({x_size, y_size, z_size, w_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return f.realize({x_size, y_size, z_size, w_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target())
 
@@ -211,37 +211,37 @@ void define_func(py::module &m) {
 
             .def("store_in", &Func::store_in, py::arg("memory_type"))
 
-            .def("compile_to", &Func::compile_to, py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+            .def("compile_to", &Func::compile_to, py::call_guard<py::gil_scoped_release>(), py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_bitcode, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_bitcode, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_bitcode, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_bitcode", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_bitcode, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_llvm_assembly, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_llvm_assembly, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_llvm_assembly, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_llvm_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_llvm_assembly, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_object, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_object, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_object, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_object", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_object, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_header", &Func::compile_to_header, py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_header", &Func::compile_to_header, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_assembly, py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
-            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_assembly, py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) & Func::compile_to_assembly, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+            .def("compile_to_assembly", (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) & Func::compile_to_assembly, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_c", &Func::compile_to_c, py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_c", &Func::compile_to_c, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_lowered_stmt", &Func::compile_to_lowered_stmt, py::arg("filename"), py::arg("arguments"), py::arg("fmt") = Text, py::arg("target") = get_target_from_environment())
+            .def("compile_to_lowered_stmt", &Func::compile_to_lowered_stmt, py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fmt") = Text, py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_file", &Func::compile_to_file, py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_file", &Func::compile_to_file, py::call_guard<py::gil_scoped_release>(), py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_static_library", &Func::compile_to_static_library, py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_static_library", &Func::compile_to_static_library, py::call_guard<py::gil_scoped_release>(), py::arg("filename_prefix"), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-            .def("compile_to_multitarget_static_library", &Func::compile_to_multitarget_static_library, py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"))
-            .def("compile_to_multitarget_object_files", &Func::compile_to_multitarget_object_files, py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"), py::arg("suffixes"))
+            .def("compile_to_multitarget_static_library", &Func::compile_to_multitarget_static_library, py::call_guard<py::gil_scoped_release>(), py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"))
+            .def("compile_to_multitarget_object_files", &Func::compile_to_multitarget_object_files, py::call_guard<py::gil_scoped_release>(), py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"), py::arg("suffixes"))
 
             // TODO: useless until Module is defined.
-            .def("compile_to_module", &Func::compile_to_module, py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
+            .def("compile_to_module", &Func::compile_to_module, py::call_guard<py::gil_scoped_release>(), py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-            .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment())
+            .def("compile_jit", &Func::compile_jit, py::call_guard<py::gil_scoped_release>(), py::arg("target") = get_jit_target_from_environment())
 
             .def("has_update_definition", &Func::has_update_definition)
             .def("num_update_definitions", &Func::num_update_definitions)
@@ -285,7 +285,7 @@ void define_func(py::module &m) {
                     // dst could be Buffer<>, vector<Buffer>, or vector<int>
                     try {
                         Buffer<> b = dst.cast<Buffer<>>();
-                        f.infer_input_bounds(b, target);
+                        call_without_gil([&]() { f.infer_input_bounds(b, target); });
                         return;
                     } catch (...) {
                         // fall thru
@@ -293,7 +293,7 @@ void define_func(py::module &m) {
 
                     try {
                         std::vector<Buffer<>> v = dst.cast<std::vector<Buffer<>>>();
-                        f.infer_input_bounds(Realization(v), target);
+                        call_without_gil([&]() { f.infer_input_bounds(Realization(v), target); });
                         return;
                     } catch (...) {
                         // fall thru
@@ -301,7 +301,7 @@ void define_func(py::module &m) {
 
                     try {
                         std::vector<int32_t> v = dst.cast<std::vector<int32_t>>();
-                        f.infer_input_bounds(v, target);
+                        call_without_gil([&]() { f.infer_input_bounds(v, target); });
                         return;
                     } catch (...) {
                         // fall thru
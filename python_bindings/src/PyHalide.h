@@ -34,6 +34,15 @@ std::vector<T> args_to_vector(const py::args &args, size_t start_offset = 0, siz
 
 Expr double_to_expr_check(double v);
 
+// Call f with the GIL released, so that other Python threads can run
+// while Halide compiles or runs a pipeline. f must not touch any
+// Python objects.
+template<typename F>
+auto call_without_gil(F &&f) -> decltype(f()) {
+    py::gil_scoped_release release;
+    return f();
+}
+
 }  // namespace PythonBindings
 }  // namespace Halide
 
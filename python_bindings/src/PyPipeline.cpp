@@ -50,9 +50,9 @@ void define_pipeline(py::module &m) {
             .def("outputs", &Pipeline::outputs)
 
             .def("auto_schedule", (AutoSchedulerResults(Pipeline::*)(const std::string &, const Target &, const MachineParams &)) & Pipeline::auto_schedule,
-                 py::arg("autoscheduler_name"), py::arg("target"), py::arg("machine_params") = MachineParams::generic())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("autoscheduler_name"), py::arg("target"), py::arg("machine_params") = MachineParams::generic())
             .def("auto_schedule", (AutoSchedulerResults(Pipeline::*)(const Target &, const MachineParams &)) & Pipeline::auto_schedule,
-                 py::arg("target"), py::arg("machine_params") = MachineParams::generic())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("target"), py::arg("machine_params") = MachineParams::generic())
 
             .def_static("set_default_autoscheduler_name", &Pipeline::set_default_autoscheduler_name,
                         py::arg("autoscheduler_name"))
@@ -62,54 +62,54 @@ void define_pipeline(py::module &m) {
             .def("print_loop_nest", &Pipeline::print_loop_nest)
 
             .def("compile_to", &Pipeline::compile_to,
-                 py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
 
             .def("compile_to_bitcode", &Pipeline::compile_to_bitcode,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_llvm_assembly", &Pipeline::compile_to_llvm_assembly,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_object", &Pipeline::compile_to_object,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_header", &Pipeline::compile_to_header,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_assembly", &Pipeline::compile_to_assembly,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_c", &Pipeline::compile_to_c,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_file", &Pipeline::compile_to_file,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
             .def("compile_to_static_library", &Pipeline::compile_to_static_library,
-                 py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
 
             .def("compile_to_lowered_stmt", &Pipeline::compile_to_lowered_stmt,
-                 py::arg("filename"), py::arg("arguments"), py::arg("format") = StmtOutputFormat::Text, py::arg("target") = get_target_from_environment())
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename"), py::arg("arguments"), py::arg("format") = StmtOutputFormat::Text, py::arg("target") = get_target_from_environment())
 
             .def("compile_to_multitarget_static_library", &Pipeline::compile_to_multitarget_static_library,
-                 py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"))
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"))
             .def("compile_to_multitarget_object_files", &Pipeline::compile_to_multitarget_object_files,
-                 py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"), py::arg("suffixes"))
+                 py::call_guard<py::gil_scoped_release>(), py::arg("filename_prefix"), py::arg("arguments"), py::arg("targets"), py::arg("suffixes"))
 
             .def("compile_to_module", &Pipeline::compile_to_module,
-                 py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata)
+                 py::call_guard<py::gil_scoped_release>(), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata)
 
-            .def("compile_jit", &Pipeline::compile_jit, py::arg("target") = get_jit_target_from_environment())
+            .def("compile_jit", &Pipeline::compile_jit, py::call_guard<py::gil_scoped_release>(), py::arg("target") = get_jit_target_from_environment())
 
             .def(
                 "realize", [](Pipeline &p, Buffer<> buffer, const Target &target) -> void {
                     p.realize(Realization(buffer), target);
                 },
-                py::arg("dst"), py::arg("target") = Target())
+                py::call_guard<py::gil_scoped_release>(), py::arg("dst"), py::arg("target") = Target())
 
             // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
             .def(
                 "realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t) -> void {
                     p.realize(Realization(buffers), t);
                 },
-                py::arg("dst"), py::arg("target") = Target())
+                py::call_guard<py::gil_scoped_release>(), py::arg("dst"), py::arg("target") = Target())
 
             .def(
                 "realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target) -> py::object {
-                    return realization_to_object(p.realize(std::move(sizes), target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(std::move(sizes), target); }));
                 },
                 py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target())
 
@@ -118,7 +118,7 @@ void define_pipeline(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(p.realize(std::vector<int32_t>{x_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize(std::vector<int32_t>{x_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("target") = Target())
 
@@ -127,7 +127,7 @@ void define_pipeline(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(p.realize({x_size, y_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize({x_size, y_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target())
 
@@ -136,7 +136,7 @@ void define_pipeline(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(p.realize({x_size, y_size, z_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize({x_size, y_size, z_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target())
 
@@ -145,7 +145,7 @@ void define_pipeline(py::module &m) {
                     PyErr_WarnEx(PyExc_DeprecationWarning,
                                  "Call realize() with an explicit list of ints instead.",
                                  1);
-                    return realization_to_object(p.realize({x_size, y_size, z_size, w_size}, target));
+                    return realization_to_object(call_without_gil([&]() { return p.realize({x_size, y_size, z_size, w_size}, target); }));
                 },
                 py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target())
 
@@ -154,7 +154,7 @@ void define_pipeline(py::module &m) {
                     // dst could be Buffer<>, vector<Buffer>, or vector<int>
                     try {
                         Buffer<> b = dst.cast<Buffer<>>();
-                        p.infer_input_bounds(b, target);
+                        call_without_gil([&]() { p.infer_input_bounds(b, target); });
                         return;
                     } catch (...) {
                         // fall thru
@@ -162,7 +162,7 @@ void define_pipeline(py::module &m) {
 
                     try {
                         std::vector<Buffer<>> v = dst.cast<std::vector<Buffer<>>>();
-                        p.infer_input_bounds(Realization(v), target);
+                        call_without_gil([&]() { p.infer_input_bounds(Realization(v), target); });
                         return;
                     } catch (...) {
                         // fall thru
@@ -170,7 +170,7 @@ void define_pipeline(py::module &m) {
 
                     try {
                         std::vector<int32_t> v = dst.cast<std::vector<int32_t>>();
-                        p.infer_input_bounds(v, target);
+                        call_without_gil([&]() { p.infer_input_bounds(v, target); });
                         return;
                     } catch (...) {
                         // fall thru
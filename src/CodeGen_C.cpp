@@ -1616,6 +1616,12 @@ void CodeGen_C::compile(const LoweredFunc &f) {
         // Emit the argv version
         stream << "\nHALIDE_FUNCTION_ATTRS\nint " << simple_name << "_argv(void **args);\n";
 
+        // And the batched version of that, which takes batch_size
+        // argument lists one after another.
+        if (target.has_feature(Target::BatchEntryPoint)) {
+            stream << "\nHALIDE_FUNCTION_ATTRS\nint " << simple_name << "_batch(void **args, int batch_size);\n";
+        }
+
         // And also the metadata.
         stream << "\nHALIDE_FUNCTION_ATTRS\nconst struct halide_filter_metadata_t *" << simple_name << "_metadata();\n";
     }
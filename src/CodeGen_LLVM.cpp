@@ -339,6 +339,7 @@ struct MangledNames {
     string simple_name;
     string extern_name;
     string argv_name;
+    string batch_name;
     string metadata_name;
 };
 
@@ -352,6 +353,7 @@ MangledNames get_mangled_names(const std::string &name,
     names.simple_name = extract_namespaces(name, namespaces);
     names.extern_name = names.simple_name;
     names.argv_name = names.simple_name + "_argv";
+    names.batch_name = names.simple_name + "_batch";
     names.metadata_name = names.simple_name + "_metadata";
 
     if (linkage != LinkageType::Internal &&
@@ -372,6 +374,8 @@ MangledNames get_mangled_names(const std::string &name,
                                                 {halide_handle_cplusplus_type::Pointer, halide_handle_cplusplus_type::Pointer});
         Type void_star_star(Handle(1, &inner_type));
         names.argv_name = cplusplus_function_mangled_name(names.argv_name, namespaces, type_of<int>(), {ExternFuncArgument(make_zero(void_star_star))}, target);
+        names.batch_name = cplusplus_function_mangled_name(names.batch_name, namespaces, type_of<int>(),
+                                                           {ExternFuncArgument(make_zero(void_star_star)), ExternFuncArgument(make_zero(Int(32)))}, target);
         names.metadata_name = cplusplus_function_mangled_name(names.metadata_name, namespaces, type_of<const struct halide_filter_metadata_t *>(), {}, target);
     }
     return names;
@@ -496,6 +500,9 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
         // (useful for calling from JIT and other machine interfaces).
         if (f.linkage == LinkageType::ExternalPlusMetadata) {
             llvm::Function *wrapper = add_argv_wrapper(function, names.argv_name);
+            if (target.has_feature(Target::BatchEntryPoint)) {
+                add_batch_wrapper(wrapper, names.batch_name, f.args);
+            }
             llvm::Function *metadata_getter = embed_metadata_getter(names.metadata_name,
                                                                     names.simple_name, f.args, input.get_metadata_name_map());
 
@@ -939,6 +946,54 @@ llvm::Function *CodeGen_LLVM::add_argv_wrapper(llvm::Function *fn,
     return wrapper_func;
 }
 
+// Make a wrapper that calls an argv wrapper once per argument list in
+// a batch, as the tasks of a single parallel loop. The argument lists
+// are laid out one after another; see halide_do_batch in the runtime.
+llvm::Function *CodeGen_LLVM::add_batch_wrapper(llvm::Function *argv_fn,
+                                                const std::string &name,
+                                                const std::vector<LoweredArgument> &args) {
+    llvm::Type *void_ptr_t = i8_t->getPointerTo();
+    llvm::Type *wrapper_args_t[] = {void_ptr_t->getPointerTo(), i32_t};
+    llvm::FunctionType *wrapper_func_t = llvm::FunctionType::get(i32_t, wrapper_args_t, false);
+    llvm::Function *wrapper_func = llvm::Function::Create(wrapper_func_t, llvm::GlobalValue::ExternalLinkage, name, module.get());
+    llvm::BasicBlock *wrapper_block = llvm::BasicBlock::Create(module->getContext(), "entry", wrapper_func);
+    builder->SetInsertPoint(wrapper_block);
+
+    llvm::Function::arg_iterator wrapper_arg = wrapper_func->arg_begin();
+    llvm::Value *arg_array = iterator_to_pointer(wrapper_arg++);
+    llvm::Value *batch_size = iterator_to_pointer(wrapper_arg);
+
+    // Run the parallel loop with the user context of the first call
+    // in the batch, so that custom thread pools see it.
+    llvm::Value *user_context = ConstantPointerNull::get(i8_t->getPointerTo());
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].name == "__user_context") {
+            llvm::Value *ptr = builder->CreateConstGEP1_32(arg_array, i);
+            ptr = builder->CreateLoad(ptr->getType()->getPointerElementType(), ptr);
+            ptr = builder->CreatePointerCast(ptr, void_ptr_t->getPointerTo());
+            user_context = builder->CreateLoad(void_ptr_t, ptr);
+        }
+    }
+
+    llvm::Function *do_batch = module->getFunction("halide_do_batch");
+    if (!do_batch) {
+        llvm::Type *do_batch_args_t[] = {void_ptr_t, argv_fn->getType(), void_ptr_t->getPointerTo(), i32_t, i32_t};
+        llvm::FunctionType *do_batch_t = llvm::FunctionType::get(i32_t, do_batch_args_t, false);
+        do_batch = llvm::Function::Create(do_batch_t, llvm::GlobalValue::ExternalLinkage, "halide_do_batch", module.get());
+    }
+    llvm::FunctionType *do_batch_t = do_batch->getFunctionType();
+    llvm::Value *do_batch_args[] = {
+        builder->CreatePointerCast(user_context, do_batch_t->getParamType(0)),
+        builder->CreatePointerCast(argv_fn, do_batch_t->getParamType(1)),
+        builder->CreatePointerCast(arg_array, do_batch_t->getParamType(2)),
+        ConstantInt::get(i32_t, args.size()),
+        batch_size};
+    builder->CreateRet(builder->CreateCall(do_batch, do_batch_args));
+
+    internal_assert(!verifyFunction(*wrapper_func, &llvm::errs()));
+    return wrapper_func;
+}
+
 llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_name,
                                                     const std::string &function_name, const std::vector<LoweredArgument> &args,
                                                     const std::map<std::string, std::string> &metadata_name_map) {
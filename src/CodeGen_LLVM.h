@@ -552,6 +552,12 @@ private:
 
     llvm::Function *add_argv_wrapper(llvm::Function *fn, const std::string &name, bool result_in_argv = false);
 
+    /** Add a function that runs the given argv wrapper over a batch of
+     * argument lists with halide_do_batch. Only done for targets with
+     * Target::BatchEntryPoint. */
+    llvm::Function *add_batch_wrapper(llvm::Function *argv_fn, const std::string &name,
+                                      const std::vector<LoweredArgument> &args);
+
     llvm::Value *codegen_dense_vector_load(const Type &type, const std::string &name, const Expr &base,
                                            const Buffer<> &image, const Parameter &param, const ModulusRemainder &alignment,
                                            llvm::Value *vpred = nullptr, bool slice_to_native = true);
@@ -120,6 +120,10 @@ void JSONCompilerLogger::record_compilation_time(Phase phase, double duration) {
     compilation_time[phase] += duration;
 }
 
+void JSONCompilerLogger::record_lowering_pass(const std::string &pass_name, double duration, uint64_t ir_nodes) {
+    lowering_passes.push_back({pass_name, duration, ir_nodes});
+}
+
 void JSONCompilerLogger::obfuscate() {
     {
         std::map<std::string, std::vector<Expr>> n;
@@ -282,6 +286,23 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
         emit_key_value(o, indent, "compilation_time_llvm", compilation_time[Phase::LLVM]);
     }
 
+    if (!lowering_passes.empty()) {
+        // Pass names can repeat, so emit a list rather than an object.
+        std::string spaces_in(indent + 1, ' ');
+        emit_key(o, indent, "lowering_passes");
+        o << "[\n";
+        int commas_to_emit = (int)lowering_passes.size() - 1;
+        for (const auto &it : lowering_passes) {
+            o << spaces_in << "{ \"name\" : ";
+            emit_value(o, it.name);
+            o << ", \"time\" : " << it.duration
+              << ", \"ir_nodes\" : " << it.ir_nodes << " }";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << std::string(indent, ' ') << "]";
+        emit_eol(o);
+    }
+
     if (!matched_simplifier_rules.empty()) {
         emit_object_key_open(o, indent, "matched_simplifier_rules");
 
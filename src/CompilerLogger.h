@@ -15,6 +15,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Expr.h"
 #include "Target.h"
@@ -53,6 +54,15 @@ public:
      */
     virtual void record_compilation_time(Phase phase, double duration) = 0;
 
+    /** Record the wall-clock time (in seconds) spent in a single lowering pass,
+     * and the number of distinct IR nodes in the Stmt it produced. Only called
+     * when lowering is being profiled (see Target::ProfileLowering). Passes that
+     * run more than once are recorded once per run, in the order they ran.
+     * The default implementation ignores them.
+     */
+    virtual void record_lowering_pass(const std::string &pass_name, double duration, uint64_t ir_nodes) {
+    }
+
     /**
      * Emit all the gathered data to the given stream. This may be called multiple times.
      */
@@ -90,6 +100,7 @@ public:
     void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override;
     void record_object_code_size(uint64_t bytes) override;
     void record_compilation_time(Phase phase, double duration) override;
+    void record_lowering_pass(const std::string &pass_name, double duration, uint64_t ir_nodes) override;
 
     std::ostream &emit_to_stream(std::ostream &o) override;
 
@@ -116,6 +127,15 @@ protected:
     // Map of the time take for each phase of compilation.
     std::map<Phase, double> compilation_time;
 
+    struct LoweringPass {
+        std::string name;
+        double duration;
+        uint64_t ir_nodes;
+    };
+
+    // List of the lowering passes run, in order, if lowering is being profiled.
+    std::vector<LoweringPass> lowering_passes;
+
     void obfuscate();
     void emit();
 };
@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 
+#include "IRArena.h"
 #include "IntrusivePtr.h"
 #include "Type.h"
 
@@ -22,7 +23,7 @@ class IRMutator;
 class IRVisitor;
 
 /** All our IR node types get unique IDs for the purposes of RTTI */
-enum class IRNodeType {
+enum class IRNodeType : uint8_t {
     // Exprs, in order of strength. Code in IRMatch.h and the
     // simplifier relies on this order for canonicalization of
     // expressions, so you may need to update those modules if you
@@ -91,6 +92,17 @@ struct IRNode {
     }
     virtual ~IRNode() = default;
 
+    /** IR nodes come from the current thread's IRNodeArena, if it has
+     * one. */
+    // @{
+    static void *operator new(size_t size) {
+        return IRNodeArena::allocate(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+        IRNodeArena::release(ptr, size);
+    }
+    // @}
+
     /** These classes are all managed with intrusive reference
      * counting, so we also track a reference count. It's mutable
      * so that we can do reference counting even through const
@@ -109,8 +121,17 @@ struct IRNode {
      * anyway, so this doesn't increase the memory footprint of an IR node.
      */
     IRNodeType node_type;
+
+    /** Whether this node is the canonical copy of its value in the
+     * Expr interning table. Shares the free bits after node_type. See
+     * IRIntern.h. */
+    bool interned = false;
 };
 
+/** Remove an interned node from the interning table. Called just
+ * before it's deleted. */
+void forget_interned_expr(const IRNode *node);
+
 template<>
 inline RefCount &ref_count<IRNode>(const IRNode *t) noexcept {
     return t->ref_count;
@@ -118,6 +139,9 @@ inline RefCount &ref_count<IRNode>(const IRNode *t) noexcept {
 
 template<>
 inline void destroy<IRNode>(const IRNode *t) {
+    if (t->interned) {
+        forget_interned_expr(t);
+    }
     delete t;
 }
 
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <utility>
 
 #ifdef _MSC_VER
@@ -3076,6 +3077,11 @@ Func::operator ExternFuncArgument() const {
 }
 
 Pipeline Func::pipeline() {
+    // The same Func may be realized or compiled from several threads at
+    // once (e.g. by the Python bindings, which release the GIL while
+    // doing so), so the Pipeline must only be created once. The lock
+    // belongs to the Function, so unrelated Funcs don't contend.
+    std::lock_guard<std::mutex> lock(func.pipeline_mutex());
     if (!pipeline_.defined()) {
         pipeline_ = Pipeline(*this);
     }
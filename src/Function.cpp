@@ -1,6 +1,7 @@
 #include <atomic>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <utility>
 
@@ -159,6 +160,8 @@ struct FunctionContents {
 struct FunctionGroup {
     mutable RefCount ref_count;
     vector<FunctionContents> members;
+    // Shared by the members, which are almost always just one.
+    std::mutex pipeline_mutex;
 };
 
 FunctionContents *FunctionPtr::get() const {
@@ -964,6 +967,10 @@ bool Function::frozen() const {
     return contents->frozen;
 }
 
+std::mutex &Function::pipeline_mutex() const {
+    return contents.group()->pipeline_mutex;
+}
+
 const map<string, FunctionPtr> &Function::wrappers() const {
     return contents->func_schedule.wrappers();
 }
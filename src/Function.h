@@ -5,6 +5,7 @@
  * Defines the internal representation of a halide function and related classes
  */
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -259,6 +260,11 @@ public:
      * add new definitions. */
     bool frozen() const;
 
+    /** A lock that Func holds while it makes the Pipeline for this
+     * Function, so that realizing it from several threads at once
+     * makes the Pipeline only once. */
+    std::mutex &pipeline_mutex() const;
+
     /** Make a new Function with the same lifetime as this one, and
      * return a strong reference to it. Useful to create Functions which
      * have circular references to this one - e.g. the wrappers
@@ -752,6 +752,7 @@ int generate_filter_main_inner(int argc, char **argv, std::ostream &error_output
         "gengen\n"
         "  [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-d 1|0]\n"
         "  [-e EMIT_OPTIONS] [-n FILE_BASE_NAME] [-p PLUGIN_NAME] [-s AUTOSCHEDULER_NAME]\n"
+        "  [-j NUM_THREADS]\n"
         "       target=target-string[,target-string...] [generator_arg=value [...]]\n"
         "\n"
         " -d  Build a module that is suitable for using for gradient descent calculationn\n"
@@ -763,6 +764,10 @@ int generate_filter_main_inner(int argc, char **argv, std::ostream &error_output
         "      schedule, static_library, stmt, stmt_html, compiler_log].\n"
         "     If omitted, default value is [c_header, static_library, registration].\n"
         "\n"
+        " -j  The number of targets to compile concurrently when multiple targets are\n"
+        "     specified. 0 means one per core. Defaults to 1. The outputs are the same\n"
+        "     regardless of this value.\n"
+        "\n"
         " -p  A comma-separated list of shared libraries that will be loaded before the\n"
         "     generator is run. Useful for custom auto-schedulers. The generator must\n"
         "     either be linked against a shared libHalide or compiled with -rdynamic\n"
@@ -783,6 +788,7 @@ int generate_filter_main_inner(int argc, char **argv, std::ostream &error_output
         {"-e", ""},
         {"-f", ""},
         {"-g", ""},
+        {"-j", "1"},
         {"-n", ""},
         {"-o", ""},
         {"-p", ""},
@@ -831,6 +837,17 @@ int generate_filter_main_inner(int argc, char **argv, std::ostream &error_output
     }
     const int build_gradient_module = flags_info["-d"] == "1";
 
+    int num_threads = -1;
+    {
+        std::istringstream iss(flags_info["-j"]);
+        iss >> num_threads;
+        if (iss.fail() || !iss.eof() || num_threads < 0) {
+            error_output << "-j must be a non-negative integer\n";
+            error_output << kUsage;
+            return 1;
+        }
+    }
+
     std::string autoscheduler_name = flags_info["-s"];
     if (!autoscheduler_name.empty()) {
         Pipeline::set_default_autoscheduler_name(autoscheduler_name);
@@ -1030,7 +1047,7 @@ int generate_filter_main_inner(int argc, char **argv, std::ostream &error_output
                 gen->set_generator_param_values(sub_generator_args);
                 return build_gradient_module ? gen->build_gradient_module(name) : gen->build_module(name);
             };
-            compile_multitarget(function_name, output_files, targets, target_strings, module_factory, compiler_logger_factory);
+            compile_multitarget(function_name, output_files, targets, target_strings, module_factory, compiler_logger_factory, num_threads);
         }
     }
 
@@ -0,0 +1,270 @@
+#include "IRArena.h"
+#include "IR.h"
+#include "IREquality.h"
+#include "IROperator.h"
+#include "Util.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace Halide {
+namespace Internal {
+
+// A chunk is a header followed by blocks, each holding one node.
+// Chunks are aligned to their size, so the chunk a block is in can be
+// found from the block's address.
+struct IRNodeArena::Chunk {
+    // One reference per block handed out and not yet freed, plus one
+    // held by the arena while it's active.
+    std::atomic<int> live;
+    uint64_t arena_id;
+};
+
+namespace {
+
+// Nodes get the same alignment operator new would give them, so the
+// chunk header is padded out to that, and blocks (whose sizes are
+// multiples of the granularity) start on that boundary.
+constexpr size_t node_alignment = alignof(std::max_align_t);
+
+constexpr int chunk_bits = 14;
+constexpr size_t chunk_size = (size_t)1 << chunk_bits;
+constexpr size_t chunk_data_start = (sizeof(IRNodeArena::Chunk) + node_alignment - 1) & ~(node_alignment - 1);
+
+// Nodes from the heap have no header, so release() needs another way
+// to tell them from nodes in chunks. This is a two-level bitmap with
+// one bit per chunk-aligned range of the address space, set while the
+// range holds a chunk. Leaves are made on demand and never freed. A
+// chunk outside the mapped part of the address space isn't used.
+constexpr int address_bits = sizeof(void *) == 8 ? 48 : 32;
+constexpr int leaf_bits = address_bits - chunk_bits < 20 ? address_bits - chunk_bits : 20;
+constexpr int root_bits = address_bits - chunk_bits - leaf_bits;
+constexpr size_t leaf_words = ((size_t)1 << leaf_bits) / 64;
+
+std::atomic<std::atomic<uint64_t> *> chunk_map[(size_t)1 << root_bits];
+
+std::atomic<uint64_t> *chunk_map_leaf(uintptr_t chunk_index, bool create) {
+    std::atomic<std::atomic<uint64_t> *> &slot = chunk_map[chunk_index >> leaf_bits];
+    std::atomic<uint64_t> *leaf = slot.load(std::memory_order_acquire);
+    if (!leaf && create) {
+        std::atomic<uint64_t> *fresh = new std::atomic<uint64_t>[leaf_words]();
+        if (slot.compare_exchange_strong(leaf, fresh, std::memory_order_acq_rel)) {
+            leaf = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return leaf;
+}
+
+// Returns false if the chunk is outside the part of the address space
+// the map covers.
+bool map_chunk(IRNodeArena::Chunk *chunk, bool mapped) {
+    const uintptr_t addr = (uintptr_t)chunk;
+    if (addr >> address_bits) {
+        return false;
+    }
+    const uintptr_t chunk_index = addr >> chunk_bits;
+    std::atomic<uint64_t> &word = chunk_map_leaf(chunk_index, true)[(chunk_index & (((uintptr_t)1 << leaf_bits) - 1)) / 64];
+    const uint64_t bit = (uint64_t)1 << (chunk_index % 64);
+    if (mapped) {
+        word.fetch_or(bit, std::memory_order_release);
+    } else {
+        word.fetch_and(~bit, std::memory_order_release);
+    }
+    return true;
+}
+
+bool is_in_chunk(const void *block) {
+    const uintptr_t addr = (uintptr_t)block;
+    if (addr >> address_bits) {
+        return false;
+    }
+    const uintptr_t chunk_index = addr >> chunk_bits;
+    const std::atomic<uint64_t> *leaf = chunk_map_leaf(chunk_index, false);
+    if (!leaf) {
+        return false;
+    }
+    const uint64_t word = leaf[(chunk_index & (((uintptr_t)1 << leaf_bits) - 1)) / 64].load(std::memory_order_acquire);
+    return (word >> (chunk_index % 64)) & 1;
+}
+
+void *allocate_chunk_memory() {
+#ifdef _WIN32
+    return _aligned_malloc(chunk_size, chunk_size);
+#else
+    void *mem = nullptr;
+    return posix_memalign(&mem, chunk_size, chunk_size) == 0 ? mem : nullptr;
+#endif
+}
+
+void free_chunk_memory(void *mem) {
+#ifdef _WIN32
+    _aligned_free(mem);
+#else
+    free(mem);
+#endif
+}
+
+thread_local IRNodeArena *current_arena = nullptr;
+
+std::atomic<uint64_t> next_arena_id{1};
+std::atomic<int> chunk_count{0};
+
+bool arenas_enabled() {
+    static const bool enabled = get_env_variable("HL_IR_ARENA") != "0";
+    return enabled;
+}
+
+IRNodeArena::Chunk *chunk_of_block(void *block) {
+    return (IRNodeArena::Chunk *)((uintptr_t)block & ~(uintptr_t)(chunk_size - 1));
+}
+
+void release_chunk_ref(IRNodeArena::Chunk *chunk) {
+    if (chunk->live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        map_chunk(chunk, false);
+        chunk->~Chunk();
+        free_chunk_memory(chunk);
+        chunk_count--;
+    }
+}
+
+}  // namespace
+
+IRNodeArena::IRNodeArena() {
+    if (current_arena == nullptr && arenas_enabled()) {
+        active = true;
+        id = next_arena_id++;
+        current_arena = this;
+    }
+}
+
+IRNodeArena::~IRNodeArena() {
+    if (!active) {
+        return;
+    }
+    current_arena = nullptr;
+    // Blocks on the free lists still count as live in their chunks.
+    for (void *block : free_lists) {
+        while (block) {
+            void *next = *(void **)block;
+            release_chunk_ref(chunk_of_block(block));
+            block = next;
+        }
+    }
+    for (Chunk *chunk : chunks) {
+        release_chunk_ref(chunk);
+    }
+}
+
+void *IRNodeArena::allocate_from_arena(size_t size_class) {
+    const size_t block_size = (size_class + 1) * size_class_granularity;
+    void *block = free_lists[size_class];
+    if (block) {
+        free_lists[size_class] = *(void **)block;
+        return block;
+    }
+    if (current == nullptr || bump + block_size > chunk_size) {
+        void *mem = allocate_chunk_memory();
+        internal_assert(mem) << "Out of memory allocating an IR arena chunk\n";
+        Chunk *chunk = new (mem) Chunk;
+        if (!map_chunk(chunk, true)) {
+            chunk->~Chunk();
+            free_chunk_memory(mem);
+            return nullptr;
+        }
+        current = chunk;
+        current->live = 1;
+        current->arena_id = id;
+        chunks.push_back(current);
+        chunk_count++;
+        bump = chunk_data_start;
+    }
+    block = (char *)current + bump;
+    bump += block_size;
+    current->live.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+void *IRNodeArena::allocate(size_t size) {
+    static_assert(size_class_granularity % node_alignment == 0,
+                  "Arena size classes must preserve node alignment");
+    const size_t size_class = (size - 1) / size_class_granularity;
+    if (current_arena && size_class < num_size_classes) {
+        if (void *block = current_arena->allocate_from_arena(size_class)) {
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void IRNodeArena::release(void *ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    const size_t size_class = (size - 1) / size_class_granularity;
+    if (size_class >= num_size_classes || !arenas_enabled() || !is_in_chunk(ptr)) {
+        ::operator delete(ptr);
+        return;
+    }
+    Chunk *chunk = chunk_of_block(ptr);
+    if (current_arena && chunk->arena_id == current_arena->id) {
+        // It's from this thread's active arena, so we can recycle it
+        // without synchronization.
+        *(void **)ptr = current_arena->free_lists[size_class];
+        current_arena->free_lists[size_class] = ptr;
+    } else {
+        release_chunk_ref(chunk);
+    }
+}
+
+int IRNodeArena::live_chunks() {
+    return chunk_count;
+}
+
+void ir_arena_test() {
+    const int chunks_before = IRNodeArena::live_chunks();
+    Expr kept, freed_elsewhere;
+    {
+        IRNodeArena arena;
+        IRNodeArena nested;
+        Expr x = Variable::make(Int(32), "x");
+        for (int i = 0; i < 100; i++) {
+            // Lots of short-lived nodes. These should be recycled.
+            Expr e = x;
+            for (int j = 0; j < 100; j++) {
+                e = e * 2 + j;
+            }
+        }
+        if (arenas_enabled()) {
+            internal_assert(IRNodeArena::live_chunks() > chunks_before);
+            internal_assert(IRNodeArena::live_chunks() - chunks_before < 16)
+                << "Freed nodes aren't being reused\n";
+        }
+        kept = x + 17;
+        freed_elsewhere = x * 3;
+    }
+
+    internal_assert(((uintptr_t)kept.get() % node_alignment) == 0)
+        << "Arena nodes are misaligned\n";
+
+    // Nodes outlive the arena, and can be freed on any thread.
+    internal_assert(equal(kept, Variable::make(Int(32), "x") + 17));
+    std::thread t([&]() { freed_elsewhere = Expr(); });
+    t.join();
+    kept = Expr();
+    internal_assert(IRNodeArena::live_chunks() == chunks_before)
+        << "Arena chunks leaked: " << IRNodeArena::live_chunks() - chunks_before << "\n";
+
+    debug(0) << "ir_arena_test passed\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,75 @@
+#ifndef HALIDE_IR_ARENA_H
+#define HALIDE_IR_ARENA_H
+
+/** \file
+ * Defines a scoped, thread-local arena that IR nodes are allocated
+ * from during lowering.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+/** While an IRNodeArena is alive, IR nodes made on the same thread are
+ * carved out of large chunks owned by the arena, and nodes freed on
+ * that thread are recycled through per-size free lists, instead of
+ * each going through the global heap. Lowering makes and frees
+ * millions of short-lived nodes, so this cuts allocator time and
+ * fragmentation.
+ *
+ * Nodes may outlive the arena (e.g. the lowered Stmt that ends up in
+ * the Module), and may be freed on any thread. Each chunk counts its
+ * live nodes, and is returned to the heap once the arena is gone and
+ * the last node in it dies.
+ *
+ * Arenas nest: an arena created while another is active on the same
+ * thread does nothing. Set the environment variable HL_IR_ARENA=0 to
+ * disable them. */
+class IRNodeArena {
+public:
+    IRNodeArena();
+    ~IRNodeArena();
+
+    IRNodeArena(const IRNodeArena &) = delete;
+    IRNodeArena &operator=(const IRNodeArena &) = delete;
+    IRNodeArena(IRNodeArena &&) = delete;
+    IRNodeArena &operator=(IRNodeArena &&) = delete;
+
+    /** Allocate and free memory for an IR node. Uses the current
+     * thread's active arena if there is one, and the heap otherwise. */
+    // @{
+    static void *allocate(size_t size);
+    static void release(void *ptr, size_t size);
+    // @}
+
+    /** The number of chunks currently allocated by all arenas, whether
+     * active or not. For testing. */
+    static int live_chunks();
+
+    struct Chunk;
+
+private:
+    // Sizes are rounded up to a multiple of this, and sizes beyond
+    // the largest class go straight to the heap.
+    static constexpr size_t size_class_granularity = 16;
+    static constexpr size_t num_size_classes = 16;
+
+    bool active = false;
+    uint64_t id = 0;
+    std::vector<Chunk *> chunks;
+    Chunk *current = nullptr;
+    size_t bump = 0;
+    void *free_lists[num_size_classes] = {nullptr};
+
+    void *allocate_from_arena(size_t size_class);
+};
+
+void ir_arena_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,516 @@
+#include "IRIntern.h"
+
+#include "IR.h"
+#include "IREquality.h"
+#include "IROperator.h"
+#include "Util.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// -1 means not yet initialized from the environment.
+std::atomic<int> interning_state{-1};
+
+uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+uint64_t hash_expr(uint64_t h, const Expr &e) {
+    return hash_combine(h, (uint64_t)(uintptr_t)e.get());
+}
+
+uint64_t hash_string(uint64_t h, const std::string &s) {
+    return hash_combine(h, std::hash<std::string>()(s));
+}
+
+// A node's value is determined by its type, its scalar fields, and
+// the identity of its (interned) children, so hashing and comparing
+// nodes only has to look one level deep.
+uint64_t shallow_hash(const BaseExprNode *n) {
+    uint64_t h = (uint64_t)n->node_type;
+    h = hash_combine(h, ((uint64_t)n->type.code() << 32) |
+                            ((uint64_t)n->type.bits() << 16) |
+                            (uint64_t)n->type.lanes());
+    switch (n->node_type) {
+    case IRNodeType::IntImm:
+        return hash_combine(h, (uint64_t)((const IntImm *)n)->value);
+    case IRNodeType::UIntImm:
+        return hash_combine(h, ((const UIntImm *)n)->value);
+    case IRNodeType::FloatImm: {
+        uint64_t bits;
+        memcpy(&bits, &((const FloatImm *)n)->value, sizeof(bits));
+        return hash_combine(h, bits);
+    }
+    case IRNodeType::StringImm:
+        return hash_string(h, ((const StringImm *)n)->value);
+    case IRNodeType::Cast:
+        return hash_expr(h, ((const Cast *)n)->value);
+    case IRNodeType::Variable:
+        return hash_string(h, ((const Variable *)n)->name);
+    case IRNodeType::Add:
+        return hash_expr(hash_expr(h, ((const Add *)n)->a), ((const Add *)n)->b);
+    case IRNodeType::Sub:
+        return hash_expr(hash_expr(h, ((const Sub *)n)->a), ((const Sub *)n)->b);
+    case IRNodeType::Mul:
+        return hash_expr(hash_expr(h, ((const Mul *)n)->a), ((const Mul *)n)->b);
+    case IRNodeType::Div:
+        return hash_expr(hash_expr(h, ((const Div *)n)->a), ((const Div *)n)->b);
+    case IRNodeType::Mod:
+        return hash_expr(hash_expr(h, ((const Mod *)n)->a), ((const Mod *)n)->b);
+    case IRNodeType::Min:
+        return hash_expr(hash_expr(h, ((const Min *)n)->a), ((const Min *)n)->b);
+    case IRNodeType::Max:
+        return hash_expr(hash_expr(h, ((const Max *)n)->a), ((const Max *)n)->b);
+    case IRNodeType::EQ:
+        return hash_expr(hash_expr(h, ((const EQ *)n)->a), ((const EQ *)n)->b);
+    case IRNodeType::NE:
+        return hash_expr(hash_expr(h, ((const NE *)n)->a), ((const NE *)n)->b);
+    case IRNodeType::LT:
+        return hash_expr(hash_expr(h, ((const LT *)n)->a), ((const LT *)n)->b);
+    case IRNodeType::LE:
+        return hash_expr(hash_expr(h, ((const LE *)n)->a), ((const LE *)n)->b);
+    case IRNodeType::GT:
+        return hash_expr(hash_expr(h, ((const GT *)n)->a), ((const GT *)n)->b);
+    case IRNodeType::GE:
+        return hash_expr(hash_expr(h, ((const GE *)n)->a), ((const GE *)n)->b);
+    case IRNodeType::And:
+        return hash_expr(hash_expr(h, ((const And *)n)->a), ((const And *)n)->b);
+    case IRNodeType::Or:
+        return hash_expr(hash_expr(h, ((const Or *)n)->a), ((const Or *)n)->b);
+    case IRNodeType::Not:
+        return hash_expr(h, ((const Not *)n)->a);
+    case IRNodeType::Select: {
+        const Select *op = (const Select *)n;
+        return hash_expr(hash_expr(hash_expr(h, op->condition), op->true_value), op->false_value);
+    }
+    case IRNodeType::Ramp:
+        return hash_expr(hash_expr(h, ((const Ramp *)n)->base), ((const Ramp *)n)->stride);
+    case IRNodeType::Broadcast:
+        return hash_expr(h, ((const Broadcast *)n)->value);
+    case IRNodeType::Let: {
+        const Let *op = (const Let *)n;
+        return hash_expr(hash_expr(hash_string(h, op->name), op->value), op->body);
+    }
+    case IRNodeType::Call: {
+        const Call *op = (const Call *)n;
+        h = hash_string(h, op->name);
+        h = hash_combine(h, (uint64_t)op->call_type);
+        h = hash_combine(h, (uint64_t)op->value_index);
+        for (const Expr &e : op->args) {
+            h = hash_expr(h, e);
+        }
+        return h;
+    }
+    case IRNodeType::Shuffle: {
+        const Shuffle *op = (const Shuffle *)n;
+        for (const Expr &e : op->vectors) {
+            h = hash_expr(h, e);
+        }
+        for (int i : op->indices) {
+            h = hash_combine(h, (uint64_t)i);
+        }
+        return h;
+    }
+    case IRNodeType::VectorReduce:
+        return hash_expr(hash_combine(h, (uint64_t)((const VectorReduce *)n)->op),
+                         ((const VectorReduce *)n)->value);
+    default:
+        internal_error << "Can't intern an Expr of this type\n";
+        return h;
+    }
+}
+
+template<typename T>
+bool binary_equal(const BaseExprNode *a, const BaseExprNode *b) {
+    return (((const T *)a)->a.same_as(((const T *)b)->a) &&
+            ((const T *)a)->b.same_as(((const T *)b)->b));
+}
+
+bool vector_equal(const std::vector<Expr> &a, const std::vector<Expr> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!a[i].same_as(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool shallow_equal(const BaseExprNode *a, const BaseExprNode *b) {
+    if (a->node_type != b->node_type || a->type != b->type) {
+        return false;
+    }
+    switch (a->node_type) {
+    case IRNodeType::IntImm:
+        return ((const IntImm *)a)->value == ((const IntImm *)b)->value;
+    case IRNodeType::UIntImm:
+        return ((const UIntImm *)a)->value == ((const UIntImm *)b)->value;
+    case IRNodeType::FloatImm:
+        // Zeros and NaNs aren't interned, so == is safe.
+        return ((const FloatImm *)a)->value == ((const FloatImm *)b)->value;
+    case IRNodeType::StringImm:
+        return ((const StringImm *)a)->value == ((const StringImm *)b)->value;
+    case IRNodeType::Cast:
+        return ((const Cast *)a)->value.same_as(((const Cast *)b)->value);
+    case IRNodeType::Variable:
+        return ((const Variable *)a)->name == ((const Variable *)b)->name;
+    case IRNodeType::Add:
+        return binary_equal<Add>(a, b);
+    case IRNodeType::Sub:
+        return binary_equal<Sub>(a, b);
+    case IRNodeType::Mul:
+        return binary_equal<Mul>(a, b);
+    case IRNodeType::Div:
+        return binary_equal<Div>(a, b);
+    case IRNodeType::Mod:
+        return binary_equal<Mod>(a, b);
+    case IRNodeType::Min:
+        return binary_equal<Min>(a, b);
+    case IRNodeType::Max:
+        return binary_equal<Max>(a, b);
+    case IRNodeType::EQ:
+        return binary_equal<EQ>(a, b);
+    case IRNodeType::NE:
+        return binary_equal<NE>(a, b);
+    case IRNodeType::LT:
+        return binary_equal<LT>(a, b);
+    case IRNodeType::LE:
+        return binary_equal<LE>(a, b);
+    case IRNodeType::GT:
+        return binary_equal<GT>(a, b);
+    case IRNodeType::GE:
+        return binary_equal<GE>(a, b);
+    case IRNodeType::And:
+        return binary_equal<And>(a, b);
+    case IRNodeType::Or:
+        return binary_equal<Or>(a, b);
+    case IRNodeType::Not:
+        return ((const Not *)a)->a.same_as(((const Not *)b)->a);
+    case IRNodeType::Select: {
+        const Select *sa = (const Select *)a, *sb = (const Select *)b;
+        return (sa->condition.same_as(sb->condition) &&
+                sa->true_value.same_as(sb->true_value) &&
+                sa->false_value.same_as(sb->false_value));
+    }
+    case IRNodeType::Ramp: {
+        const Ramp *ra = (const Ramp *)a, *rb = (const Ramp *)b;
+        return ra->base.same_as(rb->base) && ra->stride.same_as(rb->stride);
+    }
+    case IRNodeType::Broadcast:
+        return ((const Broadcast *)a)->value.same_as(((const Broadcast *)b)->value);
+    case IRNodeType::Let: {
+        const Let *la = (const Let *)a, *lb = (const Let *)b;
+        return (la->name == lb->name &&
+                la->value.same_as(lb->value) &&
+                la->body.same_as(lb->body));
+    }
+    case IRNodeType::Call: {
+        const Call *ca = (const Call *)a, *cb = (const Call *)b;
+        return (ca->name == cb->name &&
+                ca->call_type == cb->call_type &&
+                ca->value_index == cb->value_index &&
+                vector_equal(ca->args, cb->args));
+    }
+    case IRNodeType::Shuffle: {
+        const Shuffle *sa = (const Shuffle *)a, *sb = (const Shuffle *)b;
+        return sa->indices == sb->indices && vector_equal(sa->vectors, sb->vectors);
+    }
+    case IRNodeType::VectorReduce: {
+        const VectorReduce *va = (const VectorReduce *)a, *vb = (const VectorReduce *)b;
+        return va->op == vb->op && va->value.same_as(vb->value);
+    }
+    default:
+        return false;
+    }
+}
+
+// Replace a child with its interned version. Constants are made
+// through raw pointers, so they're interned lazily here when first
+// used as a child. Anything else that isn't interned already makes
+// the parent uninternable.
+bool intern_child(Expr &e) {
+    if (e.get()->interned) {
+        return true;
+    }
+    switch (e.node_type()) {
+    case IRNodeType::IntImm: {
+        IntImm *c = new IntImm;
+        c->type = e.type();
+        c->value = e.as<IntImm>()->value;
+        e = intern_expr(c);
+        return true;
+    }
+    case IRNodeType::UIntImm: {
+        UIntImm *c = new UIntImm;
+        c->type = e.type();
+        c->value = e.as<UIntImm>()->value;
+        e = intern_expr(c);
+        return true;
+    }
+    case IRNodeType::FloatImm: {
+        double v = e.as<FloatImm>()->value;
+        if (v == 0 || std::isnan(v)) {
+            // IRComparer considers 0.0 and -0.0 equal, and NaN equal to
+            // everything, but they aren't interchangeable.
+            return false;
+        }
+        FloatImm *c = new FloatImm;
+        c->type = e.type();
+        c->value = v;
+        e = intern_expr(c);
+        return true;
+    }
+    case IRNodeType::StringImm: {
+        StringImm *c = new StringImm;
+        c->type = e.type();
+        c->value = e.as<StringImm>()->value;
+        e = intern_expr(c);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool intern_children(std::vector<Expr> &v) {
+    for (Expr &e : v) {
+        if (!intern_child(e)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+bool intern_binary_children(BaseExprNode *n) {
+    T *op = (T *)n;
+    return intern_child(op->a) && intern_child(op->b);
+}
+
+// Intern the children of a freshly-made node in place. Returns false
+// if the node can't be interned.
+bool intern_children(BaseExprNode *n) {
+    switch (n->node_type) {
+    case IRNodeType::IntImm:
+    case IRNodeType::UIntImm:
+    case IRNodeType::FloatImm:
+    case IRNodeType::StringImm:
+        return true;
+    case IRNodeType::Cast:
+        return intern_child(((Cast *)n)->value);
+    case IRNodeType::Variable: {
+        const Variable *op = (const Variable *)n;
+        return !(op->param.defined() || op->image.defined() || op->reduction_domain.defined());
+    }
+    case IRNodeType::Add:
+        return intern_binary_children<Add>(n);
+    case IRNodeType::Sub:
+        return intern_binary_children<Sub>(n);
+    case IRNodeType::Mul:
+        return intern_binary_children<Mul>(n);
+    case IRNodeType::Div:
+        return intern_binary_children<Div>(n);
+    case IRNodeType::Mod:
+        return intern_binary_children<Mod>(n);
+    case IRNodeType::Min:
+        return intern_binary_children<Min>(n);
+    case IRNodeType::Max:
+        return intern_binary_children<Max>(n);
+    case IRNodeType::EQ:
+        return intern_binary_children<EQ>(n);
+    case IRNodeType::NE:
+        return intern_binary_children<NE>(n);
+    case IRNodeType::LT:
+        return intern_binary_children<LT>(n);
+    case IRNodeType::LE:
+        return intern_binary_children<LE>(n);
+    case IRNodeType::GT:
+        return intern_binary_children<GT>(n);
+    case IRNodeType::GE:
+        return intern_binary_children<GE>(n);
+    case IRNodeType::And:
+        return intern_binary_children<And>(n);
+    case IRNodeType::Or:
+        return intern_binary_children<Or>(n);
+    case IRNodeType::Not:
+        return intern_child(((Not *)n)->a);
+    case IRNodeType::Select: {
+        Select *op = (Select *)n;
+        return (intern_child(op->condition) &&
+                intern_child(op->true_value) &&
+                intern_child(op->false_value));
+    }
+    case IRNodeType::Ramp:
+        return intern_child(((Ramp *)n)->base) && intern_child(((Ramp *)n)->stride);
+    case IRNodeType::Broadcast:
+        return intern_child(((Broadcast *)n)->value);
+    case IRNodeType::Let:
+        return intern_child(((Let *)n)->value) && intern_child(((Let *)n)->body);
+    case IRNodeType::Call: {
+        Call *op = (Call *)n;
+        // Impure calls must stay distinct nodes, and IRComparer
+        // ignores the objects a call refers to.
+        if (!op->is_pure() || op->func.defined() || op->image.defined() || op->param.defined()) {
+            return false;
+        }
+        return intern_children(op->args);
+    }
+    case IRNodeType::Shuffle:
+        return intern_children(((Shuffle *)n)->vectors);
+    case IRNodeType::VectorReduce:
+        return intern_child(((VectorReduce *)n)->value);
+    default:
+        return false;
+    }
+}
+
+// The table holds weak references to the interned nodes. Nodes remove
+// themselves as they're destroyed. It's sharded by hash so that
+// concurrent compilations don't all contend on a single lock.
+struct InternTable {
+    static constexpr int num_shards = 64;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_multimap<uint64_t, const BaseExprNode *> nodes;
+    } shards[num_shards];
+
+    Shard &shard_for(uint64_t hash) {
+        return shards[(hash >> 7) % num_shards];
+    }
+};
+
+InternTable &intern_table() {
+    // Leaked deliberately, so that Exprs destroyed during static
+    // destruction can still remove themselves.
+    static InternTable *table = new InternTable;
+    return *table;
+}
+
+}  // namespace
+
+void set_expr_interning(bool enabled) {
+    interning_state = enabled ? 1 : 0;
+}
+
+bool expr_interning_enabled() {
+    int state = interning_state;
+    if (state < 0) {
+        state = get_env_variable("HL_INTERN_EXPRS") == "1" ? 1 : 0;
+        int expected = -1;
+        if (!interning_state.compare_exchange_strong(expected, state)) {
+            state = expected;
+        }
+    }
+    return state == 1;
+}
+
+Expr intern_expr(BaseExprNode *node) {
+    // Take ownership, so that the node is freed (outside of any lock)
+    // if we return an existing one instead.
+    Expr fresh(node);
+    if (!expr_interning_enabled() || !intern_children(node)) {
+        return fresh;
+    }
+
+    uint64_t hash = shallow_hash(node);
+    InternTable::Shard &shard = intern_table().shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto range = shard.nodes.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const BaseExprNode *existing = it->second;
+        // A node with a zero ref count is on its way out, and will
+        // remove itself as soon as it gets the lock.
+        if (shallow_equal(existing, node) &&
+            existing->ref_count.increment_if_nonzero()) {
+            Expr result(existing);
+            existing->ref_count.decrement();
+            return result;
+        }
+    }
+    node->interned = true;
+    shard.nodes.emplace(hash, node);
+    return fresh;
+}
+
+void forget_interned_expr(const IRNode *node) {
+    const BaseExprNode *e = (const BaseExprNode *)node;
+    uint64_t hash = shallow_hash(e);
+    InternTable::Shard &shard = intern_table().shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto range = shard.nodes.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == e) {
+            shard.nodes.erase(it);
+            return;
+        }
+    }
+    internal_error << "Interned Expr missing from the interning table\n";
+}
+
+size_t interned_expr_count() {
+    size_t count = 0;
+    for (auto &shard : intern_table().shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.nodes.size();
+    }
+    return count;
+}
+
+void ir_intern_test() {
+    bool was_enabled = expr_interning_enabled();
+    set_expr_interning(true);
+
+    {
+        Expr x = Variable::make(Int(32), "x");
+        Expr y = Variable::make(Int(32), "y");
+        Expr a = (x + 3) * y - min(x, 7);
+        Expr b = (x + 3) * y - min(x, 7);
+        internal_assert(a.same_as(b)) << "Identical Exprs should be interned to the same node\n";
+        internal_assert(a.get()->interned);
+        internal_assert(equal(a, b) && graph_equal(a, b));
+
+        // Different values stay different.
+        Expr c = (x + 3) * y - min(x, 8);
+        internal_assert(!c.same_as(a) && !equal(a, c) && !graph_equal(a, c));
+
+        // Things that must stay distinct aren't interned.
+        Expr neg_zero = Variable::make(Float(32), "f") + make_const(Float(32), -0.0);
+        Expr pos_zero = Variable::make(Float(32), "f") + make_const(Float(32), 0.0);
+        internal_assert(!neg_zero.same_as(pos_zero) && equal(neg_zero, pos_zero));
+        Expr impure = Call::make(Int(32), "rand", {x}, Call::Extern);
+        internal_assert(!impure.same_as(Call::make(Int(32), "rand", {x}, Call::Extern)));
+
+        // Exprs with uninterned children still compare correctly.
+        set_expr_interning(false);
+        Expr d = (x + 3) * y - min(x, 7);
+        set_expr_interning(true);
+        internal_assert(!d.same_as(a) && !d.get()->interned && equal(a, d));
+    }
+
+    // Dead nodes leave the table.
+    size_t before = interned_expr_count();
+    {
+        Expr z = Variable::make(Int(32), "ir_intern_test_z");
+        Expr e = z * 2 + z * 3;
+        internal_assert(interned_expr_count() > before);
+    }
+    internal_assert(interned_expr_count() == before)
+        << "Interning table has " << interned_expr_count() << " entries instead of " << before << "\n";
+
+    set_expr_interning(was_enabled);
+    debug(0) << "ir_intern_test passed\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
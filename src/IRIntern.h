@@ -0,0 +1,46 @@
+#ifndef HALIDE_IR_INTERN_H
+#define HALIDE_IR_INTERN_H
+
+/** \file
+ * Optional hash-consing of Expr nodes, so that structurally identical
+ * expressions share storage.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Turn interning of newly-made Expr nodes on or off for the whole
+ * process. When it's on, the make methods of the pure Expr node
+ * types (arithmetic, comparisons, Cast, Select, Ramp, Broadcast, Let,
+ * Shuffle, VectorReduce, and pure Calls and Variables that don't
+ * refer to a Function, Buffer, Parameter or reduction domain) return
+ * the existing node if there's a live node with the same fields and
+ * children. Constants are interned when they're used as the child of
+ * an interned node. Nodes made while interning is off, and any
+ * node with an uninterned child, are left alone.
+ *
+ * Two interned Exprs are equal by value if and only if they're the
+ * same object, so equal and graph_equal can answer in constant
+ * time. Defaults to the value of the environment variable
+ * HL_INTERN_EXPRS, or off. */
+void set_expr_interning(bool enabled);
+
+/** Whether newly-made Expr nodes are currently being interned. */
+bool expr_interning_enabled();
+
+/** Return the interned version of a freshly-made node, which may be
+ * the node itself. The node must not be shared yet. Called by the make
+ * methods in IR.cpp. */
+Expr intern_expr(BaseExprNode *node);
+
+/** The number of live interned Expr nodes. */
+size_t interned_expr_count();
+
+void ir_intern_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
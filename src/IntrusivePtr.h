@@ -32,6 +32,18 @@ public:
     bool is_const_zero() const {
         return count == 0;
     }
+    /** Increment unless the count has already dropped to zero, which
+     * means the object is being destroyed. Returns whether it was
+     * incremented. */
+    bool increment_if_nonzero() {
+        int c = count;
+        while (c != 0) {
+            if (count.compare_exchange_weak(c, c + 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
 /**
@@ -1,4 +1,7 @@
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <mutex>
 #include <set>
 #include <string>
@@ -20,8 +23,14 @@
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
+#include "Module.h"
 #include "Pipeline.h"
 
+// Defines HALIDE_BUILD_ID. Written at build time by cmake/WriteBuildId.cmake.
+#ifdef HALIDE_HAVE_BUILD_ID_H
+#include "halide_build_id.h"
+#endif
+
 namespace Halide {
 namespace Internal {
 
@@ -140,6 +149,15 @@ public:
     JITModule::Symbol argv_entrypoint;
 
     std::string name;
+
+    // If set, compile_module loads this object code instead of
+    // compiling the llvm module it is given, which holds only the
+    // target options.
+    object::OwningBinary<object::ObjectFile> cached_object;
+
+    // If set, compile_module saves the object code it compiles to
+    // this path in the JIT cache.
+    std::string cache_path;
 };
 
 template<>
@@ -154,11 +172,204 @@ void destroy<JITModuleContents>(const JITModuleContents *f) {
 
 namespace {
 
+// JIT compiled pipelines can be cached on disk, in the directory named by
+// HL_JIT_CACHE_DIR. Entries are keyed by a hash of the llvm module made
+// from the lowered Module, the Target, and the Halide build and LLVM
+// version, and hold the object code MCJIT produced along with an empty
+// llvm module carrying the target options needed to load it. Entries are
+// never removed; delete the directory to clear the cache.
+
+const char jit_cache_magic[8] = {'H', 'L', 'J', 'I', 'T', 'C', '0', '2'};
+
+#define HALIDE_JIT_CACHE_STRINGIFY_(x) #x
+#define HALIDE_JIT_CACHE_STRINGIFY(x) HALIDE_JIT_CACHE_STRINGIFY_(x)
+#ifdef HALIDE_BUILD_ID
+const char *const jit_cache_build_id = HALIDE_JIT_CACHE_STRINGIFY(HALIDE_BUILD_ID);
+#else
+const char *const jit_cache_build_id = "unknown";
+#endif
+
+std::atomic<int> jit_cache_hit_count{0};
+
+// Returns the path of the cache entry for the given llvm module, made
+// from the given Module, or an empty string if the cache is disabled or
+// the Module can't be cached. Strips the names of local values from the
+// llvm module, so that it doesn't depend on the names picked for
+// temporaries during lowering.
+string jit_cache_path(const Module &m, llvm::Module &module) {
+    string dir = get_env_variable("HL_JIT_CACHE_DIR");
+    if (dir.empty()) {
+        return "";
+    }
+    // Submodules and external code aren't part of the llvm module.
+    if (!m.submodules().empty() || !m.external_code().empty()) {
+        return "";
+    }
+    if (std::error_code ec = llvm::sys::fs::create_directories(dir)) {
+        debug(1) << "Not using JIT cache: could not create " << dir << ": " << ec.message() << "\n";
+        return "";
+    }
+
+    for (llvm::Function &f : module) {
+        for (llvm::Argument &arg : f.args()) {
+            arg.setName("");
+        }
+        for (llvm::BasicBlock &block : f) {
+            block.setName("");
+            for (llvm::Instruction &inst : block) {
+                inst.setName("");
+            }
+        }
+    }
+
+    // The key is the bitcode of the llvm module, which holds everything
+    // codegen derived from the Module, including embedded buffers and
+    // the target options. The build id covers changes to libHalide that
+    // would compile the same bitcode differently, such as the options
+    // used to make the execution engine.
+    string key = "halide " + std::to_string(HALIDE_VERSION_MAJOR) + "." +
+                 std::to_string(HALIDE_VERSION_MINOR) + "." + std::to_string(HALIDE_VERSION_PATCH) +
+                 " build " + jit_cache_build_id +
+                 " llvm " + LLVM_VERSION_STRING + "\n" +
+                 m.target().to_string() + "\n";
+    {
+        raw_string_ostream stream(key);
+        WriteBitcodeToFile(module, stream);
+    }
+
+    std::array<uint8_t, 20> digest = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)key.data(), key.size()));
+    const char *hex_digits = "0123456789abcdef";
+    string hex;
+    for (uint8_t d : digest) {
+        hex += hex_digits[d >> 4];
+        hex += hex_digits[d & 0xf];
+    }
+    return dir + "/" + hex + ".jit";
+}
+
+// Load a JIT cache entry. Returns the llvm module holding its target
+// options, or nullptr if there is no usable entry.
+std::unique_ptr<llvm::Module> load_jit_cache_entry(const string &path, llvm::LLVMContext &context,
+                                                   object::OwningBinary<object::ObjectFile> *object) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> file = MemoryBuffer::getFile(path);
+    if (!file) {
+        return nullptr;
+    }
+    StringRef data = (*file)->getBuffer();
+
+    // Read a size-prefixed chunk of the entry.
+    auto read_chunk = [&](StringRef *chunk) {
+        uint64_t size;
+        if (data.size() < sizeof(size)) {
+            return false;
+        }
+        memcpy(&size, data.data(), sizeof(size));
+        data = data.drop_front(sizeof(size));
+        if (data.size() < size) {
+            return false;
+        }
+        *chunk = data.take_front(size);
+        data = data.drop_front(size);
+        return true;
+    };
+
+    StringRef magic(jit_cache_magic, sizeof(jit_cache_magic));
+    StringRef stub_bitcode, object_code;
+    if (!data.consume_front(magic) ||
+        !read_chunk(&stub_bitcode) ||
+        !read_chunk(&object_code)) {
+        debug(1) << "Ignoring malformed JIT cache entry " << path << "\n";
+        return nullptr;
+    }
+
+    Expected<std::unique_ptr<llvm::Module>> stub = parseBitcodeFile(MemoryBufferRef(stub_bitcode, path), context);
+    if (!stub) {
+        consumeError(stub.takeError());
+        debug(1) << "Ignoring malformed JIT cache entry " << path << "\n";
+        return nullptr;
+    }
+
+    std::unique_ptr<MemoryBuffer> object_buffer = MemoryBuffer::getMemBufferCopy(object_code, path);
+    Expected<std::unique_ptr<object::ObjectFile>> object_file = object::ObjectFile::createObjectFile(object_buffer->getMemBufferRef());
+    if (!object_file) {
+        consumeError(object_file.takeError());
+        debug(1) << "Ignoring malformed JIT cache entry " << path << "\n";
+        return nullptr;
+    }
+
+    *object = object::OwningBinary<object::ObjectFile>(std::move(*object_file), std::move(object_buffer));
+    return std::move(*stub);
+}
+
+// Make the bitcode for an empty llvm module with the same target
+// options as the given one.
+string make_jit_cache_stub(const llvm::Module &module) {
+    llvm::Module stub(module.getModuleIdentifier(), module.getContext());
+    stub.setTargetTriple(module.getTargetTriple());
+    stub.setDataLayout(module.getDataLayout());
+    SmallVector<llvm::Module::ModuleFlagEntry, 8> flags;
+    module.getModuleFlagsMetadata(flags);
+    for (const auto &flag : flags) {
+        stub.addModuleFlag(flag.Behavior, flag.Key->getString(), flag.Val);
+    }
+
+    string result;
+    raw_string_ostream stream(result);
+    WriteBitcodeToFile(stub, stream);
+    stream.flush();
+    return result;
+}
+
+void save_jit_cache_entry(const string &path, const string &stub_bitcode, const MemoryBuffer &object_code) {
+    // Write to a temporary file and rename it into place, so that
+    // concurrent readers and writers never see a partial entry.
+    int fd;
+    SmallString<256> temp_path;
+    if (std::error_code ec = llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, temp_path)) {
+        debug(1) << "Could not write JIT cache entry " << path << ": " << ec.message() << "\n";
+        return;
+    }
+    {
+        raw_fd_ostream out(fd, /* shouldClose */ true);
+        out.write(jit_cache_magic, sizeof(jit_cache_magic));
+        for (StringRef chunk : {StringRef(stub_bitcode), object_code.getBuffer()}) {
+            uint64_t size = chunk.size();
+            out.write((const char *)&size, sizeof(size));
+            out << chunk;
+        }
+        out.close();
+        if (out.has_error()) {
+            out.clear_error();
+            llvm::sys::fs::remove(temp_path);
+            debug(1) << "Could not write JIT cache entry " << path << "\n";
+            return;
+        }
+    }
+    if (llvm::sys::fs::rename(temp_path, path)) {
+        llvm::sys::fs::remove(temp_path);
+    }
+}
+
+// Catches the object code MCJIT produces, so it can be saved to the JIT cache.
+class JITObjectCache : public ObjectCache {
+public:
+    std::unique_ptr<MemoryBuffer> object_code;
+
+    void notifyObjectCompiled(const llvm::Module *, MemoryBufferRef obj) override {
+        object_code = MemoryBuffer::getMemBufferCopy(obj.getBuffer(), obj.getBufferIdentifier());
+    }
+
+    std::unique_ptr<MemoryBuffer> getObject(const llvm::Module *) override {
+        return nullptr;
+    }
+};
+
 // Retrieve a function pointer from an llvm module, possibly by compiling it.
 JITModule::Symbol compile_and_get_function(ExecutionEngine &ee, const string &name) {
     debug(2) << "JIT Compiling " << name << "\n";
+    // The function may instead be in an object file loaded from the JIT cache.
     llvm::Function *fn = ee.FindFunctionNamed(name);
-    internal_assert(fn->getName() == name);
+    internal_assert(!fn || fn->getName() == name);
     void *f = (void *)ee.getFunctionAddress(name);
     if (!f) {
         internal_error << "Compiling " << name << " returned nullptr\n";
@@ -230,10 +441,25 @@ JITModule::JITModule() {
     jit_module = new JITModuleContents();
 }
 
+int JITModule::jit_cache_hits() {
+    return jit_cache_hit_count;
+}
+
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
                      const std::vector<JITModule> &dependencies) {
     jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context));
+    std::unique_ptr<llvm::Module> llvm_module = compile_module_to_llvm_module(m, jit_module->context);
+    string cache_path = jit_cache_path(m, *llvm_module);
+    if (!cache_path.empty()) {
+        std::unique_ptr<llvm::Module> stub = load_jit_cache_entry(cache_path, jit_module->context, &jit_module->cached_object);
+        if (stub) {
+            debug(1) << "Loaded " << fn.name << " from JIT cache entry " << cache_path << "\n";
+            jit_cache_hit_count++;
+            llvm_module = std::move(stub);
+        } else {
+            jit_module->cache_path = cache_path;
+        }
+    }
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
@@ -262,6 +488,11 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
 
+    string cache_stub;
+    if (!jit_module->cache_path.empty()) {
+        cache_stub = make_jit_cache_stub(*m);
+    }
+
     llvm::EngineBuilder engine_builder((std::move(m)));
     engine_builder.setTargetOptions(options);
     engine_builder.setErrorStr(&error_string);
@@ -305,6 +536,13 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
         ee->RegisterJITEventListener(listeners[i]);
     }
 
+    JITObjectCache object_cache;
+    if (jit_module->cached_object.getBinary()) {
+        ee->addObjectFile(std::move(jit_module->cached_object));
+    } else if (!jit_module->cache_path.empty()) {
+        ee->setObjectCache(&object_cache);
+    }
+
     // Retrieve function pointers from the compiled module (which also
     // triggers compilation)
     debug(1) << "JIT compiling " << module_name
@@ -327,6 +565,12 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
 
     debug(2) << "Finalizing object\n";
     ee->finalizeObject();
+
+    if (object_cache.object_code) {
+        ee->setObjectCache(nullptr);
+        save_jit_cache_entry(jit_module->cache_path, cache_stub, *object_cache.object_code);
+    }
+    jit_module->cache_path.clear();
     // Do any target-specific post-compilation module meddling
     for (size_t i = 0; i < listeners.size(); i++) {
         ee->UnregisterJITEventListener(listeners[i]);
@@ -932,5 +1176,56 @@ void JITSharedRuntime::reuse_device_allocations(bool b) {
     shared_runtimes(MainShared).reuse_device_allocations(b);
 }
 
+namespace {
+
+// Look up a function exported by the main shared runtime. Returns
+// nullptr if the runtime hasn't been compiled yet.
+template<typename FnType>
+FnType shared_runtime_function(const char *name) {
+    const std::map<std::string, JITModule::Symbol> &exports = shared_runtimes(MainShared).exports();
+    std::map<std::string, JITModule::Symbol>::const_iterator f = exports.find(name);
+    return f == exports.end() ? nullptr : reinterpret_bits<FnType>(f->second.address);
+}
+
+}  // namespace
+
+void JITSharedRuntime::reuse_host_allocations(bool b) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    if (auto f = shared_runtime_function<int (*)(void *, bool)>("halide_reuse_host_allocations")) {
+        f(nullptr, b);
+    }
+}
+
+void JITSharedRuntime::release_unused_host_allocations() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    if (auto f = shared_runtime_function<int (*)(void *)>("halide_release_unused_host_allocations")) {
+        f(nullptr);
+    }
+}
+
+bool JITSharedRuntime::memoization_cache_get_stats(halide_memoization_cache_stats *stats) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    auto f = shared_runtime_function<int (*)(halide_memoization_cache_stats *)>("halide_memoization_cache_get_stats");
+    return f && f(stats) == 0;
+}
+
+bool JITSharedRuntime::host_allocation_get_stats(halide_host_allocation_stats *stats) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    auto f = shared_runtime_function<int (*)(halide_host_allocation_stats *)>("halide_host_allocation_get_stats");
+    return f && f(stats) == 0;
+}
+
+int JITSharedRuntime::cuda_get_device_ordinal(uint64_t device_ptr, int *ordinal) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    for (RuntimeKind k : {CUDA, CUDADebug}) {
+        std::map<std::string, JITModule::Symbol>::const_iterator f =
+            shared_runtimes(k).exports().find("halide_cuda_get_device_ordinal");
+        if (f != shared_runtimes(k).exports().end()) {
+            return (reinterpret_bits<int (*)(void *, uint64_t, int *)>(f->second.address))(nullptr, device_ptr, ordinal);
+        }
+    }
+    return -1;
+}
+
 }  // namespace Internal
 }  // namespace Halide
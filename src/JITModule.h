@@ -135,6 +135,10 @@ struct JITModule {
 
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
+
+    /** The number of modules loaded from the on-disk JIT cache named
+     * by HL_JIT_CACHE_DIR so far. For testing. */
+    static int jit_cache_hits();
 };
 
 typedef int (*halide_task)(void *user_context, int, uint8_t *);
@@ -177,6 +181,12 @@ public:
      */
     static void memoization_cache_evict(uint64_t eviction_key);
 
+    /** Get the counters kept by the memoization cache. Returns false
+     * if the shared runtime hasn't been compiled yet. If you are
+     * compiling statically, you should include HalideRuntime.h and
+     * call halide_memoization_cache_get_stats instead. */
+    static bool memoization_cache_get_stats(halide_memoization_cache_stats *stats);
+
     /** Set whether or not Halide may hold onto and reuse device
      * allocations to avoid calling expensive device API allocation
      * functions. If you are compiling statically, you should include
@@ -184,6 +194,30 @@ public:
      * instead. */
     static void reuse_device_allocations(bool);
 
+    /** Turn the pool of host allocations used by the default
+     * allocator on or off, and return the memory it holds to the
+     * system. If you are compiling statically, you should include
+     * HalideRuntime.h and call halide_reuse_host_allocations and
+     * halide_release_unused_host_allocations instead. */
+    // @{
+    static void reuse_host_allocations(bool);
+    static void release_unused_host_allocations();
+    // @}
+
+    /** Get the counters kept by the default host allocator. Returns
+     * false if the shared runtime hasn't been compiled yet. If you are
+     * compiling statically, you should include HalideRuntime.h and
+     * call halide_host_allocation_get_stats instead. */
+    static bool host_allocation_get_stats(halide_host_allocation_stats *stats);
+
+    /** Get the ordinal of the CUDA device a device pointer was
+     * allocated on, or of the device the CUDA runtime uses if
+     * device_ptr is zero. Returns nonzero if no CUDA runtime has been
+     * loaded or the query fails. If you are compiling statically, you
+     * should include HalideRuntimeCuda.h and call
+     * halide_cuda_get_device_ordinal instead. */
+    static int cuda_get_device_ordinal(uint64_t device_ptr, int *ordinal);
+
     static void release_all();
 };
 
@@ -5,6 +5,8 @@
 #include "CompilerLogger.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
+#include "ThreadPool.h"
+#include "Util.h"
 
 #include <fstream>
 #include <iostream>
@@ -342,31 +344,28 @@ std::unique_ptr<llvm::Module> clone_module(const llvm::Module &module_in) {
 
 }  // namespace
 
-void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
-               llvm::CodeGenFileType file_type) {
-    Internal::debug(1) << "emit_file.Compiling to native code...\n";
-    Internal::debug(2) << "Target triple: " << module_in.getTargetTriple() << "\n";
-
-    auto time_start = std::chrono::high_resolution_clock::now();
-
-    // Work on a copy of the module to avoid modifying the original.
-    std::unique_ptr<llvm::Module> module = clone_module(module_in);
+namespace {
 
+// Compile a module to native code in place. Only touches the module
+// and its LLVMContext, so can be run concurrently on modules in
+// different contexts.
+void emit_module(llvm::Module &module, Internal::LLVMOStream &out,
+                 llvm::CodeGenFileType file_type) {
     // Get the target specific parser.
-    auto target_machine = Internal::make_target_machine(*module);
+    auto target_machine = Internal::make_target_machine(module);
     internal_assert(target_machine.get()) << "Could not allocate target machine!\n";
 
     llvm::DataLayout target_data_layout(target_machine->createDataLayout());
-    if (!(target_data_layout == module->getDataLayout())) {
+    if (!(target_data_layout == module.getDataLayout())) {
         internal_error << "Warning: module's data layout does not match target machine's\n"
                        << target_data_layout.getStringRepresentation() << "\n"
-                       << module->getDataLayout().getStringRepresentation() << "\n";
+                       << module.getDataLayout().getStringRepresentation() << "\n";
     }
 
     // Build up all of the passes that we want to do to the module.
     llvm::legacy::PassManager pass_manager;
 
-    pass_manager.add(new llvm::TargetLibraryInfoWrapperPass(llvm::Triple(module->getTargetTriple())));
+    pass_manager.add(new llvm::TargetLibraryInfoWrapperPass(llvm::Triple(module.getTargetTriple())));
 
     // Make sure things marked as always-inline get inlined
     pass_manager.add(llvm::createAlwaysInlinerLegacyPass());
@@ -386,8 +385,10 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
     // Ask the target to add backend passes as necessary.
     target_machine->addPassesToEmitFile(pass_manager, out, nullptr, file_type);
 
-    pass_manager.run(*module);
+    pass_manager.run(module);
+}
 
+void record_llvm_time(std::chrono::high_resolution_clock::time_point time_start) {
     auto *logger = Internal::get_compiler_logger();
     if (logger) {
         auto time_end = std::chrono::high_resolution_clock::now();
@@ -399,6 +400,86 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
     llvm::reportAndResetTimings();
 }
 
+// Get a module ready to be split into separately-compiled
+// partitions. Partitions can only refer to each other's symbols
+// through the object file symbol table, so nothing one partition
+// needs from another may be inlined away or discarded.
+void prepare_module_for_splitting(llvm::Module &module) {
+    // Inline always-inline functions while their callers and callees
+    // are still in the same module.
+    llvm::legacy::PassManager pass_manager;
+    pass_manager.add(llvm::createAlwaysInlinerLegacyPass());
+    pass_manager.run(module);
+
+    // SplitModule gives internal symbols external linkage and hidden
+    // visibility when they're used across partitions. Prefix them with
+    // the module name so that they can't collide with the same
+    // symbols from other Halide modules linked into the same binary.
+    const std::string prefix = module.getModuleIdentifier() + ".";
+    for (llvm::GlobalValue &gv : module.global_values()) {
+        if (gv.isDeclaration()) {
+            continue;
+        }
+        if (gv.hasLocalLinkage() && gv.hasName() && !gv.getName().startswith("llvm.")) {
+            gv.setName(prefix + gv.getName().str());
+        }
+        // Code generation drops unused linkonce definitions, but
+        // another partition may use them.
+        if (gv.hasLinkOnceODRLinkage()) {
+            gv.setLinkage(llvm::GlobalValue::WeakODRLinkage);
+        } else if (gv.hasLinkOnceLinkage()) {
+            gv.setLinkage(llvm::GlobalValue::WeakAnyLinkage);
+        }
+    }
+}
+
+// A static library member is only linked in if something refers to
+// one of its symbols. A partition may be reachable only through
+// llvm.global_ctors, or only through weak definitions that another
+// object already provides, in which case the linker would silently
+// leave it out. Give each partition an anchor symbol, and make each
+// partition refer to the anchors of all the others, so that linking
+// any one member brings in the whole module.
+void link_partitions_together(llvm::Module &module, size_t index, size_t count, const std::string &prefix) {
+    if (count <= 1) {
+        return;
+    }
+    llvm::Type *i8_t = llvm::Type::getInt8Ty(module.getContext());
+    std::vector<llvm::Constant *> others;
+    for (size_t i = 0; i < count; i++) {
+        llvm::Constant *init = (i == index) ? llvm::ConstantInt::get(i8_t, 0) : nullptr;
+        llvm::GlobalVariable *anchor =
+            new llvm::GlobalVariable(module, i8_t, true, llvm::GlobalValue::ExternalLinkage, init,
+                                     prefix + "partition_anchor." + std::to_string(i));
+        anchor->setVisibility(llvm::GlobalValue::HiddenVisibility);
+        if (i != index) {
+            others.push_back(anchor);
+        }
+    }
+    llvm::ArrayType *refs_t = llvm::ArrayType::get(i8_t->getPointerTo(), others.size());
+    llvm::GlobalVariable *refs =
+        new llvm::GlobalVariable(module, refs_t, true, llvm::GlobalValue::InternalLinkage,
+                                 llvm::ConstantArray::get(refs_t, others), prefix + "partition_refs");
+    llvm::appendToUsed(module, {refs});
+}
+
+}  // namespace
+
+void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
+               llvm::CodeGenFileType file_type) {
+    Internal::debug(1) << "emit_file.Compiling to native code...\n";
+    Internal::debug(2) << "Target triple: " << module_in.getTargetTriple() << "\n";
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    // Work on a copy of the module to avoid modifying the original.
+    std::unique_ptr<llvm::Module> module = clone_module(module_in);
+
+    emit_module(*module, out, file_type);
+
+    record_llvm_time(time_start);
+}
+
 std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context) {
     return codegen_llvm(module, context);
 }
@@ -407,6 +488,91 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream &
     emit_file(module, out, llvm::CGFT_ObjectFile);
 }
 
+std::vector<std::vector<char>> compile_llvm_module_to_objects(llvm::Module &module_in, int num_partitions) {
+    internal_assert(num_partitions > 0);
+    Internal::debug(1) << "Compiling to native code in " << num_partitions << " partitions...\n";
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    std::unique_ptr<llvm::Module> module = clone_module(module_in);
+    const std::string prefix = module->getModuleIdentifier() + ".";
+    prepare_module_for_splitting(*module);
+
+    // SplitModule assigns globals to partitions by a hash of their
+    // names, so the partitioning is deterministic. Each partition
+    // is handed to a worker as bitcode, to be compiled in its own
+    // LLVMContext.
+    std::vector<llvm::SmallVector<char, 0>> partitions;
+    auto add_partition = [&](std::unique_ptr<llvm::Module> part) {
+        partitions.emplace_back();
+        llvm::raw_svector_ostream stream(partitions.back());
+        WriteBitcodeToFile(*part, stream);
+    };
+#if LLVM_VERSION >= 120
+    llvm::SplitModule(*module, num_partitions, add_partition);
+#else
+    llvm::SplitModule(std::move(module), num_partitions, add_partition);
+#endif
+
+    std::vector<std::vector<char>> objects(partitions.size());
+    {
+        Internal::ThreadPool<void> pool(std::min((size_t)num_partitions, partitions.size()));
+        std::vector<std::future<void>> results;
+        for (size_t i = 0; i < partitions.size(); i++) {
+            results.push_back(pool.async([&, i]() {
+                llvm::LLVMContext context;
+                llvm::MemoryBufferRef buffer_ref(llvm::StringRef(partitions[i].data(), partitions[i].size()),
+                                                 "partition_" + std::to_string(i));
+                auto part = llvm::parseBitcodeFile(buffer_ref, context);
+                internal_assert(part) << "Failed to read back partition " << i << "\n";
+                link_partitions_together(*part.get(), i, partitions.size(), prefix);
+
+                llvm::SmallVector<char, 0> object;
+                llvm::raw_svector_ostream object_stream(object);
+                emit_module(*part.get(), object_stream, llvm::CGFT_ObjectFile);
+                objects[i].assign(object.begin(), object.end());
+            }));
+        }
+        for (auto &r : results) {
+            r.get();
+        }
+    }
+
+    record_llvm_time(time_start);
+    return objects;
+}
+
+namespace {
+
+// Zero if there is no limit.
+thread_local int codegen_thread_limit = 0;
+
+}  // namespace
+
+int llvm_codegen_threads() {
+    std::string threads = Internal::get_env_variable("HL_LLVM_CODEGEN_THREADS");
+    if (threads.empty()) {
+        return 1;
+    }
+    int n = std::atoi(threads.c_str());
+    if (n <= 0) {
+        n = (int)Internal::ThreadPool<void>::num_processors_online();
+    }
+    if (codegen_thread_limit > 0) {
+        n = std::min(n, codegen_thread_limit);
+    }
+    return std::max(n, 1);
+}
+
+ScopedCodegenThreadLimit::ScopedCodegenThreadLimit(int limit)
+    : previous(codegen_thread_limit) {
+    codegen_thread_limit = limit;
+}
+
+ScopedCodegenThreadLimit::~ScopedCodegenThreadLimit() {
+    codegen_thread_limit = previous;
+}
+
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream &out) {
     emit_file(module, out, llvm::CGFT_AssemblyFile);
 }
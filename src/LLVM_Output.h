@@ -39,6 +39,37 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream &
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream &out);
 // @}
 
+/** Split an LLVM module into the given number of partitions, and
+ * compile each to a separate object file concurrently. The objects
+ * together define the same symbols as compile_llvm_module_to_object
+ * would, and are suitable for bundling into a static library. The
+ * output is deterministic. Internal symbols used across partitions
+ * become hidden symbols prefixed with the module name. Each object
+ * refers to all of the others, so a linker that pulls any one of them
+ * out of a static library pulls in all of them. */
+std::vector<std::vector<char>> compile_llvm_module_to_objects(llvm::Module &module, int num_partitions);
+
+/** The number of threads to use to compile a module to a static
+ * library, from the environment variable HL_LLVM_CODEGEN_THREADS. A
+ * value of zero means one per core. Defaults to one, which compiles
+ * the module as a single object. Capped by any
+ * ScopedCodegenThreadLimit active on the calling thread. */
+int llvm_codegen_threads();
+
+/** While one of these is alive, llvm_codegen_threads on the current
+ * thread returns at most the given limit. Used to share one thread
+ * budget between modules compiled concurrently. */
+class ScopedCodegenThreadLimit {
+    int previous;
+
+public:
+    explicit ScopedCodegenThreadLimit(int limit);
+    ~ScopedCodegenThreadLimit();
+
+    ScopedCodegenThreadLimit(const ScopedCodegenThreadLimit &) = delete;
+    ScopedCodegenThreadLimit &operator=(const ScopedCodegenThreadLimit &) = delete;
+};
+
 /** Compile an LLVM module to LLVM targets (bitcode, LLVM assembly). */
 // @{
 void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOStream &out);
@@ -2,6 +2,10 @@
 #include "Error.h"
 #include "LLVM_Headers.h"
 #include "Target.h"
+#include "Util.h"
+
+#include <map>
+#include <mutex>
 
 namespace Halide {
 
@@ -82,13 +86,16 @@ DECLARE_CPP_INITMOD(android_clock)
 DECLARE_CPP_INITMOD(android_host_cpu_count)
 DECLARE_CPP_INITMOD(android_io)
 DECLARE_CPP_INITMOD(halide_buffer_t)
+DECLARE_CPP_INITMOD(batch)
 DECLARE_CPP_INITMOD(cache)
 DECLARE_CPP_INITMOD(can_use_target)
 DECLARE_CPP_INITMOD(cuda)
 DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(device_interface)
 DECLARE_CPP_INITMOD(errors)
+DECLARE_CPP_INITMOD(fake_file_mmap)
 DECLARE_CPP_INITMOD(fake_get_symbol)
+DECLARE_CPP_INITMOD(fake_numa)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(fuchsia_clock)
@@ -100,6 +107,7 @@ DECLARE_CPP_INITMOD(hexagon_host)
 DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
+DECLARE_CPP_INITMOD(linux_numa)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(matlab)
 DECLARE_CPP_INITMOD(metadata)
@@ -119,6 +127,7 @@ DECLARE_CPP_INITMOD(osx_yield)
 DECLARE_CPP_INITMOD(posix_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(posix_error_handler)
+DECLARE_CPP_INITMOD(posix_file_mmap)
 DECLARE_CPP_INITMOD(posix_get_symbol)
 DECLARE_CPP_INITMOD(posix_io)
 DECLARE_CPP_INITMOD(posix_print)
@@ -139,6 +148,7 @@ DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
 DECLARE_CPP_INITMOD(ssp)
+DECLARE_CPP_INITMOD(tile_source)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(trace_helper)
 DECLARE_CPP_INITMOD(tracing)
@@ -763,8 +773,11 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     // modules.push_back(get_initmod_posix_math_ll(c));
     // modules.push_back(get_initmod_wasm_math_ll(c));
     modules.push_back(get_initmod_tracing(c, bits_64, debug));
+    modules.push_back(get_initmod_fake_file_mmap(c, bits_64, debug));
     modules.push_back(get_initmod_cache(c, bits_64, debug));
     modules.push_back(get_initmod_to_string(c, bits_64, debug));
+    modules.push_back(get_initmod_batch(c, bits_64, debug));
+    modules.push_back(get_initmod_tile_source(c, bits_64, debug));
     modules.push_back(get_initmod_alignment_32(c, bits_64, debug));
     modules.push_back(get_initmod_device_interface(c, bits_64, debug));
     modules.push_back(get_initmod_metadata(c, bits_64, debug));
@@ -780,8 +793,9 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     return std::move(modules[0]);
 }
 
-/** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+std::unique_ptr<llvm::Module> make_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -828,6 +842,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_file_mmap(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -843,6 +859,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_file_mmap(c, bits_64, debug));
                 if (t.has_feature(Target::WasmThreads)) {
                     modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
                 } else {
@@ -857,6 +875,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_file_mmap(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
                 } else {
@@ -876,6 +896,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_android_io(c, bits_64, debug));
                 modules.push_back(get_initmod_android_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));  // TODO: verify
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_file_mmap(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
                 } else {
@@ -889,6 +911,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_windows_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_io(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_file_mmap(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_windows_threads_tsan(c, bits_64, debug));
                 } else {
@@ -903,6 +927,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_ios_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_file_mmap(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
                 } else {
@@ -911,6 +937,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             } else if (t.os == Target::QuRT) {
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_file_mmap(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_qurt_threads_tsan(c, bits_64, debug));
                 } else {
@@ -926,6 +954,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 if (t.arch == Target::Hexagon) {
                     modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 }
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_file_mmap(c, bits_64, debug));
                 modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
             } else if (t.os == Target::Fuchsia) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
@@ -935,6 +965,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+                modules.push_back(get_initmod_posix_file_mmap(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
                 } else {
@@ -978,6 +1010,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_cache(c, bits_64, debug));
             }
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
+            modules.push_back(get_initmod_batch(c, bits_64, debug));
+            modules.push_back(get_initmod_tile_source(c, bits_64, debug));
 
             if (t.arch == Target::Hexagon ||
                 t.has_feature(Target::HVX)) {
@@ -1198,6 +1232,64 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+// Fully-linked initial modules, kept as bitcode so that they can be
+// loaded into any LLVMContext. Parsing one of these is much cheaper
+// than parsing the dozens of runtime modules that went into it and
+// linking them together again.
+struct CachedInitialModule {
+    std::string id;
+    llvm::SmallVector<char, 0> bitcode;
+};
+
+std::mutex initial_module_cache_mutex;
+std::map<std::string, std::shared_ptr<const CachedInitialModule>> initial_module_cache;
+
+}  // namespace
+
+/** Create an llvm module containing the support code for a given target. */
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    // Set HL_RUNTIME_MODULE_CACHE=0 to link the runtime from scratch
+    // every time.
+    if (get_env_variable("HL_RUNTIME_MODULE_CACHE") == "0") {
+        return make_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+    }
+
+    std::string key = t.to_string();
+    if (for_shared_jit_runtime) {
+        key += "/shared_jit_runtime";
+    }
+    if (just_gpu) {
+        key += "/just_gpu";
+    }
+
+    std::shared_ptr<const CachedInitialModule> cached;
+    {
+        std::lock_guard<std::mutex> lock(initial_module_cache_mutex);
+        auto it = initial_module_cache.find(key);
+        if (it != initial_module_cache.end()) {
+            cached = it->second;
+        }
+    }
+
+    if (!cached) {
+        // Two threads may race to build the same module. That's
+        // harmless; the first one to finish wins.
+        std::unique_ptr<llvm::Module> m = make_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+        auto entry = std::make_shared<CachedInitialModule>();
+        entry->id = m->getModuleIdentifier();
+        llvm::raw_svector_ostream stream(entry->bitcode);
+        llvm::WriteBitcodeToFile(*m, stream, /* ShouldPreserveUseListOrder */ true);
+
+        std::lock_guard<std::mutex> lock(initial_module_cache_mutex);
+        cached = initial_module_cache.emplace(key, std::move(entry)).first->second;
+    }
+
+    // Always hand back a parsed copy, even on a miss, so that every
+    // compilation starts from exactly the same module.
+    return parse_bitcode_file(llvm::StringRef(cached->bitcode.data(), cached->bitcode.size()),
+                              c, cached->id.c_str());
+}
+
 #ifdef WITH_NVPTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
@@ -30,6 +30,7 @@
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
 #include "HexagonOffload.h"
+#include "IRArena.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -83,11 +84,86 @@ using std::vector;
 
 namespace {
 
+// Counts the distinct IR nodes reachable from a Stmt.
+class CountIRNodes : public IRGraphVisitor {
+    std::set<const IRNode *> seen;
+
+    using IRGraphVisitor::include;
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            count++;
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (seen.insert(s.get()).second) {
+            count++;
+            s.accept(this);
+        }
+    }
+
+public:
+    uint64_t count = 0;
+
+    uint64_t operator()(const Stmt &s) {
+        if (s.defined()) {
+            include(s);
+        }
+        return count;
+    }
+};
+
+// Profiling lowering needs somewhere to put the results. If a
+// CompilerLogger is active, they go there. Otherwise (e.g. when JIT
+// compiling) this makes a logger of its own for the duration of
+// lowering, and dumps it to stderr afterwards. The global logger is
+// left alone, as lowerings on other threads may be using it.
+class LoweringProfileLogger {
+    std::unique_ptr<CompilerLogger> owned;
+    CompilerLogger *logger = nullptr;
+
+public:
+    LoweringProfileLogger(bool profile, const string &pipeline_name, const Target &t) {
+        if (!profile) {
+            return;
+        }
+        logger = get_compiler_logger();
+        if (!logger) {
+            owned = std::make_unique<JSONCompilerLogger>("", pipeline_name, "", t, "", false);
+            logger = owned.get();
+        }
+    }
+
+    ~LoweringProfileLogger() {
+        if (owned) {
+            owned->emit_to_stream(std::cerr);
+        }
+    }
+
+    // The logger to record passes with, or nullptr if not profiling.
+    CompilerLogger *get() const {
+        return logger;
+    }
+};
+
 class LoweringLogger {
     Stmt last_written;
 
+    // If set, the time taken by each pass, and the size of the IR
+    // after it, are recorded with this logger.
+    CompilerLogger *const profile_logger;
+    std::chrono::high_resolution_clock::time_point last_time;
+
 public:
+    explicit LoweringLogger(CompilerLogger *profile_logger)
+        : profile_logger(profile_logger), last_time(std::chrono::high_resolution_clock::now()) {
+    }
+
     void operator()(const string &message, const Stmt &s) {
+        record(message, s);
         if (!s.same_as(last_written)) {
             debug(2) << message << "\n"
                      << s << "\n";
@@ -95,6 +171,33 @@ public:
         } else {
             debug(2) << message << " (unchanged)\n\n";
         }
+        restart_clock();
+    }
+
+    // Record the time since the clock was last restarted as a pass
+    // producing s. The message is of the form "Lowering after <pass>:".
+    void record(const string &message, const Stmt &s) {
+        if (!profile_logger) {
+            return;
+        }
+        auto now = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = now - last_time;
+        string name = message;
+        if (starts_with(name, "Lowering after ")) {
+            name = name.substr(15);
+        }
+        if (ends_with(name, ":")) {
+            name.pop_back();
+        }
+        profile_logger->record_lowering_pass(name, diff.count(), CountIRNodes()(s));
+    }
+
+    // Start timing the next pass. Called after any work, such as
+    // printing or counting the IR, that isn't part of a pass.
+    void restart_clock() {
+        if (profile_logger) {
+            last_time = std::chrono::high_resolution_clock::now();
+        }
     }
 };
 
@@ -110,6 +213,17 @@ Module lower(const vector<Function> &output_funcs,
              const vector<IRMutator *> &custom_passes) {
     auto time_start = std::chrono::high_resolution_clock::now();
 
+    // Allocate the IR made during lowering from an arena. It's
+    // declared first so that it outlives everything else here.
+    IRNodeArena ir_arena;
+
+    // Memoize simplification for the duration of lowering only.
+    ScopedSimplifyMemo simplify_memo;
+
+    const bool profile_lowering = t.has_feature(Target::ProfileLowering) ||
+                                  get_env_variable("HL_PROFILE_LOWERING") == "1";
+    LoweringProfileLogger profile_logger(profile_lowering, pipeline_name, t);
+
     std::vector<std::string> namespaces;
     std::string simple_pipeline_name = extract_namespaces(pipeline_name, namespaces);
 
@@ -151,7 +265,7 @@ Module lower(const vector<Function> &output_funcs,
     // specializations' conditions
     simplify_specializations(env);
 
-    LoweringLogger log;
+    LoweringLogger log(profile_logger.get());
 
     debug(1) << "Creating initial loop nests...\n";
     bool any_memoized = false;
@@ -160,7 +274,7 @@ Module lower(const vector<Function> &output_funcs,
 
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
-        s = inject_memoization(s, env, pipeline_name, outputs);
+        s = inject_memoization(s, env, pipeline_name, outputs, t);
         log("Lowering after injecting memoization:", s);
     } else {
         debug(1) << "Skipping injecting memoization...\n";
@@ -347,8 +461,7 @@ Module lower(const vector<Function> &output_funcs,
 
     debug(1) << "Rebasing loops to zero...\n";
     s = rebase_loops_to_zero(s);
-    debug(2) << "Lowering after rebasing loops to zero:\n"
-             << s << "\n\n";
+    log("Lowering after rebasing loops to zero:", s);
 
     debug(1) << "Hoisting loop invariant if statements...\n";
     s = hoist_loop_invariant_if_statements(s);
@@ -386,6 +499,7 @@ Module lower(const vector<Function> &output_funcs,
 
     debug(1) << "Simplifying...\n";
     s = common_subexpression_elimination(s);
+    log("Lowering after common subexpression elimination:", s);
 
     debug(1) << "Lowering unsafe promises...\n";
     s = lower_unsafe_promises(s, t);
@@ -411,8 +525,7 @@ Module lower(const vector<Function> &output_funcs,
     if (t.arch != Target::Hexagon && t.has_feature(Target::HVX)) {
         debug(1) << "Splitting off Hexagon offload...\n";
         s = inject_hexagon_rpc(s, t, result_module);
-        debug(2) << "Lowering after splitting off Hexagon offload:\n"
-                 << s << "\n";
+        log("Lowering after splitting off Hexagon offload:", s);
     } else {
         debug(1) << "Skipping Hexagon offload...\n";
     }
@@ -424,16 +537,17 @@ Module lower(const vector<Function> &output_funcs,
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
             s = custom_passes[i]->mutate(s);
+            log.record("Lowering after custom pass " + std::to_string(i) + ":", s);
             debug(1) << "Lowering after custom pass " << i << ":\n"
                      << s << "\n\n";
+            log.restart_clock();
         }
     }
 
     if (t.has_gpu_feature()) {
         debug(1) << "Offloading GPU loops...\n";
         s = inject_gpu_offload(s, t);
-        debug(2) << "Lowering after splitting off GPU loops:\n"
-                 << s << "\n\n";
+        log("Lowering after splitting off GPU loops:", s);
     } else {
         debug(1) << "Skipping GPU offload...\n";
     }
@@ -3,13 +3,17 @@
 #include "Function.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
 #include "IRVisitor.h"
 #include "Param.h"
 #include "Scope.h"
+#include "Target.h"
 #include "Util.h"
 #include "Var.h"
 
+#include <iomanip>
 #include <map>
+#include <sstream>
 
 namespace Halide {
 namespace Internal {
@@ -158,6 +162,7 @@ class KeyInfo {
     Expr key_size_expr;
     const std::string &top_level_name;
     const std::string &function_name;
+    const std::string &fingerprint;
     int memoize_instance;
 
     size_t parameters_alignment() {
@@ -192,9 +197,11 @@ class KeyInfo {
     // It was deleted as part of the address_of intrinsic cleanup).
 
 public:
-    KeyInfo(const Function &function, const std::string &name, int memoize_instance)
+    KeyInfo(const Function &function, const std::string &name,
+            const std::string &fingerprint, int memoize_instance)
         : top_level_name(name),
           function_name(function.origin_name()),
+          fingerprint(fingerprint),
           memoize_instance(memoize_instance) {
         dependencies.visit_function(function);
         size_t size_so_far = 0;
@@ -227,10 +234,14 @@ public:
         // Store a pointer to a string identifying the filter and
         // function. Assume this will be unique due to CSE. This can
         // break with loading and unloading of code, though the name
-        // mechanism can also break in those conditions.
+        // mechanism can also break in those conditions. The string
+        // ends with a fingerprint of the code, so that a cache shared
+        // between processes can tell apart different pipelines that
+        // use the same names.
         writes.push_back(Store::make(key_name,
                                      StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
-                                                     std::to_string(function_name.size()) + ":" + function_name),
+                                                     std::to_string(function_name.size()) + ":" + function_name +
+                                                     fingerprint),
                                      (index / Handle().bytes()), Parameter(), const_true(), ModulusRemainder()));
         size_t alignment = Handle().bytes();
         index += Handle().bytes();
@@ -324,13 +335,16 @@ public:
     const std::map<std::string, Function> &env;
     int memoize_instance;
     const std::string &top_level_name;
+    const std::string &fingerprint;
     const std::vector<Function> &outputs;
 
     InjectMemoization(const std::map<std::string, Function> &e,
                       int memoize_instance,
                       const std::string &name,
+                      const std::string &fingerprint,
                       const std::vector<Function> &outputs)
-        : env(e), memoize_instance(memoize_instance), top_level_name(name), outputs(outputs) {
+        : env(e), memoize_instance(memoize_instance), top_level_name(name),
+          fingerprint(fingerprint), outputs(outputs) {
     }
 
 private:
@@ -363,7 +377,7 @@ private:
 
             Stmt mutated_body = mutate(op->body);
 
-            KeyInfo key_info(f, top_level_name, memoize_instance);
+            KeyInfo key_info(f, top_level_name, fingerprint, memoize_instance);
 
             std::string cache_key_name = op->name + ".cache_key";
             std::string cache_result_name = op->name + ".cache_result";
@@ -433,7 +447,7 @@ private:
                 return ProducerConsumer::make(op->name, op->is_producer, mutated_body);
             } else {
                 const Function f(iter->second);
-                KeyInfo key_info(f, top_level_name, memoize_instance);
+                KeyInfo key_info(f, top_level_name, fingerprint, memoize_instance);
 
                 std::string cache_key_name = op->name + ".cache_key";
                 std::string computed_bounds_name = op->name + ".computed_bounds.buffer";
@@ -460,14 +474,31 @@ private:
 
 Stmt inject_memoization(const Stmt &s, const std::map<std::string, Function> &env,
                         const std::string &name,
-                        const std::vector<Function> &outputs) {
+                        const std::vector<Function> &outputs,
+                        const Target &target) {
     // Cache keys use the addresses of names of Funcs. For JIT, a
     // counter for the pipeline is needed as the address may be reused
     // across pipelines. This isn't a problem when using full names as
     // the function names already are uniquefied by a counter.
     static std::atomic<int> memoize_instance{0};
 
-    InjectMemoization injector(env, memoize_instance++, name, outputs);
+    // Neither of those mean anything to another process, so the names
+    // also carry a hash of the target and the loop nests of the whole
+    // pipeline. A memoized result depends on the code of its producers
+    // too, so hashing just the memoized Func wouldn't be enough. Use
+    // FNV-1a rather than std::hash, so that it doesn't vary between
+    // builds of Halide.
+    std::ostringstream code;
+    code << target << "\n"
+         << s;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : code.str()) {
+        hash = (hash ^ (uint8_t)c) * 0x100000001b3ULL;
+    }
+    std::ostringstream fingerprint;
+    fingerprint << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+    InjectMemoization injector(env, memoize_instance++, name, fingerprint.str(), outputs);
 
     return injector.mutate(s);
 }
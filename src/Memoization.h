@@ -13,6 +13,9 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 class Function;
@@ -20,12 +23,14 @@ class Function;
 /** Transform pipeline calls for Funcs scheduled with memoize to do a
  *  lookup call to the runtime cache implementation, and if there is a
  *  miss, compute the results and call the runtime to store it back to
- *  the cache.
+ *  the cache. The cache keys include a hash of the pipeline's code and
+ *  the target, so that results can be shared between processes.
  *  Should leave non-memoized Funcs unchanged.
  */
 Stmt inject_memoization(const Stmt &s, const std::map<std::string, Function> &env,
                         const std::string &name,
-                        const std::vector<Function> &outputs);
+                        const std::vector<Function> &outputs,
+                        const Target &target);
 
 /** This should be called after Storage Flattening has added Allocation
  *  IR nodes. It connects the memoization cache lookups to the Allocations
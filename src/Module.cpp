@@ -18,6 +18,7 @@
 #include "Pipeline.h"
 #include "PythonExtensionGen.h"
 #include "StmtToHtml.h"
+#include "ThreadPool.h"
 
 using Halide::Internal::debug;
 
@@ -605,7 +606,25 @@ void Module::compile(const std::map<Output, std::string> &output_files) const {
             // at the same time, so there is no meaningful performance advantage
             // to be had.
             TemporaryObjectFileDir temp_dir;
-            {
+            const int codegen_threads = llvm_codegen_threads();
+            if (codegen_threads > 1) {
+                // Compile the module as several objects in parallel. The
+                // static library bundles them back together.
+                auto objects = compile_llvm_module_to_objects(*llvm_module, codegen_threads);
+                size_t total_size = 0;
+                for (size_t i = 0; i < objects.size(); i++) {
+                    std::string object = temp_dir.add_temp_object_file(output_files.at(Output::static_library), "_" + std::to_string(i), target());
+                    debug(1) << "Module.compile(): temporary object " << object << "\n";
+                    std::ofstream file(object, std::ios::binary);
+                    file.write(objects[i].data(), objects[i].size());
+                    file.close();
+                    internal_assert(!file.fail()) << "Failed to write " << object << "\n";
+                    total_size += objects[i].size();
+                }
+                if (logger && !contains(output_files, Output::object)) {
+                    logger->record_object_code_size(total_size);
+                }
+            } else {
                 std::string object = temp_dir.add_temp_object_file(output_files.at(Output::static_library), "", target());
                 debug(1) << "Module.compile(): temporary object " << object << "\n";
                 auto out = make_raw_fd_ostream(object);
@@ -742,6 +761,11 @@ public:
         }
     }
 
+    explicit ScopedCompilerLogger(std::unique_ptr<CompilerLogger> compiler_logger) {
+        internal_assert(!get_compiler_logger());
+        set_compiler_logger(std::move(compiler_logger));
+    }
+
     ~ScopedCompilerLogger() {
         set_compiler_logger(nullptr);
     }
@@ -754,7 +778,8 @@ void compile_multitarget(const std::string &fn_name,
                          const std::vector<Target> &targets,
                          const std::vector<std::string> &suffixes,
                          const ModuleFactory &module_factory,
-                         const CompilerLoggerFactory &compiler_logger_factory) {
+                         const CompilerLoggerFactory &compiler_logger_factory,
+                         int num_threads) {
     validate_outputs(output_files);
 
     user_assert(!fn_name.empty()) << "Function name must be specified.\n";
@@ -829,6 +854,20 @@ void compile_multitarget(const std::string &fn_name,
     std::vector<LoweredArgument> base_target_args;
     std::vector<AutoSchedulerResults> auto_scheduler_results;
 
+    // The sub-targets are independent, so they can be compiled
+    // concurrently. Everything else is done serially, in target order,
+    // so that the outputs don't depend on the order in which the
+    // sub-targets finish.
+    struct SubTarget {
+        std::string fn_name;
+        Target target;
+        std::map<Output, std::string> outputs;
+        std::unique_ptr<Internal::CompilerLogger> compiler_logger;
+        std::vector<LoweredArgument> args;
+        AutoSchedulerResults auto_scheduler_results;
+    };
+    std::vector<SubTarget> sub_targets(targets.size());
+
     for (size_t i = 0; i < targets.size(); ++i) {
         const Target &target = targets[i];
 
@@ -839,14 +878,16 @@ void compile_multitarget(const std::string &fn_name,
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
         // Some features must match across all targets.
-        static const std::array<Target::Feature, 9> must_match_features = {{
+        static const std::array<Target::Feature, 11> must_match_features = {{
             Target::ASAN,
+            Target::BatchEntryPoint,
             Target::CPlusPlusMangling,
             Target::Debug,
             Target::JIT,
             Target::Matlab,
             Target::MSAN,
             Target::NoRuntime,
+            Target::ProfileLowering,
             Target::TSAN,
             Target::UserContext,
         }};
@@ -859,41 +900,131 @@ void compile_multitarget(const std::string &fn_name,
 
         // Each sub-target has a function name that is the 'real' name plus a suffix
         std::string suffix = suffix_for_entry(i);
-        std::string sub_fn_name = needs_wrapper ? (fn_name + suffix) : fn_name;
+        SubTarget &sub = sub_targets[i];
+        sub.fn_name = needs_wrapper ? (fn_name + suffix) : fn_name;
 
         // We always produce the runtime separately, so add NoRuntime explicitly.
         // Matlab should be added to the wrapper pipeline below, instead of each sub-pipeline.
-        Target sub_fn_target = target.with_feature(Target::NoRuntime);
+        sub.target = target.with_feature(Target::NoRuntime);
         if (needs_wrapper) {
-            sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
+            sub.target = sub.target.without_feature(Target::Matlab);
         }
 
+        sub.outputs = add_suffixes(output_files, suffix);
+        if (contains(output_files, Output::static_library)) {
+            sub.outputs[Output::object] = temp_obj_dir.add_temp_object_file(output_files.at(Output::static_library), suffix, target);
+            sub.outputs.erase(Output::static_library);
+        }
+        sub.outputs.erase(Output::registration);
+        sub.outputs.erase(Output::schedule);
+        sub.outputs.erase(Output::c_header);
+        if (contains(sub.outputs, Output::compiler_log)) {
+            sub.outputs[Output::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(Output::compiler_log), suffix, target);
+        }
+
+        if (compiler_logger_factory) {
+            sub.compiler_logger = compiler_logger_factory(sub.fn_name, sub.target);
+        }
+    }
+
+    // Each sub-target takes its unique names from its own copy of the
+    // counters, all starting from the same state, so that the names
+    // (and hence the outputs) are the same whether or not the
+    // sub-targets are compiled concurrently.
+    std::vector<UniqueNameCounters> name_counters(targets.size());
+
+    const auto compile_sub_target = [&](size_t i) {
+        SubTarget &sub = sub_targets[i];
+        ScopedUniqueNameCounters use_counters(name_counters[i]);
+        Module sub_module = module_factory(sub.fn_name, sub.target);
+        sub.args = sub_module.get_function_by_name(sub.fn_name).args;
+        debug(1) << "compile_multitarget: compile_sub_target " << sub.outputs[Output::object] << "\n";
+        sub_module.compile(sub.outputs);
+        const auto *r = sub_module.get_auto_scheduler_results();
+        sub.auto_scheduler_results = r ? *r : AutoSchedulerResults();
+    };
+
+    // The compiler logger is process-wide, so logging (including
+    // profiling lowering, which records to the active logger if there
+    // is one) forces a serial compile.
+    bool any_compiler_logger = base_target.has_feature(Target::ProfileLowering) ||
+                               get_env_variable("HL_PROFILE_LOWERING") == "1";
+    for (const auto &sub : sub_targets) {
+        any_compiler_logger |= (sub.compiler_logger != nullptr);
+    }
+    if (num_threads <= 0) {
+        num_threads = (int)ThreadPool<void>::num_processors_online();
+    }
+    num_threads = std::min(num_threads, (int)targets.size());
+    if (any_compiler_logger) {
+        num_threads = 1;
+    }
+
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            ScopedCompilerLogger activate(std::move(sub_targets[i].compiler_logger));
+            compile_sub_target(i);
+        }
+    } else {
+        debug(1) << "compile_multitarget: compiling " << targets.size() << " sub-targets on " << num_threads << " threads\n";
+#ifdef HALIDE_WITH_EXCEPTIONS
+        // Errors in a worker are rethrown on this thread, in target order.
+        std::vector<std::exception_ptr> errors(targets.size());
+#endif
         {
-            ScopedCompilerLogger activate(compiler_logger_factory, sub_fn_name, sub_fn_target);
-            Module sub_module = module_factory(sub_fn_name, sub_fn_target);
-            // Re-assign every time -- should be the same across all targets anyway,
-            // but base_target is always the last one we encounter.
-            base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
-            auto sub_out = add_suffixes(output_files, suffix);
-            if (contains(output_files, Output::static_library)) {
-                sub_out[Output::object] = temp_obj_dir.add_temp_object_file(output_files.at(Output::static_library), suffix, target);
-                sub_out.erase(Output::static_library);
+            // Split the codegen threads each sub-target may use between
+            // the sub-targets compiling at once, so that the two levels
+            // together don't oversubscribe the machine.
+            const int codegen_threads = std::max(llvm_codegen_threads() / num_threads, 1);
+            ThreadPool<void> pool(num_threads);
+            std::vector<std::future<void>> results;
+            for (size_t i = 0; i < targets.size(); ++i) {
+                results.push_back(pool.async([&, i]() {
+                    ScopedCodegenThreadLimit limit(codegen_threads);
+#ifdef HALIDE_WITH_EXCEPTIONS
+                    try {
+                        compile_sub_target(i);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+#else
+                    compile_sub_target(i);
+#endif
+                }));
             }
-            sub_out.erase(Output::registration);
-            sub_out.erase(Output::schedule);
-            sub_out.erase(Output::c_header);
-            if (contains(sub_out, Output::compiler_log)) {
-                sub_out[Output::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(Output::compiler_log), suffix, target);
+            for (auto &r : results) {
+                r.get();
+            }
+        }
+#ifdef HALIDE_WITH_EXCEPTIONS
+        for (const auto &e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
             }
-            debug(1) << "compile_multitarget: compile_sub_target " << sub_out[Output::object] << "\n";
-            sub_module.compile(sub_out);
-            const auto *r = sub_module.get_auto_scheduler_results();
-            auto_scheduler_results.push_back(r ? *r : AutoSchedulerResults());
         }
+#endif
+    }
+
+    for (const auto &c : name_counters) {
+        c.merge_into_global();
+    }
 
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const Target &target = targets[i];
+        const SubTarget &sub = sub_targets[i];
+
+        // Should be the same across all targets anyway, but base_target
+        // is always the last one.
+        base_target_args = sub.args;
+        auto_scheduler_results.push_back(sub.auto_scheduler_results);
+
+        // ProfileLowering only changes how the compiler runs, so it
+        // must not be checked at runtime or passed on to the runtime.
         uint64_t cur_target_features[kFeaturesWordCount] = {0};
         for (int i = 0; i < Target::FeatureEnd; ++i) {
+            if (i == Target::ProfileLowering) {
+                continue;
+            }
             if (target.has_feature((Target::Feature)i)) {
                 cur_target_features[i >> 6] |= ((uint64_t)1) << (i & 63);
             }
@@ -917,7 +1048,7 @@ void compile_multitarget(const std::string &fn_name,
         }
 
         wrapper_args.push_back(can_use != 0);
-        wrapper_args.emplace_back(sub_fn_name);
+        wrapper_args.emplace_back(sub.fn_name);
     }
 
     // If we haven't specified "no runtime", build a runtime with the base target
@@ -220,12 +220,23 @@ std::map<Output, std::string> compile_standalone_runtime(const std::map<Output,
 using ModuleFactory = std::function<Module(const std::string &fn_name, const Target &target)>;
 using CompilerLoggerFactory = std::function<std::unique_ptr<Internal::CompilerLogger>(const std::string &fn_name, const Target &target)>;
 
+/** Compile a pipeline for each of several targets, plus a wrapper that
+ * picks the best one for the running machine at runtime.
+ *
+ * The targets are compiled on up to num_threads threads at once (zero
+ * means one per core); if more than one is used, module_factory must
+ * be safe to call concurrently. The outputs don't depend on
+ * num_threads. Compilation is always serial while a CompilerLogger is
+ * active or lowering is being profiled. Sub-targets compiled at once
+ * share the threads HL_LLVM_CODEGEN_THREADS allows for code
+ * generation. */
 void compile_multitarget(const std::string &fn_name,
                          const std::map<Output, std::string> &output_files,
                          const std::vector<Target> &targets,
                          const std::vector<std::string> &suffixes,
                          const ModuleFactory &module_factory,
-                         const CompilerLoggerFactory &compiler_logger_factory = nullptr);
+                         const CompilerLoggerFactory &compiler_logger_factory = nullptr,
+                         int num_threads = 1);
 
 }  // namespace Halide
 
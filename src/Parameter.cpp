@@ -161,7 +161,7 @@ Buffer<> Parameter::buffer() const {
 }
 
 const halide_buffer_t *Parameter::raw_buffer() const {
-    if (!is_buffer()) {
+    if (!is_buffer() || !contents->buffer.defined()) {
         return nullptr;
     }
     return contents->buffer.raw_buffer();
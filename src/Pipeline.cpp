@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <atomic>
+#include <mutex>
 #include <utility>
 
 #include "Argument.h"
@@ -77,6 +78,12 @@ struct PipelineContents {
     // Cached compiled JavaScript and/or wasm if defined */
     WasmModule wasm_module;
 
+    // Guards the cached compiled state above and the inferred
+    // arguments, so that threads realizing the same Pipeline compile
+    // it once and never see it half-built. Recursive because
+    // realize() holds it across its call to compile_jit().
+    std::recursive_mutex jit_mutex;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
@@ -555,6 +562,8 @@ void Pipeline::compile_jit(const Target &target_arg) {
     user_assert(defined()) << "Pipeline is undefined\n";
     user_assert(!target_arg.has_unknowns()) << "Cannot compile_jit() for target '" << target_arg << "'\n";
 
+    std::lock_guard<std::recursive_mutex> lock(contents->jit_mutex);
+
     Target target(target_arg);
     target.set_feature(Target::JIT);
     target.set_feature(Target::UserContext);
@@ -571,8 +580,6 @@ void Pipeline::compile_jit(const Target &target_arg) {
     // Clear all cached info in case there is an error.
     contents->invalidate_cache();
 
-    contents->jit_target = target;
-
     // Infer an arguments vector
     infer_arguments();
 
@@ -617,6 +624,7 @@ void Pipeline::compile_jit(const Target &target_arg) {
             contents->module.name(),
             lowered_externs,
             make_externs_jit_module(target, lowered_externs));
+        contents->jit_target = target;
         return;
     }
 
@@ -638,6 +646,9 @@ void Pipeline::compile_jit(const Target &target_arg) {
     }
 
     contents->jit_module = jit_module;
+    // Only record the target once the module for it exists, so that
+    // get_compiled_jit_target() never sees one without the other.
+    contents->jit_target = target;
 }
 
 void Pipeline::set_error_handler(void (*handler)(void *, const char *)) {
@@ -1041,7 +1052,8 @@ Pipeline::make_externs_jit_module(const Target &target,
     return result;
 }
 
-int Pipeline::call_jit_code(const Target &target, const JITCallArgs &args) {
+int Pipeline::call_jit_code(const Target &target, const JITModule &jit_module,
+                            WasmModule &wasm_module, const JITCallArgs &args) {
 #if defined(__has_feature)
 #if __has_feature(memory_sanitizer)
     user_warning << "MSAN does not support JIT compilers of any sort, and will report "
@@ -1051,10 +1063,10 @@ int Pipeline::call_jit_code(const Target &target, const JITCallArgs &args) {
 #endif
 #endif
     if (target.arch == Target::WebAssembly) {
-        internal_assert(contents->wasm_module.contents.defined());
-        return contents->wasm_module.run(args.store);
+        internal_assert(wasm_module.contents.defined());
+        return wasm_module.run(args.store);
     }
-    return contents->jit_module.argv_function()(args.store);
+    return jit_module.argv_function()(args.store);
 }
 
 void Pipeline::realize(RealizationArg outputs, const Target &t,
@@ -1064,15 +1076,6 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
 
     debug(2) << "Realizing Pipeline for " << target << "\n";
 
-    if (target.has_unknowns()) {
-        // If we've already jit-compiled for a specific target, use that.
-        target = get_compiled_jit_target();
-        if (target.has_unknowns()) {
-            // Otherwise get the target from the environment
-            target = get_jit_target_from_environment();
-        }
-    }
-
     // We need to make a context for calling the jitted function to
     // carry the the set of custom handlers. Here's how handlers get
     // called when running jitted code:
@@ -1095,7 +1098,20 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // user_context is just a pointer to a JITUserContext, which is a
     // member of the JITFuncCallContext which we will declare now:
 
-    // Ensure the module is compiled.
+    // Ensure the module is compiled. Other threads may be realizing
+    // this Pipeline too, so hold the lock until we have the
+    // arguments and our own references to the compiled code. The
+    // code itself runs without it. The compiled target is only
+    // stable under the lock, so resolve the target here too.
+    std::unique_lock<std::recursive_mutex> lock(contents->jit_mutex);
+    if (target.has_unknowns()) {
+        // If we've already jit-compiled for a specific target, use that.
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            // Otherwise get the target from the environment
+            target = get_jit_target_from_environment();
+        }
+    }
     compile_jit(target);
 
     // This has to happen after a runtime has been compiled in compile_jit.
@@ -1106,6 +1122,10 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     prepare_jit_call_arguments(outputs, target, param_map,
                                &user_context_storage, false, args);
 
+    JITModule jit_module = contents->jit_module;
+    WasmModule wasm_module = contents->wasm_module;
+    lock.unlock();
+
     // The handlers in the jit_context default to the default handlers
     // in the runtime of the shared module (e.g. halide_print_impl,
     // default_trace). As an example, here's what happens with a
@@ -1144,15 +1164,99 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // exception.
 
     debug(2) << "Calling jitted function\n";
-    int exit_status = call_jit_code(target, args);
+    int exit_status = call_jit_code(target, jit_module, wasm_module, args);
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
     // If we're profiling, report runtimes and reset profiler stats.
     if (target.has_feature(Target::Profile)) {
         JITModule::Symbol report_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_report");
+            jit_module.find_symbol_by_name("halide_profiler_report");
         JITModule::Symbol reset_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
+            jit_module.find_symbol_by_name("halide_profiler_reset");
+        if (report_sym.address && reset_sym.address) {
+            void *uc = &jit_context.jit_context;
+            void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
+            report_fn_ptr(uc);
+
+            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
+            reset_fn_ptr();
+        }
+    }
+
+    jit_context.finalize(exit_status);
+}
+
+void Pipeline::realize_batch(std::vector<Realization> &outputs,
+                             const std::vector<ParamMap> &param_maps,
+                             const Target &t) {
+    Target target = t;
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(param_maps.empty() || param_maps.size() == outputs.size())
+        << "realize_batch was given " << outputs.size() << " output Realizations but "
+        << param_maps.size() << " ParamMaps\n";
+
+    if (outputs.empty()) {
+        return;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(contents->jit_mutex);
+    if (target.has_unknowns()) {
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            target = get_jit_target_from_environment();
+        }
+    }
+    compile_jit(target);
+
+    // One context, and so one error buffer, is shared by the whole
+    // batch. The error buffer tolerates concurrent writers.
+    JITFuncCallContext jit_context(jit_handlers());
+    void *user_context_storage = &jit_context.jit_context;
+
+    // Lay the argument lists out one after another.
+    const size_t num_args = contents->inferred_args.size() + outputs[0].size();
+    vector<const void *> batch_args(num_args * outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        user_assert(outputs[i].size() == outputs[0].size())
+            << "All the Realizations passed to realize_batch must have the same number of Buffers\n";
+        RealizationArg output(outputs[i]);
+        JITCallArgs args(num_args);
+        prepare_jit_call_arguments(output, target,
+                                   param_maps.empty() ? ParamMap::empty_map() : param_maps[i],
+                                   &user_context_storage, false, args);
+        std::copy(args.store, args.store + num_args, batch_args.begin() + i * num_args);
+    }
+
+    JITModule jit_module = contents->jit_module;
+    WasmModule wasm_module = contents->wasm_module;
+    lock.unlock();
+
+    int exit_status = 0;
+    if (target.arch == Target::WebAssembly) {
+        // The wasm executor can't hand tasks to the host's thread
+        // pool, so run the batch in order.
+        for (size_t i = 0; i < outputs.size() && exit_status == 0; i++) {
+            exit_status = wasm_module.run(&batch_args[i * num_args]);
+        }
+    } else {
+        JITModule::Symbol do_batch_sym = jit_module.find_symbol_by_name("halide_do_batch");
+        internal_assert(do_batch_sym.address) << "Could not find halide_do_batch in the JIT runtime\n";
+        auto do_batch = (int (*)(void *, int (*)(void **), void **, int, int))(do_batch_sym.address);
+        // halide_do_batch uses the void ** signature of the generated
+        // argv functions, but only passes slices of the array on to the
+        // argv function, which never writes to it (the JIT calls the
+        // same function through a const void ** elsewhere). So casting
+        // away the const is safe.
+        exit_status = do_batch(&jit_context.jit_context,
+                               (int (*)(void **))jit_module.argv_function(),
+                               const_cast<void **>(batch_args.data()), (int)num_args, (int)outputs.size());
+    }
+
+    if (target.has_feature(Target::Profile)) {
+        JITModule::Symbol report_sym =
+            jit_module.find_symbol_by_name("halide_profiler_report");
+        JITModule::Symbol reset_sym =
+            jit_module.find_symbol_by_name("halide_profiler_reset");
         if (report_sym.address && reset_sym.address) {
             void *uc = &jit_context.jit_context;
             void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
@@ -1166,8 +1270,144 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     jit_context.finalize(exit_status);
 }
 
+struct PreparedRealizationContents {
+    mutable RefCount ref_count;
+
+    // Keeps the compiled code alive.
+    JITModule jit_module;
+    WasmModule wasm_module;
+    Target target;
+
+    JITFuncCallContext jit_context;
+    void *user_context_storage = nullptr;
+
+    // The arguments to the argv function, with the slots for
+    // ImageParams refreshed before each call.
+    std::vector<const void *> args;
+    std::vector<std::pair<size_t, Parameter>> buffer_params;
+
+    // Keeps the scalar Params and the output Buffers alive, so that
+    // the addresses in args stay valid.
+    std::vector<Parameter> scalar_params;
+    std::vector<Buffer<>> outputs;
+
+    void (*profiler_report)(void *) = nullptr;
+    void (*profiler_reset)() = nullptr;
+
+    PreparedRealizationContents(const JITHandlers &handlers)
+        : jit_context(handlers) {
+    }
+};
+
+namespace Internal {
+template<>
+RefCount &ref_count<PreparedRealizationContents>(const PreparedRealizationContents *p) noexcept {
+    return p->ref_count;
+}
+
+template<>
+void destroy<PreparedRealizationContents>(const PreparedRealizationContents *p) {
+    delete p;
+}
+}  // namespace Internal
+
+Pipeline::PreparedRealization Pipeline::prepare_realize(RealizationArg outputs, const Target &t,
+                                                        const ParamMap &param_map) {
+    Target target = t;
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+
+    std::lock_guard<std::recursive_mutex> lock(contents->jit_mutex);
+    if (target.has_unknowns()) {
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            target = get_jit_target_from_environment();
+        }
+    }
+    compile_jit(target);
+
+    PreparedRealization result;
+    result.contents = new PreparedRealizationContents(jit_handlers());
+    PreparedRealizationContents &prepared = *result.contents;
+    prepared.jit_module = contents->jit_module;
+    prepared.wasm_module = contents->wasm_module;
+    prepared.target = target;
+    prepared.user_context_storage = &prepared.jit_context.jit_context;
+
+    {
+        JITCallArgs args(contents->inferred_args.size() + outputs.size());
+        prepare_jit_call_arguments(outputs, target, param_map,
+                                   &prepared.user_context_storage, false, args);
+        prepared.args.assign(args.store, args.store + args.size);
+    }
+
+    const bool no_param_map = &param_map == &ParamMap::empty_map();
+    for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+        const InferredArgument &arg = contents->inferred_args[i];
+        if (!arg.param.defined() || arg.param.same_as(contents->user_context_arg.param)) {
+            continue;
+        }
+        Buffer<> *buf_out_param = nullptr;
+        const Parameter &p = no_param_map ? arg.param : param_map.map(arg.param, buf_out_param);
+        if (p.is_buffer()) {
+            prepared.buffer_params.emplace_back(i, p);
+        } else {
+            prepared.scalar_params.push_back(p);
+        }
+    }
+
+    if (outputs.r) {
+        for (size_t i = 0; i < outputs.r->size(); i++) {
+            prepared.outputs.push_back((*outputs.r)[i]);
+        }
+    } else if (outputs.buffer_list) {
+        prepared.outputs = *outputs.buffer_list;
+    }
+
+    if (target.has_feature(Target::Profile)) {
+        JITModule::Symbol report_sym =
+            contents->jit_module.find_symbol_by_name("halide_profiler_report");
+        JITModule::Symbol reset_sym =
+            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
+        if (report_sym.address && reset_sym.address) {
+            prepared.profiler_report = (void (*)(void *))(report_sym.address);
+            prepared.profiler_reset = (void (*)())(reset_sym.address);
+        }
+    }
+
+    return result;
+}
+
+bool Pipeline::PreparedRealization::defined() const {
+    return contents.defined();
+}
+
+void Pipeline::PreparedRealization::realize() {
+    user_assert(defined()) << "Can't realize an undefined PreparedRealization\n";
+
+    PreparedRealizationContents &prepared = *contents;
+    for (const auto &p : prepared.buffer_params) {
+        prepared.args[p.first] = p.second.raw_buffer();
+    }
+
+    int exit_status;
+    if (prepared.target.arch == Target::WebAssembly) {
+        exit_status = prepared.wasm_module.run(prepared.args.data());
+    } else {
+        exit_status = prepared.jit_module.argv_function()(prepared.args.data());
+    }
+
+    if (prepared.profiler_report) {
+        prepared.profiler_report(&prepared.jit_context.jit_context);
+        prepared.profiler_reset();
+    }
+
+    prepared.jit_context.finalize(exit_status);
+}
+
 void Pipeline::infer_input_bounds(RealizationArg outputs, const Target &target, const ParamMap &param_map) {
+    user_assert(defined()) << "Can't infer input bounds on an undefined Pipeline\n";
     user_assert(!target.has_feature(Target::NoBoundsQuery)) << "You may not call infer_input_bounds() with Target::NoBoundsQuery set.";
+    std::lock_guard<std::recursive_mutex> lock(contents->jit_mutex);
     compile_jit(target);
 
     // This has to happen after a runtime has been compiled in compile_jit.
@@ -1218,7 +1458,8 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const Target &target,
         }
 
         Internal::debug(2) << "Calling jitted function\n";
-        int exit_status = call_jit_code(contents->jit_target, args);
+        int exit_status = call_jit_code(contents->jit_target, contents->jit_module,
+                                        contents->wasm_module, args);
         jit_context.report_if_error(exit_status);
         Internal::debug(2) << "Back from jitted function\n";
         bool changed = false;
@@ -1285,6 +1526,7 @@ void Pipeline::infer_input_bounds(const std::vector<int32_t> &sizes,
 
 void Pipeline::invalidate_cache() {
     if (defined()) {
+        std::lock_guard<std::recursive_mutex> lock(contents->jit_mutex);
         contents->invalidate_cache();
     }
 }
@@ -25,6 +25,7 @@ namespace Halide {
 struct Argument;
 class Func;
 struct PipelineContents;
+struct PreparedRealizationContents;
 
 /** A struct representing the machine parameters to generate the auto-scheduled
  * code for. */
@@ -53,6 +54,7 @@ struct MachineParams {
 
 namespace Internal {
 class IRMutator;
+struct WasmModule;
 }  // namespace Internal
 
 /**
@@ -136,6 +138,35 @@ public:
         }
     };
 
+    /** A handle to a jit-compiled Pipeline with its output buffers
+     * and the locations of its arguments already worked out, made by
+     * Pipeline::prepare_realize. Calling it runs the compiled code
+     * directly, without the target resolution, handler setup,
+     * argument marshalling and allocation that Pipeline::realize
+     * does on every call, which matters for pipelines that are
+     * realized many times over small outputs.
+     *
+     * The values of Params and the Buffers bound to ImageParams are
+     * read at each call, so they may be changed between calls. The
+     * set of output buffers, the ParamMap, and the custom handlers
+     * are fixed when the handle is made. The handle keeps the
+     * compiled code alive, even if the Pipeline is later recompiled
+     * or destroyed. A handle may not be used from more than one
+     * thread at a time; make one per thread instead. */
+    class PreparedRealization {
+        Internal::IntrusivePtr<PreparedRealizationContents> contents;
+        friend class Pipeline;
+
+    public:
+        PreparedRealization() = default;
+
+        /** Check if this handle refers to a prepared Pipeline. */
+        bool defined() const;
+
+        /** Run the compiled Pipeline into the prepared output buffers. */
+        void realize();
+    };
+
 private:
     Internal::IntrusivePtr<PipelineContents> contents;
 
@@ -154,7 +185,8 @@ private:
 
     static AutoSchedulerFn find_autoscheduler(const std::string &autoscheduler_name);
 
-    int call_jit_code(const Target &target, const JITCallArgs &args);
+    static int call_jit_code(const Target &target, const Internal::JITModule &jit_module,
+                             Internal::WasmModule &wasm_module, const JITCallArgs &args);
 
     // Get the value of contents->jit_target, but reality-check that the contents
     // sensibly match the value. Return Target() if not jitted.
@@ -515,10 +547,41 @@ public:
      * each individual output Func, all Buffers must have the same
      * shape, but the shape can vary across the different output
      * Funcs. This form of realize does *not* automatically copy data
-     * back from the GPU. */
+     * back from the GPU.
+     *
+     * The realize methods may be called on the same Pipeline from
+     * many threads at once. The first call compiles the Pipeline and
+     * the others wait for it; after that the compiled code is shared
+     * and each call runs it with its own user context, error buffer
+     * and arguments. To give each thread its own input values, pass
+     * them in a ParamMap rather than with Param::set or
+     * ImageParam::set, which change the values seen by every
+     * thread. Scheduling the Pipeline or setting custom handlers
+     * while other threads are realizing it is not safe. */
     void realize(RealizationArg output, const Target &target = Target(),
                  const ParamMap &param_map = ParamMap::empty_map());
 
+    /** Realize this Pipeline once into each of a batch of output
+     * Realizations, taking the inputs for each from the
+     * corresponding ParamMap, or from the currently bound Params and
+     * ImageParams if no ParamMaps are given. All of the calls are
+     * prepared up front and then run as the tasks of one parallel
+     * loop (see halide_do_batch), which is much cheaper than a loop
+     * of realize calls when the outputs are small. Parallel loops
+     * inside the Pipeline run nested inside the batch. Every
+     * Realization must have the same number of Buffers. */
+    void realize_batch(std::vector<Realization> &outputs,
+                       const std::vector<ParamMap> &param_maps = {},
+                       const Target &target = Target());
+
+    /** Compile this Pipeline if needed, and make a handle that
+     * realizes it into the given output buffers. Halide::Buffer and
+     * Realization outputs are kept alive by the handle; raw
+     * halide_buffer_t and Runtime::Buffer outputs must outlive it. See
+     * PreparedRealization. */
+    PreparedRealization prepare_realize(RealizationArg output, const Target &target = Target(),
+                                        const ParamMap &param_map = ParamMap::empty_map());
+
     /** For a given size of output, or a given set of output buffers,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
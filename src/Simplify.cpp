@@ -3,9 +3,13 @@
 
 #include "CSE.h"
 #include "CompilerLogger.h"
+#include "IREquality.h"
 #include "IRMutator.h"
 #include "Substitute.h"
 
+#include <cstring>
+#include <unordered_map>
+
 namespace Halide {
 namespace Internal {
 
@@ -340,10 +344,232 @@ Simplify::ScopedFact::~ScopedFact() {
     }
 }
 
+// Lowering and bounds inference call simplify on many Exprs that are
+// equal by value but not by identity (e.g. the same index
+// computations repeated across unrolled or specialized code), so we
+// memoize it while a ScopedSimplifyMemo is alive. A fresh simplifier
+// has no knowledge of lets or facts, so the result depends only on the
+// Expr, remove_dead_lets, and the bounds and alignment of its free
+// variables, which together make up the key. Each memo belongs to a
+// single thread.
+class SimplifyMemo {
+public:
+    struct Key {
+        Expr expr;
+        bool remove_dead_lets = false;
+        std::vector<std::pair<std::string, Simplify::ExprInfo>> info;
+        uint64_t hash = 0;
+    };
+
+    // Build the key for simplifying e with the given simplifier. Returns
+    // false if the Expr shouldn't be memoized.
+    static bool make_key(const Expr &e, const Simplify &simplifier, Key *key);
+
+    // On a hit, sets result and returns true.
+    bool lookup(const Key &key, Expr *result);
+
+    void insert(Key &&key, const Expr &result);
+
+private:
+    struct Entry {
+        Key key;
+        Expr result;
+    };
+
+    // The memo is emptied when it exceeds this many entries.
+    static constexpr size_t max_entries = 16 * 1024;
+
+    std::unordered_multimap<uint64_t, Entry> entries;
+
+    static bool same_info(const Key &a, const Key &b);
+};
+
+namespace {
+
+thread_local SimplifyMemo *current_simplify_memo = nullptr;
+
+uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+// Computes a structural hash of an Expr, collects its free variables,
+// and checks that it's safe to memoize. IRComparer compares Variables,
+// Loads, and Calls by name alone, so we don't memoize Exprs that refer
+// to Parameters, Buffers, Functions, or reduction domains; a cached
+// result could otherwise refer to a different object of the same name.
+class SimplifyMemoKeyBuilder : public IRGraphVisitor {
+public:
+    uint64_t hash = 0;
+    int nodes = 0;
+    bool memoizable = true;
+    std::set<std::string> vars;
+    std::set<const IRNode *> seen;
+
+    using IRGraphVisitor::include;
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) override {
+        if (!memoizable || !seen.insert(e.get()).second) {
+            return;
+        }
+        nodes++;
+        hash = hash_combine(hash, (uint64_t)e.node_type());
+        hash = hash_combine(hash, ((uint64_t)e.type().code() << 32) |
+                                      ((uint64_t)e.type().bits() << 16) |
+                                      (uint64_t)e.type().lanes());
+        e.accept(this);
+    }
+
+    void visit(const IntImm *op) override {
+        hash = hash_combine(hash, (uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        hash = hash_combine(hash, op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        uint64_t bits;
+        memcpy(&bits, &op->value, sizeof(bits));
+        hash = hash_combine(hash, bits);
+    }
+
+    void visit(const Variable *op) override {
+        if (op->param.defined() || op->image.defined() || op->reduction_domain.defined()) {
+            memoizable = false;
+            return;
+        }
+        hash = hash_combine(hash, std::hash<std::string>()(op->name));
+        vars.insert(op->name);
+    }
+
+    void visit(const Load *op) override {
+        if (op->param.defined() || op->image.defined()) {
+            memoizable = false;
+            return;
+        }
+        hash = hash_combine(hash, std::hash<std::string>()(op->name));
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->func.defined() || op->param.defined() || op->image.defined()) {
+            memoizable = false;
+            return;
+        }
+        hash = hash_combine(hash, std::hash<std::string>()(op->name));
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Let *op) override {
+        hash = hash_combine(hash, std::hash<std::string>()(op->name));
+        IRGraphVisitor::visit(op);
+    }
+};
+
+}  // namespace
+
+bool SimplifyMemo::make_key(const Expr &e, const Simplify &simplifier, Key *key) {
+    SimplifyMemoKeyBuilder builder;
+    builder.include(e);
+    // Small Exprs are quicker to simplify than to look up.
+    if (!builder.memoizable || builder.nodes < 4) {
+        return false;
+    }
+    uint64_t h = hash_combine(builder.hash, simplifier.remove_dead_lets);
+    for (const auto &v : builder.vars) {
+        if (simplifier.bounds_and_alignment_info.contains(v)) {
+            const Simplify::ExprInfo &info = simplifier.bounds_and_alignment_info.get(v);
+            h = hash_combine(h, std::hash<std::string>()(v));
+            h = hash_combine(h, info.min_defined ? (uint64_t)info.min : 0);
+            h = hash_combine(h, info.max_defined ? (uint64_t)info.max : 0);
+            h = hash_combine(h, (uint64_t)info.alignment.modulus);
+            h = hash_combine(h, (uint64_t)info.alignment.remainder);
+            key->info.emplace_back(v, info);
+        }
+    }
+    key->expr = e;
+    key->remove_dead_lets = simplifier.remove_dead_lets;
+    key->hash = h;
+    return true;
+}
+
+bool SimplifyMemo::same_info(const Key &a, const Key &b) {
+    if (a.remove_dead_lets != b.remove_dead_lets ||
+        a.info.size() != b.info.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.info.size(); i++) {
+        const Simplify::ExprInfo &ia = a.info[i].second, &ib = b.info[i].second;
+        if (a.info[i].first != b.info[i].first ||
+            ia.min_defined != ib.min_defined ||
+            ia.max_defined != ib.max_defined ||
+            (ia.min_defined && ia.min != ib.min) ||
+            (ia.max_defined && ia.max != ib.max) ||
+            ia.alignment.modulus != ib.alignment.modulus ||
+            ia.alignment.remainder != ib.alignment.remainder) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SimplifyMemo::lookup(const Key &key, Expr *result) {
+    auto range = entries.equal_range(key.hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Entry &entry = it->second;
+        if (same_info(key, entry.key) &&
+            graph_equal(key.expr, entry.key.expr)) {
+            // Preserve identity when the simplifier leaves the Expr
+            // alone, as callers check for that with same_as.
+            if (entry.result.same_as(entry.key.expr)) {
+                *result = key.expr;
+            } else {
+                *result = entry.result;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void SimplifyMemo::insert(Key &&key, const Expr &result) {
+    if (entries.size() >= max_entries) {
+        entries.clear();
+    }
+    uint64_t h = key.hash;
+    entries.emplace(h, Entry{std::move(key), result});
+}
+
+ScopedSimplifyMemo::ScopedSimplifyMemo() {
+    if (current_simplify_memo == nullptr) {
+        memo.reset(new SimplifyMemo);
+        current_simplify_memo = memo.get();
+    }
+}
+
+ScopedSimplifyMemo::~ScopedSimplifyMemo() {
+    if (memo) {
+        current_simplify_memo = nullptr;
+    }
+}
+
 Expr simplify(const Expr &e, bool remove_dead_let_stmts,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(remove_dead_let_stmts, &bounds, &alignment).mutate(e, nullptr);
+    Simplify simplifier(remove_dead_let_stmts, &bounds, &alignment);
+    SimplifyMemo *memo = current_simplify_memo;
+    SimplifyMemo::Key key;
+    if (!memo || !SimplifyMemo::make_key(e, simplifier, &key)) {
+        return simplifier.mutate(e, nullptr);
+    }
+    Expr result;
+    if (memo->lookup(key, &result)) {
+        return result;
+    }
+    result = simplifier.mutate(e, nullptr);
+    memo->insert(std::move(key), result);
+    return result;
 }
 
 Stmt simplify(const Stmt &s, bool remove_dead_let_stmts,
@@ -5,6 +5,8 @@
  * Methods for simplifying halide statements and expressions
  */
 
+#include <memory>
+
 #include "Expr.h"
 #include "Interval.h"
 #include "ModulusRemainder.h"
@@ -28,6 +30,26 @@ Expr simplify(const Expr &, bool remove_dead_let_stmts = true,
               const Scope<ModulusRemainder> &alignment = Scope<ModulusRemainder>::empty_scope());
 // @}
 
+class SimplifyMemo;
+
+/** While an object of this type is alive, simplify(Expr) memoizes its
+ * results on the current thread. lower() holds one for the whole of
+ * lowering, so the Exprs the memo keeps alive are released when
+ * lowering finishes. Nested scopes share the outermost one's memo. */
+class ScopedSimplifyMemo {
+public:
+    ScopedSimplifyMemo();
+    ~ScopedSimplifyMemo();
+
+    ScopedSimplifyMemo(const ScopedSimplifyMemo &) = delete;
+    ScopedSimplifyMemo &operator=(const ScopedSimplifyMemo &) = delete;
+    ScopedSimplifyMemo(ScopedSimplifyMemo &&) = delete;
+    ScopedSimplifyMemo &operator=(ScopedSimplifyMemo &&) = delete;
+
+private:
+    std::unique_ptr<SimplifyMemo> memo;
+};
+
 /** Attempt to statically prove an expression is true using the simplifier. */
 bool can_prove(Expr e, const Scope<Interval> &bounds = Scope<Interval>::empty_scope());
 
@@ -0,0 +1,75 @@
+#include "StreamedInput.h"
+#include "Util.h"
+
+#include <utility>
+
+namespace Halide {
+
+StreamedInput::StreamedInput(Type t, int dimensions)
+    : StreamedInput(t, dimensions, Internal::make_entity_name(this, "Halide:.*:StreamedInput", 's')) {
+}
+
+StreamedInput::StreamedInput(Type t, int dimensions, const std::string &name)
+    : source_param(name + "_source"), fetch(name + "_fetch"), func(name) {
+    user_assert(dimensions > 0)
+        << "StreamedInput " << name << " must have at least one dimension.\n";
+    fetch.define_extern("halide_fetch_tile",
+                        {user_context_value(), Expr(source_param)},
+                        t, dimensions, NameMangling::C, DeviceAPI::Host);
+    func(_) = fetch(_);
+    // Extern stages left inline get realized around their innermost
+    // use. Fetch the whole thing up front unless told otherwise.
+    fetch.compute_root();
+}
+
+const std::string &StreamedInput::name() const {
+    return func.name();
+}
+
+Type StreamedInput::type() const {
+    return fetch.output_types()[0];
+}
+
+int StreamedInput::dimensions() const {
+    return fetch.dimensions();
+}
+
+void StreamedInput::set(const halide_tile_source_t *source) {
+    source_param.set(source);
+}
+
+StreamedInput &StreamedInput::stream_at(const Func &consumer, const Var &var, int dim, const Expr &tile_extent) {
+    user_assert(dim >= 0 && dim < dimensions())
+        << "Can't stream " << name() << " over dimension " << dim
+        << " because it only has " << dimensions() << " dimensions.\n";
+    // Fetch each region straight into a fresh buffer, and copy it into
+    // storage that is folded so that it only holds the tile being
+    // consumed and the tile being fetched. The fetch can't write into
+    // the folded storage directly, because the region a tile needs
+    // can straddle the fold, and an extern stage must write to a
+    // region that doesn't.
+    fetch.compute_at(func, Var::outermost());
+    func.store_root()
+        .compute_at(consumer, var)
+        .fold_storage(func.args()[dim], 2 * tile_extent)
+        .async();
+    return *this;
+}
+
+Expr StreamedInput::operator()(std::vector<Expr> args) const {
+    return func(std::move(args));
+}
+
+Expr StreamedInput::operator()(std::vector<Var> args) const {
+    return func(std::move(args));
+}
+
+StreamedInput::operator Func() const {
+    return func;
+}
+
+StreamedInput::operator Argument() const {
+    return source_param;
+}
+
+}  // namespace Halide
@@ -0,0 +1,106 @@
+#ifndef HALIDE_STREAMED_INPUT_H
+#define HALIDE_STREAMED_INPUT_H
+
+/** \file
+ *
+ * Defines StreamedInput, an input to a pipeline that is fetched a
+ * region at a time while the pipeline runs.
+ */
+
+#include <string>
+#include <utility>
+
+#include "Func.h"
+#include "Param.h"
+
+namespace Halide {
+
+/** An input to a pipeline that is too large to pass in as a single
+ * Buffer, such as a huge image on disk. Instead of a buffer, the
+ * pipeline takes a pointer to a halide_tile_source_t, and calls its
+ * fetch callback for each region of the input the pipeline needs, as
+ * it needs it.
+ *
+ * By default the whole input is fetched at once at the root
+ * level. Use stream_at to fetch it tile by tile on a background
+ * thread, one tile ahead of the consumer, so that only two tiles of
+ * the input are in memory at once:
+ \code
+ StreamedInput in(UInt(8), 2, "in");
+ Func blur;
+ blur(x, y) = (in(x, y - 1) + in(x, y) + in(x, y + 1)) / 3;
+ blur.split(y, yo, yi, 64);
+ // Each strip of blur needs 66 rows of the input.
+ in.stream_at(blur, yo, 1, 66);
+ blur.compile_to_file("blur", {in});
+ \endcode
+ */
+class StreamedInput {
+    Param<const halide_tile_source_t *> source_param;
+    Func fetch, func;
+
+public:
+    /** Construct a streamed input of the given type and
+     * dimensionality, with an auto-generated unique name. */
+    StreamedInput(Type t, int dimensions);
+
+    /** Construct a streamed input of the given type and
+     * dimensionality, with the given name. */
+    StreamedInput(Type t, int dimensions, const std::string &name);
+
+    /** The name of this input. */
+    const std::string &name() const;
+
+    /** The type and dimensionality of the values fetched. */
+    // @{
+    Type type() const;
+    int dimensions() const;
+    // @}
+
+    /** Set the source to fetch regions from. Only relevant for
+     * jitting. The source must outlive any realizations that use it. */
+    void set(const halide_tile_source_t *source);
+
+    /** The scalar parameter the pipeline takes the source as. Pass
+     * this (or the StreamedInput itself) in the argument list when
+     * compiling ahead of time, or set it in a ParamMap. */
+    const Param<const halide_tile_source_t *> &source() const {
+        return source_param;
+    }
+
+    /** Fetch the input tile by tile within each iteration of the
+     * given loop of the consumer, on a background thread that runs
+     * one iteration ahead. Each tile is fetched into its own buffer
+     * and copied into storage for the input that is folded over the
+     * given dimension with a factor of twice tile_extent, so
+     * tile_extent must be at least the extent of that dimension that
+     * one iteration of the loop needs. The regions the loop needs
+     * must move monotonically forwards along that dimension. Tiles
+     * may overlap the fold boundary. */
+    StreamedInput &stream_at(const Func &consumer, const Var &var, int dim, const Expr &tile_extent);
+
+    /** Construct an expression which loads from this input. */
+    // @{
+    template<typename... Args>
+    HALIDE_NO_USER_CODE_INLINE Expr operator()(Args &&...args) const {
+        return func(std::forward<Args>(args)...);
+    }
+    Expr operator()(std::vector<Expr>) const;
+    Expr operator()(std::vector<Var>) const;
+    // @}
+
+    /** The Func that holds this input. It copies from an extern
+     * stage that does the fetching, which is computed at its
+     * outermost loop once stream_at has been called, and at the root
+     * otherwise. Its dimensions are named with implicit vars _0, _1,
+     * etc. Can be scheduled directly for placements stream_at
+     * doesn't cover. */
+    operator Func() const;
+
+    /** A StreamedInput appears in argument lists as its source. */
+    operator Argument() const;
+};
+
+}  // namespace Halide
+
+#endif
@@ -388,6 +388,8 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"arm_dot_prod", Target::ARMDotProd},
     {"llvm_large_code_model", Target::LLVMLargeCodeModel},
     {"rvv", Target::RVV},
+    {"profile_lowering", Target::ProfileLowering},
+    {"batch_entry_point", Target::BatchEntryPoint},
     // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
 };
 
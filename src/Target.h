@@ -128,6 +128,8 @@ struct Target {
         ARMDotProd = halide_target_feature_arm_dot_prod,
         LLVMLargeCodeModel = halide_llvm_large_code_model,
         RVV = halide_target_feature_rvv,
+        ProfileLowering = halide_target_feature_profile_lowering,
+        BatchEntryPoint = halide_target_feature_batch_entry_point,
         FeatureEnd = halide_target_feature_end
     };
     Target() = default;
@@ -147,12 +147,43 @@ const int num_unique_name_counters = (1 << 14);
 // this is a global, which is always zero-initialized.
 std::atomic<int> unique_name_counters[num_unique_name_counters] = {};
 
+// Set by ScopedUniqueNameCounters.
+thread_local std::vector<int> *private_unique_name_counters = nullptr;
+
 int unique_count(size_t h) {
     h = h & (num_unique_name_counters - 1);
+    if (private_unique_name_counters) {
+        return (*private_unique_name_counters)[h]++;
+    }
     return unique_name_counters[h]++;
 }
 }  // namespace
 
+UniqueNameCounters::UniqueNameCounters()
+    : counts(num_unique_name_counters) {
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        counts[i] = unique_name_counters[i];
+    }
+}
+
+void UniqueNameCounters::merge_into_global() const {
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        int old = unique_name_counters[i];
+        while (old < counts[i] &&
+               !unique_name_counters[i].compare_exchange_weak(old, counts[i])) {
+        }
+    }
+}
+
+ScopedUniqueNameCounters::ScopedUniqueNameCounters(UniqueNameCounters &counters)
+    : previous(private_unique_name_counters) {
+    private_unique_name_counters = &counters.counts;
+}
+
+ScopedUniqueNameCounters::~ScopedUniqueNameCounters() {
+    private_unique_name_counters = previous;
+}
+
 // There are three possible families of names returned by the methods below:
 // 1) char pattern: (char that isn't '$') + number (e.g. v234)
 // 2) string pattern: (string without '$') + '$' + number (e.g. fr#nk82$42)
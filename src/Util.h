@@ -151,6 +151,39 @@ std::string unique_name(char prefix);
 std::string unique_name(const std::string &prefix);
 // @}
 
+/** A private copy of the counters used by unique_name, which starts
+ * out as a snapshot of the process-wide counters. Work that draws its
+ * names from one of these names things the same way regardless of
+ * what other threads are doing. Names from different copies may
+ * collide with each other, so only use them for independent work
+ * (e.g. separate Modules) whose names never meet. */
+class UniqueNameCounters {
+public:
+    UniqueNameCounters();
+
+    /** Advance the process-wide counters past every name handed out
+     * from this copy, so that later names can't collide with them. */
+    void merge_into_global() const;
+
+private:
+    friend class ScopedUniqueNameCounters;
+    std::vector<int> counts;
+};
+
+/** While one of these is alive, unique_name calls on the current
+ * thread draw from the given counters instead of the process-wide
+ * ones. */
+class ScopedUniqueNameCounters {
+    std::vector<int> *previous;
+
+public:
+    explicit ScopedUniqueNameCounters(UniqueNameCounters &counters);
+    ~ScopedUniqueNameCounters();
+
+    ScopedUniqueNameCounters(const ScopedUniqueNameCounters &) = delete;
+    ScopedUniqueNameCounters &operator=(const ScopedUniqueNameCounters &) = delete;
+};
+
 /** Test if the first string starts with the second string */
 bool starts_with(const std::string &str, const std::string &prefix);
 
@@ -54,6 +54,12 @@
   HL_NO_SUBTILING
   If set to 1, limits the search space to that of Mullapudi et al.
 
+  HL_DISABLE_MEMOIZED_FEATURES
+  If set to 1, recompute the featurization of every loop nest in every state, instead of reusing the features of loop nests shared with states already costed. Only useful for benchmarking the autoscheduler itself.
+
+  HL_CHECK_MEMOIZED_FEATURES
+  If set to 1, recompute the features of a loop nest whenever its memoized features are reused, and check that they match. Only useful for testing the autoscheduler itself.
+
   HL_DEBUG_AUTOSCHEDULE
   If set, is used for the debug log level for auto-schedule generation (overriding the
   value of HL_DEBUG_CODEGEN, if any).
@@ -61,6 +67,9 @@
   HL_AUTOSCHEDULE_MEMORY_LIMIT
   If set, only consider schedules that allocate at most this much memory (measured in bytes).
 
+  HL_AUTOSCHEDULE_NUM_THREADS
+  Number of threads used to expand and featurize the states in the beam. Defaults to the number of cores. The schedule found does not depend on this, so set it to 1 only to debug the search.
+
   TODO: expose these settings by adding some means to pass args to
   generator plugins instead of environment vars.
 */
@@ -69,6 +78,7 @@
 #include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <queue>
 #include <random>
@@ -242,6 +252,67 @@ public:
     }
 };
 
+// Get the HL_AUTOSCHEDULE_NUM_THREADS environment variable. Purpose of this is described above.
+int get_num_threads() {
+    string num_threads_str = get_env_variable("HL_AUTOSCHEDULE_NUM_THREADS");
+    if (!num_threads_str.empty()) {
+        return std::max(1, atoi(num_threads_str.c_str()));
+    } else {
+        return (int)ThreadPool<void>::num_processors_online();
+    }
+}
+
+// A cost model that just remembers the states enqueued on it. Worker
+// threads generate and featurize children against one of these, and
+// the requests are then forwarded to the real cost model in the same
+// order a single-threaded search would have made them, so the
+// batches it evaluates (and so the costs) don't depend on the number
+// of threads.
+class DeferredCostModel : public CostModel {
+    struct Request {
+        StageMapOfScheduleFeatures schedule_feats;
+        double *cost_ptr;
+    };
+    vector<Request> requests;
+    size_t forwarded = 0;
+
+public:
+    void set_pipeline_features(const FunctionDAG &dag,
+                               const MachineParams &params) override {
+        internal_error << "DeferredCostModel has no pipeline features\n";
+    }
+
+    void enqueue(const FunctionDAG &dag,
+                 const StageMapOfScheduleFeatures &schedule_feats,
+                 double *cost_ptr) override {
+        requests.push_back(Request{schedule_feats, cost_ptr});
+    }
+
+    void evaluate_costs() override {
+        internal_error << "DeferredCostModel can't evaluate costs\n";
+    }
+
+    void reset() override {
+        requests.clear();
+        forwarded = 0;
+    }
+
+    // The number of states enqueued so far.
+    size_t size() const {
+        return requests.size();
+    }
+
+    // Forward the requests before 'end' that haven't been forwarded yet.
+    void forward(const FunctionDAG &dag, CostModel *cost_model, size_t end) {
+        for (; forwarded < end; forwarded++) {
+            auto &r = requests[forwarded];
+            cost_model->enqueue(dag, r.schedule_feats, r.cost_ptr);
+            // Free up the features as we go.
+            r.schedule_feats = StageMapOfScheduleFeatures();
+        }
+    }
+};
+
 // Configure a cost model to process a specific pipeline.
 void configure_pipeline_features(const FunctionDAG &dag,
                                  const MachineParams &params,
@@ -261,7 +332,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           int pass_idx,
                                           int num_passes,
                                           ProgressBar &tick,
-                                          std::unordered_set<uint64_t> &permitted_hashes) {
+                                          std::unordered_set<uint64_t> &permitted_hashes,
+                                          ThreadPool<void> *thread_pool) {
 
     if (cost_model) {
         configure_pipeline_features(dag, params, cost_model);
@@ -320,7 +392,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                              pass_idx,
                                              num_passes,
                                              tick,
-                                             permitted_hashes);
+                                             permitted_hashes,
+                                             thread_pool);
             } else {
                 internal_error << "Ran out of legal states with beam size " << beam_size << "\n";
             }
@@ -330,8 +403,10 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
             aslog(0) << "Warning: Huge number of states generated (" << pending.size() << ").\n";
         }
 
-        expanded = 0;
-        while (expanded < beam_size && !pending.empty()) {
+        // First pick the states to expand in this step. This part is
+        // sequential, as it consumes random numbers.
+        vector<IntrusivePtr<State>> to_expand;
+        while ((int)to_expand.size() < beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -408,8 +483,63 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                 return best;
             }
 
-            state->generate_children(dag, params, cost_model, memory_limit, enqueue_new_children);
-            expanded++;
+            to_expand.emplace_back(std::move(state));
+        }
+
+        expanded = 0;
+        if (!thread_pool || to_expand.size() < 2) {
+            for (auto &state : to_expand) {
+                state->generate_children(dag, params, cost_model, memory_limit, enqueue_new_children);
+                expanded++;
+            }
+        } else {
+            // Generate and featurize the children of each state on the
+            // thread pool, then add them to the queue and the cost model
+            // in the order the loop above would have.
+            struct Expansion {
+                DeferredCostModel deferred;
+                // Each child, with the number of states enqueued on the
+                // cost model before it was accepted.
+                vector<std::pair<IntrusivePtr<State>, size_t>> children;
+                std::exception_ptr error;
+            };
+            vector<Expansion> expansions(to_expand.size());
+            vector<std::future<void>> done;
+            for (size_t j = 0; j < to_expand.size(); j++) {
+                done.emplace_back(thread_pool->async([&, j]() {
+                    Expansion &e = expansions[j];
+                    std::function<void(IntrusivePtr<State> &&)> accept_child =
+                        [&](IntrusivePtr<State> &&s) {
+                            e.children.emplace_back(std::move(s), e.deferred.size());
+                        };
+                    try {
+                        to_expand[j]->generate_children(dag, params, cost_model ? &e.deferred : nullptr,
+                                                        memory_limit, accept_child);
+                    } catch (...) {
+                        e.error = std::current_exception();
+                    }
+                }));
+            }
+            // Wait for all of them before rethrowing any errors, as
+            // the workers refer to the expansions.
+            for (auto &d : done) {
+                d.wait();
+            }
+            for (auto &e : expansions) {
+                if (e.error) {
+                    std::rethrow_exception(e.error);
+                }
+                for (auto &c : e.children) {
+                    if (cost_model) {
+                        e.deferred.forward(dag, cost_model, c.second);
+                    }
+                    enqueue_new_children(std::move(c.first));
+                }
+                if (cost_model) {
+                    e.deferred.forward(dag, cost_model, e.deferred.size());
+                }
+                expanded++;
+            }
         }
 
         // Drop the other states unconsidered.
@@ -479,6 +609,13 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
         num_passes = std::atoi(num_passes_str.c_str());
     }
 
+    // The states in each step of the beam are expanded in parallel.
+    std::unique_ptr<ThreadPool<void>> thread_pool;
+    int num_threads = get_num_threads();
+    if (num_threads > 1 && cyos_str != "1") {
+        thread_pool.reset(new ThreadPool<void>(num_threads));
+    }
+
     for (int i = 0; i < num_passes; i++) {
         ProgressBar tick;
 
@@ -486,7 +623,8 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
 
         auto pass = optimal_schedule_pass(dag, outputs, params, cost_model,
                                           rng, beam_size, memory_limit,
-                                          i, num_passes, tick, permitted_hashes);
+                                          i, num_passes, tick, permitted_hashes,
+                                          thread_pool.get());
 
         std::chrono::duration<double> total_time = timer.elapsed();
         auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(total_time).count();
@@ -513,7 +651,7 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
 }
 
 // Keep track of how many times we evaluated a state.
-int State::cost_calculations = 0;
+std::atomic<int> State::cost_calculations{0};
 
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
@@ -573,7 +711,7 @@ void generate_schedule(const std::vector<Function> &outputs,
 
     HALIDE_TOC;
 
-    aslog(1) << "Cost evaluated this many times: " << State::cost_calculations << "\n";
+    aslog(1) << "Cost evaluated this many times: " << State::cost_calculations.load() << "\n";
 
     // Dump the schedule found
     aslog(1) << "** Optimal schedule:\n";
@@ -375,6 +375,7 @@ void BoundContents::Layout::allocate_some_more() const {
 }
 
 BoundContents *BoundContents::Layout::make() const {
+    std::lock_guard<std::mutex> guard(lock);
     if (pool.empty()) {
         allocate_some_more();
     }
@@ -387,6 +388,7 @@ BoundContents *BoundContents::Layout::make() const {
 void BoundContents::Layout::release(const BoundContents *b) const {
     internal_assert(b->layout == this) << "Releasing BoundContents onto the wrong pool!";
     b->~BoundContents();
+    std::lock_guard<std::mutex> guard(lock);
     pool.push_back(const_cast<BoundContents *>(b));
     num_live--;
 }
@@ -1,5 +1,8 @@
 #include "LoopNest.h"
 
+#include <atomic>
+#include <cstring>
+
 using std::map;
 using std::pair;
 using std::set;
@@ -28,6 +31,23 @@ bool may_subtile() {
     return b;
 }
 
+bool use_memoized_features() {
+    static bool b = get_env_variable("HL_DISABLE_MEMOIZED_FEATURES") != "1";
+    return b;
+}
+
+// Read on every use rather than once, so that tests can turn it on
+// for some pipelines. Only consulted when memoized features are
+// reused, which is rare compared to computing them.
+bool check_memoized_features() {
+    return get_env_variable("HL_CHECK_MEMOIZED_FEATURES") == "1";
+}
+
+uint64_t LoopNest::next_id() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
 // Given a multi-dimensional box of dimensionality d, generate a list
 // of candidate tile sizes for it, logarithmically spacing the sizes
 // using the given factor. If 'allow_splits' is false, every dimension
@@ -128,7 +148,10 @@ void LoopNest::copy_from(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
+    {
+        std::lock_guard<std::mutex> lock(n.bounds_lock);
+        bounds = n.bounds;
+    }
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -325,7 +348,11 @@ void LoopNest::compute_features(const FunctionDAG &dag,
     if (is_root()) {
         // TODO: This block of code is repeated below. Refactor
         for (const auto &c : children) {
-            c->compute_features(dag, params, sites, subinstances, parallelism, this, parent, root, &working_set_here, features);
+            if (use_memoized_features()) {
+                c->compute_features_memoized(dag, params, sites, subinstances, parallelism, root, &working_set_here, features);
+            } else {
+                c->compute_features(dag, params, sites, subinstances, parallelism, this, parent, root, &working_set_here, features);
+            }
         }
 
         for (const auto *node : store_at) {
@@ -955,15 +982,149 @@ void LoopNest::compute_features(const FunctionDAG &dag,
     }
 }
 
+// Find the stages computed in this loop nest, including the Funcs
+// inlined into it.
+void LoopNest::get_stages_computed(const LoopNest *parent,
+                                   vector<bool> &computed,
+                                   vector<const FunctionDAG::Node::Stage *> *stages) const {
+    if (parent && node != parent->node && !computed[stage->id]) {
+        computed[stage->id] = true;
+        stages->push_back(stage);
+    }
+    for (auto it = inlined.begin(); it != inlined.end(); it++) {
+        const auto *s = &(it.key()->stages[0]);
+        if (!computed[s->id]) {
+            computed[s->id] = true;
+            stages->push_back(s);
+        }
+    }
+    for (const auto &c : children) {
+        c->get_stages_computed(this, computed, stages);
+    }
+}
+
+// The featurization of a child of the root depends only on the loop
+// nest itself, which is immutable, and on the sites of the Funcs
+// outside of it that it loads from. Most states in the beam share all
+// but one of the children of their root with their parent state, so
+// we memoize the features computed here on this loop nest, keyed by
+// those sites.
+void LoopNest::compute_features_memoized(const FunctionDAG &dag,
+                                         const MachineParams &params,
+                                         const StageMap<Sites> &sites,
+                                         int64_t instances,
+                                         int64_t parallelism,
+                                         const LoopNest &root,
+                                         int64_t *working_set,
+                                         StageMap<ScheduleFeatures> *features) const {
+    vector<bool> computed(dag.nodes[0].stages[0].max_id, false);
+    vector<const FunctionDAG::Node::Stage *> stages;
+    get_stages_computed(&root, computed, &stages);
+
+    // A Func inlined here may also be inlined into other children of
+    // the root, which accumulate into the same features. Don't
+    // memoize those.
+    bool memoizable = true;
+    for (const auto *s : stages) {
+        if (sites.get(s).inlined) {
+            for (const auto *e : s->node->outgoing_edges) {
+                memoizable &= computed[e->consumer->id];
+            }
+        }
+    }
+
+    if (!memoizable) {
+        compute_features(dag, params, sites, instances, parallelism, &root, nullptr, root, working_set, features);
+        return;
+    }
+
+    // Gather the Funcs loaded from that are computed elsewhere, and
+    // where they are. Loop nests are identified by their id, and the
+    // root (which varies from state to state) by zero. Loop nests are
+    // immutable once they're part of a state, so the same id means
+    // the same bounds and number of realizations.
+    vector<const FunctionDAG::Node *> producers;
+    for (const auto *s : stages) {
+        for (const auto *e : s->incoming_edges) {
+            if (!computed[e->producer->stages[0].id]) {
+                producers.push_back(e->producer);
+            }
+        }
+    }
+    std::sort(producers.begin(), producers.end(),
+              [](const FunctionDAG::Node *a, const FunctionDAG::Node *b) {
+                  return a->id < b->id;
+              });
+    producers.erase(std::unique(producers.begin(), producers.end()), producers.end());
+
+    auto site_key = [&](const LoopNest *l) -> int64_t {
+        return l == &root ? 0 : (int64_t)l->id;
+    };
+
+    vector<int64_t> key;
+    key.reserve(2 + producers.size() * 5);
+    key.push_back(instances);
+    key.push_back(parallelism);
+    for (const auto *p : producers) {
+        const auto &site = sites.get(&(p->stages[0]));
+        key.push_back(p->id);
+        key.push_back(site.inlined);
+        key.push_back(site_key(site.compute));
+        key.push_back(site_key(site.store));
+        key.push_back(site.produce ? site.produce->vector_dim : -2);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(features_lock);
+        auto it = features_cache.find(key);
+        if (it != features_cache.end()) {
+            if (check_memoized_features()) {
+                // Check the memoized features against the real thing,
+                // starting from the features of the other children.
+                StageMap<ScheduleFeatures> fresh = *features;
+                int64_t fresh_working_set = 0;
+                compute_features(dag, params, sites, instances, parallelism, &root, nullptr, root, &fresh_working_set, &fresh);
+                internal_assert(fresh_working_set == it->second.working_set)
+                    << "Memoized working set " << it->second.working_set
+                    << " differs from recomputed working set " << fresh_working_set << "\n";
+                for (const auto &f : it->second.features) {
+                    internal_assert(memcmp(&f.second, &fresh.get(f.first), sizeof(ScheduleFeatures)) == 0)
+                        << "Memoized features of " << f.first->name << " differ from recomputed features\n";
+                }
+            }
+            for (const auto &f : it->second.features) {
+                features->get_or_create(f.first) = f.second;
+            }
+            *working_set += it->second.working_set;
+            return;
+        }
+    }
+
+    MemoizedFeatures memoized;
+    compute_features(dag, params, sites, instances, parallelism, &root, nullptr, root, &memoized.working_set, features);
+    *working_set += memoized.working_set;
+
+    memoized.features.reserve(stages.size());
+    for (const auto *s : stages) {
+        memoized.features.emplace_back(s, features->get(s));
+    }
+
+    std::lock_guard<std::mutex> lock(features_lock);
+    features_cache.emplace(std::move(key), std::move(memoized));
+}
+
 // Get the region required of a Func at this site, from which we
 // know what region would be computed if it were scheduled here,
 // and what its loop nest would be.
-const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
-    if (bounds.contains(f)) {
-        const Bound &b = bounds.get(f);
-        // Expensive validation for debugging
-        // b->validate();
-        return b;
+Bound LoopNest::get_bounds(const FunctionDAG::Node *f) const {
+    {
+        std::lock_guard<std::mutex> lock(bounds_lock);
+        if (bounds.contains(f)) {
+            const Bound &b = bounds.get(f);
+            // Expensive validation for debugging
+            // b->validate();
+            return b;
+        }
     }
     auto *bound = f->make_bound();
 
@@ -1015,7 +1176,15 @@ const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
         f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
     }
 
-    const Bound &b = set_bounds(f, bound);
+    std::lock_guard<std::mutex> lock(bounds_lock);
+    if (bounds.contains(f)) {
+        // Another thread computed the same bounds in the
+        // meantime. Keep theirs, as callers may hold references into
+        // it, and return ours to the pool.
+        Bound discard(bound);
+        return bounds.get(f);
+    }
+    const Bound &b = bounds.emplace(f, bound);
     // Validation is expensive, turn if off by default.
     // b->validate();
     return b;
@@ -9,6 +9,7 @@
 #include "FunctionDAG.h"
 #include "PerfectHashMap.h"
 #include <map>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
@@ -25,6 +26,10 @@ using StageMap = PerfectHashMap<FunctionDAG::Node::Stage, T>;
 
 bool may_subtile();
 
+// Whether to memoize the featurizations of loop nests. Turned off
+// with HL_DISABLE_MEMOIZED_FEATURES=1.
+bool use_memoized_features();
+
 // Given a multi-dimensional box of dimensionality d, generate a list
 // of candidate tile sizes for it, logarithmically spacing the sizes
 // using the given factor. If 'allow_splits' is false, every dimension
@@ -52,8 +57,30 @@ struct LoopNest {
 
     // The total bounds required of any given Func over all iterations
     // of this loop. In the paper, this is represented using the
-    // little boxes to the left of the loop nest tree figures.
+    // little boxes to the left of the loop nest tree figures. Filled
+    // in lazily by get_bounds. Loop nests are shared between states
+    // that may be expanded on different threads, so all access goes
+    // through bounds_lock.
     mutable NodeMap<Bound> bounds;
+    mutable std::mutex bounds_lock;
+
+    // The featurization of a child of the root, memoized by
+    // compute_features_memoized. Each entry holds the features of the
+    // stages computed in this loop nest, and its contribution to the
+    // working set at the root. Keyed by everything outside of this
+    // loop nest that those features depend on.
+    struct MemoizedFeatures {
+        std::vector<std::pair<const FunctionDAG::Node::Stage *, ScheduleFeatures>> features;
+        int64_t working_set = 0;
+    };
+    mutable std::map<std::vector<int64_t>, MemoizedFeatures> features_cache;
+    mutable std::mutex features_lock;
+
+    // A unique id for this loop nest. Unlike its address, it is never
+    // reused once the loop nest is freed, so it can identify loop nests
+    // outside of this one in the keys of features_cache.
+    const uint64_t id = next_id();
+    static uint64_t next_id();
 
     // The Func this loop nest belongs to
     const FunctionDAG::Node *node = nullptr;
@@ -136,6 +163,25 @@ struct LoopNest {
                           int64_t *working_set,
                           StageMap<ScheduleFeatures> *features) const;
 
+    // Find the stages computed in this loop nest, including the Funcs
+    // inlined into it. 'computed' is indexed by stage id.
+    void get_stages_computed(const LoopNest *parent,
+                             std::vector<bool> &computed,
+                             std::vector<const FunctionDAG::Node::Stage *> *stages) const;
+
+    // The same as compute_features, for a child of the root. Unless
+    // the featurization of another child of the root depends on this
+    // one, it is memoized on this loop nest, so that states which
+    // share it don't recompute it.
+    void compute_features_memoized(const FunctionDAG &dag,
+                                   const MachineParams &params,
+                                   const StageMap<Sites> &sites,
+                                   int64_t instances,
+                                   int64_t parallelism,
+                                   const LoopNest &root,
+                                   int64_t *working_set,
+                                   StageMap<ScheduleFeatures> *features) const;
+
     bool is_root() const {
         // The root is the sole node without a Func associated with
         // it.
@@ -143,14 +189,16 @@ struct LoopNest {
     }
 
     // Set the region required of a Func at this site.
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        std::lock_guard<std::mutex> lock(bounds_lock);
         return bounds.emplace(f, b);
     }
 
     // Get the region required of a Func at this site, from which we
     // know what region would be computed if it were scheduled here,
-    // and what its loop nest would be.
-    const Bound &get_bounds(const FunctionDAG::Node *f) const;
+    // and what its loop nest would be. Returned by value, because
+    // another thread may add to the cache at any time.
+    Bound get_bounds(const FunctionDAG::Node *f) const;
 
     // Recursively print a loop nest representation to stderr
     void dump(string prefix, const LoopNest *parent) const;
@@ -8,6 +8,7 @@
 #include "Halide.h"
 #include "LoopNest.h"
 #include "PerfectHashMap.h"
+#include <atomic>
 #include <map>
 #include <utility>
 
@@ -35,8 +36,8 @@ struct State {
     string schedule_source;
 
     // The number of times a cost is enqueued into the cost model,
-    // for all states.
-    static int cost_calculations;
+    // for all states. States may be costed on several threads at once.
+    static std::atomic<int> cost_calculations;
 
     State() = default;
     State(const State &) = delete;
@@ -0,0 +1,78 @@
+# Measure how long the autoscheduler takes to schedule the generators
+# in apps/, with and without memoized featurizations, and check that
+# both find the same schedule.
+if [ $# -lt 4 ]; then
+  echo "Usage: $0 autoschedule_bin_dir halide_distrib_path apps_path out_path [apps]"
+  exit
+fi
+
+set -eu
+
+AUTOSCHED_BIN=${1}
+HALIDE_DISTRIB_PATH=${2}
+APPS=${3}
+OUT=${4}
+shift 4
+
+if [ $# -gt 0 ]; then
+    PIPELINES="$@"
+else
+    PIPELINES="bilateral_grid camera_pipe conv_layer harris hist iir_blur interpolate lens_blur local_laplacian max_filter nl_means stencil_chain unsharp"
+fi
+
+SHARED_EXT=so
+if [ $(uname -s) = "Darwin" ]; then
+    SHARED_EXT=dylib
+fi
+
+HL_TARGET=`${AUTOSCHED_BIN}/get_host_target`
+WEIGHTS=$(cd $(dirname ${0}) && pwd)/baseline.weights
+
+# Milliseconds since the epoch. Needs GNU date.
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+mkdir -p ${OUT}
+
+declare -a TIME
+
+printf "%-20s %16s %16s %8s\n" "app" "unmemoized (ms)" "memoized (ms)" "speedup"
+for APP in ${PIPELINES}; do
+    D=${OUT}/${APP}
+    mkdir -p ${D}
+    make -s -C ${APPS}/${APP} \
+         HALIDE_DISTRIB_PATH=${HALIDE_DISTRIB_PATH} \
+         BIN=${D} \
+         ${D}/host/${APP}.generator > ${D}/build_log.txt 2>&1
+
+    for MEMOIZE in 0 1; do
+        START=$(now_ms)
+        HL_SEED=0 \
+            HL_WEIGHTS_DIR=${WEIGHTS} \
+            HL_DISABLE_MEMOIZED_FEATURES=$(( 1 - MEMOIZE )) \
+            ${D}/host/${APP}.generator \
+            -g ${APP} \
+            -f ${APP}_${MEMOIZE} \
+            -o ${D} \
+            -e schedule \
+            target=${HL_TARGET} \
+            auto_schedule=true \
+            -p ${AUTOSCHED_BIN}/libautoschedule_adams2019.${SHARED_EXT} \
+            -s Adams2019 \
+            2> ${D}/compile_log_${MEMOIZE}.txt
+        END=$(now_ms)
+        TIME[${MEMOIZE}]=$(( END - START ))
+    done
+
+    # The schedule names the Func it was generated for, so compare
+    # the rest of it.
+    if ! diff <(sed "s/${APP}_0/${APP}/g" ${D}/${APP}_0.schedule.h) \
+              <(sed "s/${APP}_1/${APP}/g" ${D}/${APP}_1.schedule.h) > /dev/null; then
+        echo "Memoized and unmemoized featurizations gave different schedules for ${APP}"
+        exit 1
+    fi
+
+    SPEEDUP=$(awk "BEGIN { printf \"%.2f\", ${TIME[0]} / (${TIME[1]} + 1e-9) }")
+    printf "%-20s %16d %16d %7sx\n" ${APP} ${TIME[0]} ${TIME[1]} ${SPEEDUP}
+done
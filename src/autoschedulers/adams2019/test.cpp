@@ -480,5 +480,50 @@ int main(int argc, char **argv) {
         Pipeline(output).auto_schedule(target, params);
     }
 
+    if (true) {
+        // The beam search expands states in parallel, but the schedule
+        // found shouldn't depend on the number of threads.
+        std::string schedules[2];
+        for (int parallel = 0; parallel < 2; parallel++) {
+            static char buf[64];
+            snprintf(buf, sizeof(buf), "HL_AUTOSCHEDULE_NUM_THREADS=%d", parallel ? 8 : 1);
+            putenv(buf);
+
+            Func f("f"), g("g"), h("h");
+            f(x, y) = (x + y) * (x + 2 * y) * (x + 3 * y);
+            g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) + f(x, y + 1);
+            h(x, y) = g(x - 1, y - 1) + g(x + 1, y + 1);
+
+            h.set_estimate(x, 0, 2048).set_estimate(y, 0, 2048);
+            schedules[parallel] = Pipeline(h).auto_schedule(target, params).schedule_source;
+        }
+        if (schedules[0] != schedules[1]) {
+            fprintf(stderr, "Serial and parallel beam search found different schedules:\n%s\n%s\n",
+                    schedules[0].c_str(), schedules[1].c_str());
+            return 1;
+        }
+    }
+
+    if (true) {
+        // Features of loop nests shared between states are memoized, keyed
+        // by loop nests elsewhere in the state. States are freed as the
+        // beam is pruned, so check every reuse of memoized features
+        // against recomputing them.
+        static char check_env[] = "HL_CHECK_MEMOIZED_FEATURES=1";
+        putenv(check_env);
+
+        const int N = 6;
+        Func f[N];
+        f[0](x, y) = (x + y) * (x + 2 * y);
+        for (int i = 1; i < N; i++) {
+            f[i](x, y) = f[i - 1](x - 1, y) + f[i - 1](x + 1, y) + f[0](x, y - i);
+        }
+        f[N - 1].set_estimate(x, 0, 1024).set_estimate(y, 0, 1024);
+        Pipeline(f[N - 1]).auto_schedule(target, params);
+
+        static char uncheck_env[] = "HL_CHECK_MEMOIZED_FEATURES=0";
+        putenv(uncheck_env);
+    }
+
     return 0;
 }
@@ -9,10 +9,14 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #if defined(__has_feature)
@@ -106,6 +110,199 @@ struct DeviceRefCount {
     BufferDeviceOwnership ownership{BufferDeviceOwnership::Allocated};
 };
 
+/** An optional pool of host allocations for Buffers. When enabled,
+ * Buffers that allocate their own memory without a custom allocator
+ * take it from here, and memory freed by the last Buffer that refers
+ * to it is kept for reuse by the next allocation of the same size,
+ * instead of going back to free(). Allocation sizes depend only on
+ * the shape and type of a Buffer, so this is effective when many
+ * short-lived Buffers of the same shape are made over and over.
+ *
+ * The pool holds on to at most max_bytes in total and at most
+ * max_blocks_per_size allocations of each size; anything beyond that
+ * is freed immediately. It may be used from many threads at once. */
+class BufferAllocationPool {
+public:
+    struct Stats {
+        /** Allocations satisfied from the pool, and ones that had to
+         * call malloc. */
+        uint64_t hits = 0, misses = 0;
+        /** Freed allocations kept for reuse, and ones released to
+         * the system because the pool was full or disabled. */
+        uint64_t recycled = 0, discarded = 0;
+        /** What the pool is currently holding on to. */
+        size_t bytes_retained = 0, blocks_retained = 0;
+    };
+
+    /** Start pooling the allocations of Buffers that don't specify a
+     * custom allocator. Can also be used to change the limits. */
+    static void enable(size_t max_bytes = 256 * 1024 * 1024, int max_blocks_per_size = 16) {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.max_bytes = max_bytes;
+        s.max_blocks_per_size = max_blocks_per_size;
+        s.enabled = true;
+        trim(s);
+    }
+
+    /** Stop pooling, and free everything the pool holds. Allocations
+     * that came from the pool and are still in use are freed
+     * normally when their Buffers let go of them. */
+    static void disable() {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.enabled = false;
+        s.max_bytes = 0;
+        trim(s);
+    }
+
+    static bool enabled() {
+        return state().enabled;
+    }
+
+    /** Free everything the pool holds without disabling it. */
+    static void release_unused() {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        size_t max_bytes = s.max_bytes;
+        s.max_bytes = 0;
+        trim(s);
+        s.max_bytes = max_bytes;
+    }
+
+    static Stats stats() {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.stats;
+    }
+
+    static void reset_stats() {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.stats.hits = s.stats.misses = s.stats.recycled = s.stats.discarded = 0;
+    }
+
+    /** An allocate/deallocate pair that can be passed to
+     * Buffer::allocate, and that Buffers use by default while the
+     * pool is enabled. Memory from allocate must be released with
+     * deallocate. */
+    // @{
+    static void *allocate(size_t size) {
+        State &s = state();
+        if (s.enabled) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.free_blocks.find(size);
+            if (it != s.free_blocks.end() && !it->second.empty()) {
+                void *block = it->second.back();
+                it->second.pop_back();
+                s.stats.hits++;
+                s.stats.bytes_retained -= size;
+                s.stats.blocks_retained--;
+                return (uint8_t *)block + header_size;
+            }
+            s.stats.misses++;
+        }
+        void *block = malloc(size + header_size);
+        if (!block) {
+            return nullptr;
+        }
+        *(size_t *)block = size;
+        return (uint8_t *)block + header_size;
+    }
+
+    static void deallocate(void *ptr) {
+        void *block = (uint8_t *)ptr - header_size;
+        size_t size = *(size_t *)block;
+        State &s = state();
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.enabled && s.stats.bytes_retained + size <= s.max_bytes) {
+                std::vector<void *> &blocks = s.free_blocks[size];
+                if ((int)blocks.size() < s.max_blocks_per_size) {
+                    blocks.push_back(block);
+                    s.stats.recycled++;
+                    s.stats.bytes_retained += size;
+                    s.stats.blocks_retained++;
+                    return;
+                }
+            }
+            s.stats.discarded++;
+        }
+        free(block);
+    }
+    // @}
+
+private:
+    // Blocks start with their size, padded to keep the rest of the
+    // block as aligned as malloc made it.
+    static constexpr size_t header_size = alignof(std::max_align_t);
+
+    struct State {
+        std::mutex mutex;
+        std::atomic<bool> enabled{false};
+        size_t max_bytes = 0;
+        int max_blocks_per_size = 0;
+        std::unordered_map<size_t, std::vector<void *>> free_blocks;
+        Stats stats;
+    };
+
+    static State &state() {
+        // Never destroyed, so that Buffers destroyed during static
+        // destruction can still return their memory.
+        static State *s = new State;
+        return *s;
+    }
+
+    // Free blocks until the pool is back within its limits. Called
+    // with the lock held.
+    static void trim(State &s) {
+        for (auto &it : s.free_blocks) {
+            std::vector<void *> &blocks = it.second;
+            while (!blocks.empty() &&
+                   (s.stats.bytes_retained > s.max_bytes ||
+                    (int)blocks.size() > s.max_blocks_per_size)) {
+                free(blocks.back());
+                blocks.pop_back();
+                s.stats.bytes_retained -= it.first;
+                s.stats.blocks_retained--;
+                s.stats.discarded++;
+            }
+        }
+    }
+};
+
+/** Buffer::copy_from and Buffer::fill can split large operations into
+ * tasks and hand them to a parallel for loop with the signature of
+ * halide_do_par_for. None is set by default, so they run on the
+ * calling thread. Code linked against a Halide runtime can pass
+ * halide_do_par_for itself. Operations that touch fewer than
+ * min_bytes bytes always run on the calling thread. */
+class BufferParallelFor {
+public:
+    static void set(halide_do_par_for_t par_for, size_t min_bytes = 1024 * 1024) {
+        state().min_bytes = min_bytes;
+        state().par_for = par_for;
+    }
+
+    /** The parallel for loop to use for an operation that touches
+     * this many bytes, or null if it should run serially. */
+    static halide_do_par_for_t get(size_t bytes) {
+        halide_do_par_for_t par_for = state().par_for;
+        return (par_for && bytes >= state().min_bytes) ? par_for : nullptr;
+    }
+
+private:
+    struct State {
+        std::atomic<halide_do_par_for_t> par_for{nullptr};
+        std::atomic<size_t> min_bytes{0};
+    };
+
+    static State &state() {
+        static State s;
+        return s;
+    }
+};
+
 /** A templated Buffer class that wraps halide_buffer_t and adds
  * functionality. When using Halide from C++, this is the preferred
  * way to create input and output buffers. The overhead of using this
@@ -124,7 +321,8 @@ struct DeviceRefCount {
  *
  * The class optionally allocates and owns memory for the image using
  * a shared pointer allocated with the provided allocator. If they are
- * null, malloc and free are used.  Any device-side allocation is
+ * null, malloc and free are used, or the BufferAllocationPool if it
+ * is enabled.  Any device-side allocation is
  * considered as owned if and only if the host-side allocation is
  * owned. */
 template<typename T = void, int D = 4>
@@ -773,6 +971,10 @@ public:
      * owned memory. */
     void allocate(void *(*allocate_fn)(size_t) = nullptr,
                   void (*deallocate_fn)(void *) = nullptr) {
+        if (!allocate_fn && !deallocate_fn && BufferAllocationPool::enabled()) {
+            allocate_fn = BufferAllocationPool::allocate;
+            deallocate_fn = BufferAllocationPool::deallocate;
+        }
         if (!allocate_fn) {
             allocate_fn = malloc;
         }
@@ -1232,29 +1434,21 @@ public:
         }
 
         // If T is void, we need to do runtime dispatch to an
-        // appropriately-typed lambda. We're copying, so we only care
+        // appropriately-typed copy. We're copying, so we only care
         // about the element size. (If not, this should optimize away
         // into a static dispatch to the right-sized copy.)
         if (T_is_void ? (type().bytes() == 1) : (sizeof(not_void_T) == 1)) {
             using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            Buffer<>::copy_values<MemType>(dst.buf, src.buf);
         } else if (T_is_void ? (type().bytes() == 2) : (sizeof(not_void_T) == 2)) {
             using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            Buffer<>::copy_values<MemType>(dst.buf, src.buf);
         } else if (T_is_void ? (type().bytes() == 4) : (sizeof(not_void_T) == 4)) {
             using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            Buffer<>::copy_values<MemType>(dst.buf, src.buf);
         } else if (T_is_void ? (type().bytes() == 8) : (sizeof(not_void_T) == 8)) {
             using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            Buffer<>::copy_values<MemType>(dst.buf, src.buf);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
@@ -1948,7 +2142,7 @@ public:
 
     Buffer<T, D> &fill(not_void_T val) {
         set_host_dirty();
-        for_each_value([=](T &v) { v = val; });
+        Buffer<>::fill_values<not_void_T>(buf, val);
         return *this;
     }
 
@@ -2074,6 +2268,210 @@ private:
         return innermost_strides_are_one;
     }
 
+    /** Helper functions for copy_from and fill. These sort and flatten
+     * the dimensions the same way for_each_value does, and then copy
+     * or fill whole rows at a time where the layout allows it, so
+     * that the inner loops are memcpy, memset, or loops the compiler
+     * can vectorize. */
+    // @{
+
+    // Copy a 2D block between layouts that are transposed relative to
+    // each other: dst is dense along x, and src is dense along y. Goes
+    // tile by tile so that both sides stay in cache.
+    template<typename MemType>
+    HALIDE_NEVER_INLINE static void transpose_values(MemType *dst, const MemType *src,
+                                                     int width, int height,
+                                                     int dst_stride_y, int src_stride_x) {
+        const int tile = 16;
+        for (int y0 = 0; y0 < height; y0 += tile) {
+            const int y1 = std::min(height, y0 + tile);
+            for (int x0 = 0; x0 < width; x0 += tile) {
+                const int x1 = std::min(width, x0 + tile);
+                for (int y = y0; y < y1; y++) {
+                    MemType *d = dst + (ptrdiff_t)y * dst_stride_y;
+                    const MemType *s = src + y;
+                    for (int x = x0; x < x1; x++) {
+                        d[x] = s[(ptrdiff_t)x * src_stride_x];
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename MemType>
+    static void copy_values_helper(const for_each_value_task_dim<2> *t, int d, bool transposed,
+                                   MemType *dst, const MemType *src) {
+        if (d == -1) {
+            *dst = *src;
+        } else if (d == 0) {
+            const int extent = t[0].extent;
+            const int dst_stride = t[0].stride[0], src_stride = t[0].stride[1];
+            if (dst_stride == 1 && src_stride == 1) {
+                memcpy(dst, src, extent * sizeof(MemType));
+            } else {
+                for (int i = 0; i < extent; i++) {
+                    dst[(ptrdiff_t)i * dst_stride] = src[(ptrdiff_t)i * src_stride];
+                }
+            }
+        } else if (d == 1 && transposed) {
+            transpose_values(dst, src, t[0].extent, t[1].extent, t[1].stride[0], t[0].stride[1]);
+        } else {
+            for (int i = 0; i < t[d].extent; i++) {
+                copy_values_helper(t, d - 1, transposed,
+                                   dst + (ptrdiff_t)i * t[d].stride[0],
+                                   src + (ptrdiff_t)i * t[d].stride[1]);
+            }
+        }
+    }
+
+    template<typename MemType>
+    static void fill_values_helper(const for_each_value_task_dim<1> *t, int d, MemType *dst, MemType val) {
+        if (d == -1) {
+            *dst = val;
+        } else if (d == 0) {
+            const int extent = t[0].extent;
+            const int stride = t[0].stride[0];
+            if (stride == 1 && sizeof(MemType) == 1) {
+                uint8_t byte;
+                memcpy(&byte, &val, 1);
+                memset(dst, byte, extent);
+            } else if (stride == 1) {
+                std::fill(dst, dst + extent, val);
+            } else {
+                for (int i = 0; i < extent; i++) {
+                    dst[(ptrdiff_t)i * stride] = val;
+                }
+            }
+        } else {
+            for (int i = 0; i < t[d].extent; i++) {
+                fill_values_helper(t, d - 1, dst + (ptrdiff_t)i * t[d].stride[0], val);
+            }
+        }
+    }
+
+    template<typename Fn>
+    struct split_closure {
+        Fn *fn;
+        int chunk, extent;
+    };
+
+    template<typename Fn>
+    static int split_task(void *user_context, int idx, uint8_t *closure) {
+        split_closure<Fn> *c = (split_closure<Fn> *)closure;
+        const int start = idx * c->chunk;
+        (*c->fn)(start, std::min(c->chunk, c->extent - start));
+        return 0;
+    }
+
+    // Call fn(start, extent) on pieces that cover [0, extent), in
+    // parallel if BufferParallelFor allows it for this many bytes.
+    template<typename Fn>
+    static void split_range(int extent, size_t bytes, Fn &&fn) {
+        halide_do_par_for_t par_for = BufferParallelFor::get(bytes);
+        // Give each task at least 64k.
+        const size_t tasks = std::min<size_t>(extent, bytes / (64 * 1024));
+        if (!par_for || tasks < 2) {
+            fn(0, extent);
+            return;
+        }
+        split_closure<typename std::remove_reference<Fn>::type> closure;
+        closure.fn = &fn;
+        closure.chunk = (int)((extent + tasks - 1) / tasks);
+        closure.extent = extent;
+        const int num_chunks = (extent + closure.chunk - 1) / closure.chunk;
+        par_for(nullptr, split_task<typename std::remove_reference<Fn>::type>, 0, num_chunks, (uint8_t *)&closure);
+    }
+
+    // The number of dimensions worth iterating over once
+    // for_each_value_prep has flattened what it can.
+    template<int N>
+    static int trim_flattened_dims(const for_each_value_task_dim<N> *t, int dimensions) {
+        while (dimensions > 1 && t[dimensions - 1].extent == 1) {
+            dimensions--;
+        }
+        return dimensions;
+    }
+
+    template<typename MemType>
+    static void copy_values(const halide_buffer_t &dst, const halide_buffer_t &src) {
+        const int dimensions = dst.dimensions;
+        for_each_value_task_dim<2> *t =
+            (for_each_value_task_dim<2> *)HALIDE_ALLOCA((dimensions + 1) * sizeof(for_each_value_task_dim<2>));
+        const halide_buffer_t *buffers[] = {&dst, &src};
+        for_each_value_prep(t, buffers);
+        const int dims = trim_flattened_dims(t, dimensions);
+
+        // If the innermost dimension of dst is dense but src is
+        // dense along some other dimension, move that one next to it
+        // and copy the pair as a transpose.
+        bool transposed = false;
+        if (dims > 1 && t[0].stride[0] == 1 && t[0].stride[1] != 1) {
+            for (int k = 1; k < dims; k++) {
+                if (t[k].stride[1] == 1) {
+                    for_each_value_task_dim<2> dense_in_src = t[k];
+                    for (int j = k; j > 1; j--) {
+                        t[j] = t[j - 1];
+                    }
+                    t[1] = dense_in_src;
+                    transposed = true;
+                    break;
+                }
+            }
+        }
+
+        MemType *dst_ptr = (MemType *)dst.host;
+        const MemType *src_ptr = (const MemType *)src.host;
+        if (dims == 0) {
+            *dst_ptr = *src_ptr;
+            return;
+        }
+
+        const int top = dims - 1;
+        size_t bytes = sizeof(MemType);
+        for (int i = 0; i < dims; i++) {
+            bytes *= t[i].extent;
+        }
+        split_range(t[top].extent, bytes, [&](int start, int extent) {
+            for_each_value_task_dim<2> *piece =
+                (for_each_value_task_dim<2> *)HALIDE_ALLOCA(dims * sizeof(for_each_value_task_dim<2>));
+            memcpy(piece, t, dims * sizeof(for_each_value_task_dim<2>));
+            piece[top].extent = extent;
+            copy_values_helper(piece, top, transposed,
+                               dst_ptr + (ptrdiff_t)start * t[top].stride[0],
+                               src_ptr + (ptrdiff_t)start * t[top].stride[1]);
+        });
+    }
+
+    template<typename MemType>
+    static void fill_values(const halide_buffer_t &dst, MemType val) {
+        const int dimensions = dst.dimensions;
+        for_each_value_task_dim<1> *t =
+            (for_each_value_task_dim<1> *)HALIDE_ALLOCA((dimensions + 1) * sizeof(for_each_value_task_dim<1>));
+        const halide_buffer_t *buffers[] = {&dst};
+        for_each_value_prep(t, buffers);
+        const int dims = trim_flattened_dims(t, dimensions);
+
+        MemType *dst_ptr = (MemType *)dst.host;
+        if (dims == 0) {
+            *dst_ptr = val;
+            return;
+        }
+
+        const int top = dims - 1;
+        size_t bytes = sizeof(MemType);
+        for (int i = 0; i < dims; i++) {
+            bytes *= t[i].extent;
+        }
+        split_range(t[top].extent, bytes, [&](int start, int extent) {
+            for_each_value_task_dim<1> *piece =
+                (for_each_value_task_dim<1> *)HALIDE_ALLOCA(dims * sizeof(for_each_value_task_dim<1>));
+            memcpy(piece, t, dims * sizeof(for_each_value_task_dim<1>));
+            piece[top].extent = extent;
+            fill_values_helper(piece, top, dst_ptr + (ptrdiff_t)start * t[top].stride[0], val);
+        });
+    }
+    // @}
+
     template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
     void for_each_value_impl(Fn &&f, Args &&...other_buffers) const {
         Buffer<>::for_each_value_task_dim<N> *t =
@@ -167,6 +167,34 @@ extern void halide_shutdown_thread_pool();
 typedef int (*halide_do_par_for_t)(void *, halide_task_t, int, int, uint8_t *);
 extern halide_do_par_for_t halide_set_custom_do_par_for(halide_do_par_for_t do_par_for);
 
+/** Call an argv-style pipeline entry point (such as the foo_argv
+ * function generated for a pipeline foo) once for each of a batch of
+ * argument lists, as the tasks of a single halide_do_par_for. The
+ * args array holds batch_size argument lists of num_args entries
+ * each, one after another. Pipelines that have parallel loops of
+ * their own run them nested inside the batch. Returns zero if every
+ * call returned zero, or the result of one of the failing calls
+ * otherwise. The generated foo_batch functions call this. */
+extern int halide_do_batch(void *user_context, int (*argv_func)(void **),
+                           void **args, int num_args, int batch_size);
+
+/** A source of pixels for an input that is fetched a region at a time
+ * while a pipeline runs, rather than passed in as a whole buffer (see
+ * Halide::StreamedInput). fetch is called with the source_context and
+ * a buffer describing the region wanted, and must fill in that
+ * region's host memory. It may be called from a thread other than
+ * the one that called the pipeline, and should return zero on
+ * success. */
+struct halide_tile_source_t {
+    int (*fetch)(void *user_context, void *source_context, struct halide_buffer_t *dst);
+    void *source_context;
+};
+
+/** The extern stage that StreamedInput uses to call a
+ * halide_tile_source_t. */
+extern int halide_fetch_tile(void *user_context, const struct halide_tile_source_t *source,
+                             struct halide_buffer_t *dst);
+
 /** An opaque struct representing a semaphore. Used by the task system for async tasks. */
 struct halide_semaphore_t {
     uint64_t _private[2];
@@ -361,6 +389,48 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** Turn the pool of host allocations behind halide_default_malloc on
+ * or off. The pool is off by default; setting HL_REUSE_HOST_ALLOCATIONS=1
+ * in the environment also turns it on. While it is on, freed blocks of
+ * up to 32MB are kept, bucketed by size, and handed back out by later
+ * allocations of a similar size, which saves page faults and allocator
+ * contention in pipelines that run many times. The pool holds on to
+ * at most 256MB. Turning the pool off releases the memory it holds.
+ * On platforms with their own allocator this does nothing. */
+extern int halide_reuse_host_allocations(void *user_context, bool);
+
+/** Return any host memory held by the pool described above, but not
+ * currently allocated, to the system. */
+extern int halide_release_unused_host_allocations(void *user_context);
+
+/** Counters kept by halide_default_malloc and halide_default_free,
+ * filled in by halide_host_allocation_get_stats. The counts accumulate
+ * from program start. */
+struct halide_host_allocation_stats {
+    /** The number of allocations handed out from the pool. */
+    uint64_t pool_hits;
+
+    /** The number of blocks allocated from the system. */
+    uint64_t system_mallocs;
+
+    /** The number of blocks returned to the system. */
+    uint64_t system_frees;
+};
+
+/** Fill in the host allocation statistics. Returns zero on success. */
+extern int halide_host_allocation_get_stats(struct halide_host_allocation_stats *stats);
+
+/** An allocator for use with the thread pool's NUMA mode
+ * (HL_THREAD_POOL_NUMA=1). It returns whole pages that have no
+ * physical memory behind them yet, so each page lands on the NUMA node
+ * of the worker thread that first writes to it. Install it with
+ * halide_set_custom_malloc/free. On platforms without NUMA support it
+ * is the same as halide_default_malloc/free. */
+//@{
+extern void *halide_numa_malloc(void *user_context, size_t x);
+extern void halide_numa_free(void *user_context, void *ptr);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -871,6 +941,86 @@ extern int halide_get_gpu_device(void *user_context);
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
+/** Set a soft maximum amount of memory, in bytes, that memoized
+ *  results computed by the named pipeline may occupy in the cache.
+ *  The pipeline name is the name of the top-level function the
+ *  pipeline was compiled as. These entries still count towards the
+ *  overall limit set by halide_memoization_cache_set_size. A size of
+ *  zero removes the limit. Returns a nonzero error code if no more
+ *  per-pipeline limits can be tracked.
+ */
+extern int halide_memoization_cache_set_pipeline_size(const char *pipeline_name, int64_t size);
+
+/** The number of buckets in the key size histograms of
+ * halide_memoization_cache_stats. Bucket i counts keys of at most
+ * (16 << i) bytes, and the last bucket counts all larger keys. */
+#define HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS 8
+
+/** Counters kept by the memoization cache, filled in by
+ * halide_memoization_cache_get_stats. The counts accumulate from
+ * program start, or from the last halide_memoization_cache_cleanup. */
+struct halide_memoization_cache_stats {
+    /** The number of calls to halide_memoization_cache_lookup. */
+    uint64_t lookups;
+
+    /** The number of lookups that found a result in the cache,
+     * including those found in the file set by
+     * halide_memoization_cache_set_file. */
+    uint64_t hits;
+
+    /** The number of lookups that did not. */
+    uint64_t misses;
+
+    /** The number of entries removed to stay within the cache size
+     * limits. */
+    uint64_t evictions;
+
+    /** The number of bytes of results currently held by the cache. */
+    uint64_t bytes_resident;
+
+    /** The number of entries currently held by the cache. */
+    uint64_t entries_resident;
+
+    /** The current limit set by halide_memoization_cache_set_size. */
+    uint64_t max_bytes;
+
+    /** Lookups and hits, by size of cache key. */
+    uint64_t key_size_lookups[HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS];
+    uint64_t key_size_hits[HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS];
+
+    /** The number of lookups that missed in memory but were found in
+     * the file set by halide_memoization_cache_set_file. These are
+     * also counted as hits. */
+    uint64_t persistent_hits;
+
+    /** The number of results written to that file. */
+    uint64_t persistent_stores;
+};
+
+/** Fill in the memoization cache statistics. The counters are cheap
+ *  to maintain, so they are always on. Returns zero on success.
+ */
+extern int halide_memoization_cache_get_stats(struct halide_memoization_cache_stats *stats);
+
+/** Back the memoization cache with a memory-mapped file at the given
+ *  path, so that memoized results survive restarts and are shared by
+ *  processes on the same machine that use the same file. Results
+ *  found in the file are copied into the in-memory cache. A new file
+ *  is created with the given size in bytes, or 64MB if size is zero;
+ *  an existing file keeps its size. When the file fills up it is
+ *  emptied. A null path stops using a file. The file can also be set
+ *  with the environment variable HL_MEMOIZATION_CACHE_FILE (and its
+ *  size in megabytes with HL_MEMOIZATION_CACHE_FILE_SIZE).
+ *
+ *  Results are keyed by the pipeline and Func names, a hash of the
+ *  pipeline's code and target, and the values the computation depends
+ *  on, so results from a pipeline that has since changed aren't
+ *  reused. Results restored from the file can't be
+ *  removed with halide_memoization_cache_evict. Must not be called
+ *  while pipelines are running. Returns zero on success.
+ */
+extern int halide_memoization_cache_set_file(void *user_context, const char *path, int64_t size);
+
 /** Given a cache key for a memoized result, currently constructed
  *  from the Func name and top-level Func name plus the arguments of
  *  the computation, determine if the result is in the cache and
@@ -1336,6 +1486,8 @@ typedef enum halide_target_feature_t {
     halide_target_feature_arm_dot_prod,           ///< Enable ARMv8.2-a dotprod extension (i.e. udot and sdot instructions)
     halide_llvm_large_code_model,                 ///< Use the LLVM large code model to compile
     halide_target_feature_rvv,                    ///< Enable RISCV "V" Vector Extension
+    halide_target_feature_profile_lowering,       ///< Record the time taken by each lowering pass, and the size of the IR it produces, with the active CompilerLogger.
+    halide_target_feature_batch_entry_point,      ///< Also generate a foo_batch(void **args, int batch_size) entry point, which runs batch_size argv-style calls in parallel via halide_do_batch.
     halide_target_feature_end                     ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
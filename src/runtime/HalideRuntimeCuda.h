@@ -65,6 +65,11 @@ extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_bu
  * driver. See halide_reuse_device_allocations. */
 extern int halide_cuda_release_unused_device_allocations(void *user_context);
 
+/** Get the ordinal of the cuda device that a device pointer was
+ * allocated on. If device_ptr is zero, get the ordinal of the device
+ * of the context Halide uses instead. */
+extern int halide_cuda_get_device_ordinal(void *user_context, uint64_t device_ptr, int *ordinal);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
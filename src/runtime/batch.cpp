@@ -0,0 +1,39 @@
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+struct batch_closure {
+    int (*argv_func)(void **);
+    void **args;
+    int num_args;
+};
+
+WEAK int batch_task(void *user_context, int idx, uint8_t *closure) {
+    batch_closure *c = (batch_closure *)closure;
+    return c->argv_func(c->args + (size_t)idx * c->num_args);
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_do_batch(void *user_context, int (*argv_func)(void **),
+                         void **args, int num_args, int batch_size) {
+    if (batch_size <= 0) {
+        return 0;
+    }
+    if (batch_size == 1) {
+        // Not worth waking up the thread pool for.
+        return argv_func(args);
+    }
+    batch_closure closure = {argv_func, args, num_args};
+    return halide_do_par_for(user_context, batch_task, 0, batch_size, (uint8_t *)&closure);
+}
+
+}  // extern "C"
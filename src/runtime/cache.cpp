@@ -84,6 +84,8 @@ struct CacheEntry {
     halide_buffer_t *buf;
     uint64_t eviction_key;
     bool has_eviction_key;
+    // Index of the per-pipeline budget this entry counts against, or -1.
+    int32_t pipeline;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
               uint32_t key_hash,
@@ -92,6 +94,7 @@ struct CacheEntry {
               bool has_eviction_key, uint64_t eviction_key);
     void destroy();
     halide_buffer_t &buffer(int32_t i);
+    uint64_t size_in_bytes() const;
 };
 
 struct CacheBlockHeader {
@@ -126,6 +129,7 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     in_use_count = 0;
     tuple_count = tuples;
     dimensions = computed_bounds_buf->dimensions;
+    pipeline = -1;
 
     // Allocate all the necessary space (or die)
     size_t storage_bytes = 0;
@@ -185,64 +189,228 @@ WEAK void CacheEntry::destroy() {
     halide_free(nullptr, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size) {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+WEAK uint64_t CacheEntry::size_in_bytes() const {
+    uint64_t result = 0;
+    for (uint32_t i = 0; i < tuple_count; i++) {
+        result += buf[i].size_in_bytes();
+    }
+    return result;
+}
+
+// Hash the key eight bytes at a time using the mixing steps of
+// MurmurHash64A. Keys are mostly pointer-sized and 32-bit values, so
+// this does a fraction of the work of a bytewise hash, and it spreads
+// both the high bits (which pick a shard) and the low bits (which pick
+// a bucket).
+WEAK uint32_t hash_key(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t h = 0x8445d61a4e774912ULL ^ (key_size * m);
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= key_size; i += sizeof(uint64_t)) {
+        uint64_t k;
+        memcpy(&k, key + i, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (i < key_size) {
+        uint64_t k = 0;
+        memcpy(&k, key + i, key_size - i);
+        h ^= k;
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// The key doesn't include the region computed, so a Func memoized
+// inside a parallel loop stores many entries under one key. Mix the
+// region into the hash so that those land in different shards.
+WEAK uint32_t hash_key_and_bounds(const uint8_t *key, size_t key_size,
+                                  const halide_buffer_t *computed_bounds) {
+    uint32_t h = hash_key(key, key_size);
+    for (int i = 0; i < computed_bounds->dimensions; i++) {
+        uint32_t d = (uint32_t)computed_bounds->dim[i].min * 0x9e3779b1u +
+                     (uint32_t)computed_bounds->dim[i].extent;
+        h ^= d + 0x9e3779b9u + (h << 6) + (h >> 2);
     }
+    // Finish with the MurmurHash3 mixer so that the top bits, which
+    // pick the shard, depend on the bounds too.
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
     return h;
 }
 
-WEAK halide_mutex memoization_lock = {{0}};
+// The cache is split into shards by the top bits of the key hash. Each
+// shard has its own lock, hash table and LRU list, so lookups of
+// different keys from different threads rarely contend. The size
+// limits are global, and are enforced by evicting the least recently
+// used entries of each shard in turn.
+struct CacheShard {
+    halide_mutex lock;
+    // Buckets are chosen by the low bits of the key hash. table_size
+    // is a power of two, or zero before the first store.
+    CacheEntry **entries;
+    uint32_t table_size;
+    uint32_t entry_count;
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+
+    // Statistics, also guarded by the lock.
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t evictions;
+    uint64_t bytes;
+    uint64_t key_size_lookups[HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS];
+    uint64_t key_size_hits[HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS];
+};
+
+const int kCacheShardBits = 4;
+const int kCacheShards = 1 << kCacheShardBits;
+const uint32_t kInitialTableSize = 16;
 
-const size_t kHashTableSize = 256;
+WEAK CacheShard cache_shards[kCacheShards];
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+ALWAYS_INLINE CacheShard &shard_for_hash(uint32_t h) {
+    return cache_shards[h >> (32 - kCacheShardBits)];
+}
+
+ALWAYS_INLINE int key_size_bucket(int32_t key_size) {
+    int bucket = 0;
+    while (bucket < HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS - 1 && key_size > (16 << bucket)) {
+        bucket++;
+    }
+    return bucket;
+}
 
-WEAK CacheEntry *most_recently_used = nullptr;
-WEAK CacheEntry *least_recently_used = nullptr;
+ALWAYS_INLINE CacheEntry **bucket_for_hash(CacheShard &shard, uint32_t h) {
+    return &shard.entries[h & (shard.table_size - 1)];
+}
 
 const uint64_t kDefaultCacheSize = 1 << 20;
+const int64_t kDefaultPersistentSize = 64 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
 WEAK int64_t current_cache_size = 0;
 
+// Where the next round of pruning starts, so that one shard doesn't
+// take all of the evictions.
+WEAK int next_shard_to_prune = 0;
+
+// Optional limits on the bytes held by individual pipelines, set with
+// halide_memoization_cache_set_pipeline_size. These also count against
+// max_cache_size. Slots are never reused, so an entry can refer to its
+// budget by index.
+struct PipelineBudget {
+    char name[64];
+    int64_t max_size;  // 0 if unlimited
+    int64_t current_size;
+};
+
+const int kMaxPipelineBudgets = 16;
+WEAK PipelineBudget pipeline_budgets[kMaxPipelineBudgets];
+WEAK int pipeline_budget_count = 0;
+WEAK halide_mutex pipeline_budget_lock = {{0}};
+
+// Find the budget the pipeline that built cache_key is subject to, or
+// -1. The compiler starts every key with a pointer to a string of the
+// form "<length>:<pipeline name><length>:<func name>" (see
+// Memoization.cpp). Must be called with pipeline_budget_lock held.
+WEAK int find_pipeline_budget(const uint8_t *cache_key, int32_t size) {
+    if (size < (int32_t)sizeof(const char *)) {
+        return -1;
+    }
+    const char *id;
+    memcpy(&id, cache_key, sizeof(id));
+    if (id == nullptr) {
+        return -1;
+    }
+    size_t name_len = atoi(id);
+    const char *name = strchr(id, ':');
+    if (name == nullptr) {
+        return -1;
+    }
+    name++;
+    for (int i = 0; i < pipeline_budget_count; i++) {
+        if (strlen(pipeline_budgets[i].name) == name_len &&
+            strncmp(pipeline_budgets[i].name, name, name_len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+WEAK bool over_budget(int pipeline) {
+    int64_t current, limit;
+    if (pipeline < 0) {
+        current = __atomic_load_n(&current_cache_size, __ATOMIC_RELAXED);
+        limit = __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+    } else {
+        current = __atomic_load_n(&pipeline_budgets[pipeline].current_size, __ATOMIC_RELAXED);
+        limit = __atomic_load_n(&pipeline_budgets[pipeline].max_size, __ATOMIC_RELAXED);
+        if (limit == 0) {
+            return false;
+        }
+    }
+    return current > limit;
+}
+
+WEAK void add_to_cache_size(const CacheEntry *entry, int64_t size) {
+    __atomic_fetch_add(&current_cache_size, size, __ATOMIC_ACQ_REL);
+    if (entry->pipeline >= 0) {
+        __atomic_fetch_add(&pipeline_budgets[entry->pipeline].current_size, size, __ATOMIC_ACQ_REL);
+    }
+}
+
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(nullptr) << "validating cache, "
-                   << "current size " << current_cache_size
-                   << " of maximum " << max_cache_size << "\n";
-    int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+WEAK void validate_shard(CacheShard &shard) {
+    uint32_t entries_in_hash_table = 0;
+    for (uint32_t i = 0; i < shard.table_size; i++) {
+        CacheEntry *entry = shard.entries[i];
         while (entry != nullptr) {
             entries_in_hash_table++;
-            if (entry->more_recent == nullptr && entry != most_recently_used) {
+            if (&shard_for_hash(entry->hash) != &shard) {
+                halide_print(nullptr, "cache invalid case 0\n");
+                __builtin_trap();
+            }
+            if (entry->more_recent == nullptr && entry != shard.most_recently_used) {
                 halide_print(nullptr, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == nullptr && entry != least_recently_used) {
+            if (entry->less_recent == nullptr && entry != shard.least_recently_used) {
                 halide_print(nullptr, "cache invalid case 2\n");
                 __builtin_trap();
             }
             entry = entry->next;
         }
     }
-    int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    uint32_t entries_from_mru = 0;
+    CacheEntry *mru_chain = shard.most_recently_used;
     while (mru_chain != nullptr) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
-    int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    uint32_t entries_from_lru = 0;
+    CacheEntry *lru_chain = shard.least_recently_used;
     while (lru_chain != nullptr) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
     }
-    print(nullptr) << "hash entries " << entries_in_hash_table
+    print(nullptr) << "shard " << (int)(&shard - cache_shards)
+                   << " hash entries " << entries_in_hash_table
                    << ", mru entries " << entries_from_mru
                    << ", lru entries " << entries_from_lru << "\n";
-    if (entries_in_hash_table != entries_from_mru) {
+    if (entries_in_hash_table != entries_from_mru ||
+        entries_in_hash_table != shard.entry_count) {
         halide_print(nullptr, "cache invalid case 3\n");
         __builtin_trap();
     }
@@ -257,62 +425,489 @@ WEAK void validate_cache() {
 }
 #endif
 
-WEAK void prune_cache() {
+// Double the number of buckets in a shard, which must be locked. If
+// the allocation fails the shard just stays more heavily loaded.
+WEAK void grow_table(CacheShard &shard) {
+    uint32_t new_size = shard.table_size ? shard.table_size * 2 : kInitialTableSize;
+    CacheEntry **new_entries = (CacheEntry **)halide_malloc(nullptr, sizeof(CacheEntry *) * new_size);
+    if (new_entries == nullptr) {
+        return;
+    }
+    memset(new_entries, 0, sizeof(CacheEntry *) * new_size);
+    for (uint32_t i = 0; i < shard.table_size; i++) {
+        CacheEntry *entry = shard.entries[i];
+        while (entry != nullptr) {
+            CacheEntry *next = entry->next;
+            CacheEntry **bucket = &new_entries[entry->hash & (new_size - 1)];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+    if (shard.entries) {
+        halide_free(nullptr, shard.entries);
+    }
+    shard.entries = new_entries;
+    shard.table_size = new_size;
+}
+
+// Unlink an entry from a shard, which must be locked, and free it.
+WEAK void remove_entry(void *user_context, CacheShard &shard, CacheEntry *entry) {
+    // Remove from hash table
+    CacheEntry **prev = bucket_for_hash(shard, entry->hash);
+    while (*prev != entry) {
+        halide_assert(user_context, *prev != nullptr);
+        prev = &(*prev)->next;
+    }
+    *prev = entry->next;
+
+    // Remove from the LRU chain.
+    if (entry->more_recent != nullptr) {
+        entry->more_recent->less_recent = entry->less_recent;
+    } else {
+        shard.most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != nullptr) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        shard.least_recently_used = entry->more_recent;
+    }
+    shard.entry_count--;
+
+    uint64_t size = entry->size_in_bytes();
+    shard.bytes -= size;
+    add_to_cache_size(entry, -(int64_t)size);
+
+    entry->destroy();
+    halide_free(user_context, entry);
+}
+
+// Evict unused entries from a shard, which must be locked, least
+// recently used first, until the cache is within budget. If pipeline
+// is non-negative, only that pipeline's budget and entries are
+// considered.
+WEAK void prune_shard(CacheShard &shard, int pipeline) {
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_shard(shard);
 #endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != nullptr) {
+    CacheEntry *prune_candidate = shard.least_recently_used;
+    while (prune_candidate != nullptr && over_budget(pipeline)) {
         CacheEntry *more_recent = prune_candidate->more_recent;
+        if (prune_candidate->in_use_count == 0 &&
+            (pipeline < 0 || prune_candidate->pipeline == pipeline)) {
+            remove_entry(nullptr, shard, prune_candidate);
+            shard.evictions++;
+        }
+        prune_candidate = more_recent;
+    }
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+}
 
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != nullptr && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_assert(nullptr, prev_hash_entry != nullptr);
-                prev_hash_entry->next = prune_candidate->next;
-            }
+// Evict entries until the cache, or the given pipeline if pipeline is
+// non-negative, is within budget. Must be called with no shard locked.
+WEAK void prune_cache(int pipeline) {
+    int start = __atomic_fetch_add(&next_shard_to_prune, 1, __ATOMIC_ACQ_REL);
+    for (int i = 0; i < kCacheShards && over_budget(pipeline); i++) {
+        CacheShard &shard = cache_shards[(start + i) & (kCacheShards - 1)];
+        ScopedMutexLock lock(&shard.lock);
+        prune_shard(shard, pipeline);
+    }
+}
+
+// The cache can also be backed by a memory-mapped file (see
+// halide_memoization_cache_set_file), so that results survive restarts
+// and are shared between processes on the same machine. The file is a
+// hash table of chains of entries, appended to while holding a lock on
+// the file, which the OS releases if its holder dies. Entries are
+// never modified once published, so readers don't lock. When the file fills up it is emptied and
+// refilled; readers that race with that see a bad checksum and treat
+// it as a miss. Results found in the file are copied into the
+// in-memory cache, so the LRU logic above still decides what stays
+// resident in this process.
+const uint64_t kPersistentMagic = 0x324f4d454d4c48ULL;  // "HLMEMO2"
+const uint32_t kPersistentSlots = 4096;
+const int32_t kPersistentMaxKeySize = 1024;
+const int kPersistentMaxChain = 64;
+
+struct PersistentHeader {
+    uint64_t magic;
+    uint32_t state;  // 0 until set up, 1 once ready
+    uint32_t padding;
+    uint64_t capacity;
+    uint64_t used;
+    uint64_t generation;
+    uint64_t slots[kPersistentSlots];  // offset of the first entry in each chain, or 0
+};
+
+// Followed by the key, the computed bounds, a PersistentTuple and
+// shape for each tuple element, and then the data of each tuple
+// element. Everything is padded to 8 bytes.
+struct PersistentEntry {
+    uint64_t next;
+    uint64_t checksum;
+    uint32_t hash;
+    uint32_t key_size;
+    int32_t dimensions;
+    int32_t tuple_count;
+    uint64_t size;
+};
+
+struct PersistentTuple {
+    halide_type_t type;
+    uint32_t padding;
+    uint64_t bytes;
+};
+
+WEAK halide_mutex persistent_file_lock = {{0}};
+WEAK PersistentHeader *persistent_file = nullptr;
+WEAK void *persistent_file_handle = nullptr;
+WEAK int persistent_fd = -1;
+// The lock on the file doesn't exclude other threads in this process,
+// so appends also take this.
+WEAK halide_mutex persistent_append_lock = {{0}};
+WEAK bool persistent_file_checked_env = false;
+WEAK uint64_t persistent_hits = 0;
+WEAK uint64_t persistent_stores = 0;
+
+ALWAYS_INLINE size_t pad8(size_t s) {
+    return (s + 7) & ~(size_t)7;
+}
+
+struct ScopedPersistentFileLock {
+    ScopedMutexLock append_lock;
+    int fd;
+    bool locked;
+
+    ALWAYS_INLINE ScopedPersistentFileLock(int fd)
+        : append_lock(&persistent_append_lock), fd(fd), locked(halide_file_lock(fd) == 0) {
+    }
+
+    ALWAYS_INLINE ~ScopedPersistentFileLock() {
+        if (locked) {
+            halide_file_unlock(fd);
+        }
+    }
+};
+
+// The key written by the compiler starts with a pointer to a string
+// naming the pipeline and Func and fingerprinting the pipeline's code,
+// followed by a counter that tells apart pipelines JIT-compiled in
+// this process. Neither means anything in another process, so replace
+// both with the string itself. Returns the size of the result, or -1
+// if it doesn't fit in out.
+WEAK int32_t make_persistent_key(const uint8_t *cache_key, int32_t size, uint8_t *out) {
+    const int32_t prefix_size = sizeof(const char *) + sizeof(int32_t);
+    if (size < prefix_size) {
+        return -1;
+    }
+    const char *id;
+    memcpy(&id, cache_key, sizeof(id));
+    if (id == nullptr) {
+        return -1;
+    }
+    int32_t id_size = (int32_t)strlen(id);
+    int32_t result = id_size + size - prefix_size;
+    if (result > kPersistentMaxKeySize) {
+        return -1;
+    }
+    memcpy(out, id, id_size);
+    memcpy(out + id_size, cache_key + prefix_size, size - prefix_size);
+    return result;
+}
+
+WEAK uint64_t checksum_bytes(uint64_t h, const void *data, size_t size) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const uint8_t *bytes = (const uint8_t *)data;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t k;
+        memcpy(&k, bytes + i, sizeof(k));
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (i < size) {
+        uint64_t k = 0;
+        memcpy(&k, bytes + i, size - i);
+        h ^= k;
+        h *= m;
+    }
+    return h;
+}
+
+// The checksum of an entry is computed from the caller's own copy of
+// everything, so that the writer and a reader that has copied the
+// data out compute the same thing.
+WEAK uint64_t persistent_checksum(const uint8_t *key, int32_t key_size,
+                                  const halide_buffer_t *computed_bounds,
+                                  int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    uint64_t h = checksum_bytes(kPersistentMagic, key, key_size);
+    h = checksum_bytes(h, computed_bounds->dim, sizeof(halide_dimension_t) * computed_bounds->dimensions);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        const halide_buffer_t *buf = tuple_buffers[i];
+        h = checksum_bytes(h, &buf->type, sizeof(buf->type));
+        h = checksum_bytes(h, buf->dim, sizeof(halide_dimension_t) * buf->dimensions);
+        h = checksum_bytes(h, buf->host, buf->size_in_bytes());
+    }
+    return h;
+}
+
+WEAK uint64_t persistent_entry_size(int32_t key_size, const halide_buffer_t *computed_bounds,
+                                    int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    const size_t shape_bytes = sizeof(halide_dimension_t) * computed_bounds->dimensions;
+    uint64_t size = sizeof(PersistentEntry) + pad8(key_size) + pad8(shape_bytes);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        size += sizeof(PersistentTuple) + pad8(shape_bytes) + pad8(tuple_buffers[i]->size_in_bytes());
+    }
+    return size;
+}
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
+// Find an entry in the file matching the key and shapes given, or
+// return nullptr. The entry may be overwritten at any time if the file
+// is emptied, so anything read from it must be checked against the
+// checksum.
+WEAK const PersistentEntry *persistent_find(PersistentHeader *file, const uint8_t *key, int32_t key_size, uint32_t h,
+                                            const halide_buffer_t *computed_bounds,
+                                            int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    const uint8_t *base = (const uint8_t *)file;
+    const uint64_t capacity = file->capacity;
+    const size_t shape_bytes = sizeof(halide_dimension_t) * computed_bounds->dimensions;
+    uint64_t offset = __atomic_load_n(&file->slots[h % kPersistentSlots], __ATOMIC_ACQUIRE);
+    for (int steps = 0; offset != 0 && steps < kPersistentMaxChain; steps++) {
+        if (offset < sizeof(PersistentHeader) || offset + sizeof(PersistentEntry) > capacity || (offset & 7)) {
+            return nullptr;
+        }
+        PersistentEntry e;
+        memcpy(&e, base + offset, sizeof(e));
+        if (e.hash == h && e.key_size == (uint32_t)key_size &&
+            e.dimensions == computed_bounds->dimensions &&
+            e.tuple_count == tuple_count &&
+            e.size <= capacity - offset &&
+            e.size == persistent_entry_size(key_size, computed_bounds, tuple_count, tuple_buffers)) {
+            const uint8_t *p = base + offset + sizeof(PersistentEntry);
+            bool match = memcmp(p, key, key_size) == 0;
+            p += pad8(key_size);
+            match = match && memcmp(p, computed_bounds->dim, shape_bytes) == 0;
+            p += pad8(shape_bytes);
+            for (int32_t i = 0; match && i < tuple_count; i++) {
+                PersistentTuple t;
+                memcpy(&t, p, sizeof(t));
+                p += sizeof(PersistentTuple);
+                match = t.type == tuple_buffers[i]->type &&
+                        t.bytes == tuple_buffers[i]->size_in_bytes() &&
+                        memcmp(p, tuple_buffers[i]->dim, shape_bytes) == 0;
+                p += pad8(shape_bytes);
             }
-            if (more_recent != nullptr) {
-                more_recent->less_recent = prune_candidate->less_recent;
+            if (match) {
+                return (const PersistentEntry *)(base + offset);
             }
+        }
+        offset = e.next;
+    }
+    return nullptr;
+}
+
+ALWAYS_INLINE const uint8_t *persistent_entry_data(const PersistentEntry *e, int32_t key_size,
+                                                   int32_t dimensions, int32_t tuple_count) {
+    const size_t shape_bytes = sizeof(halide_dimension_t) * dimensions;
+    return (const uint8_t *)e + sizeof(PersistentEntry) + pad8(key_size) + pad8(shape_bytes) +
+           tuple_count * (sizeof(PersistentTuple) + pad8(shape_bytes));
+}
+
+// Fill in the tuple buffers from the file. Returns true on a hit.
+WEAK bool persistent_load(PersistentHeader *file, const uint8_t *key, int32_t key_size, uint32_t h,
+                          const halide_buffer_t *computed_bounds,
+                          int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    const PersistentEntry *e = persistent_find(file, key, key_size, h, computed_bounds, tuple_count, tuple_buffers);
+    if (e == nullptr) {
+        return false;
+    }
+    uint64_t checksum = __atomic_load_n(&e->checksum, __ATOMIC_ACQUIRE);
+    const uint8_t *data = persistent_entry_data(e, key_size, computed_bounds->dimensions, tuple_count);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        size_t bytes = tuple_buffers[i]->size_in_bytes();
+        memcpy(tuple_buffers[i]->host, data, bytes);
+        data += pad8(bytes);
+    }
+    return checksum == persistent_checksum(key, key_size, computed_bounds, tuple_count, tuple_buffers);
+}
+
+WEAK void persistent_save(PersistentHeader *file, const uint8_t *key, int32_t key_size, uint32_t h,
+                          const halide_buffer_t *computed_bounds,
+                          int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    for (int32_t i = 0; i < tuple_count; i++) {
+        if (tuple_buffers[i]->device_dirty()) {
+            return;
+        }
+    }
+    const uint64_t size = persistent_entry_size(key_size, computed_bounds, tuple_count, tuple_buffers);
+    const uint64_t first_offset = pad8(sizeof(PersistentHeader));
+    if (size > file->capacity - first_offset) {
+        return;
+    }
+    if (persistent_find(file, key, key_size, h, computed_bounds, tuple_count, tuple_buffers)) {
+        // Another process got there first.
+        return;
+    }
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
+    ScopedPersistentFileLock lock(persistent_fd);
+    if (!lock.locked ||
+        persistent_find(file, key, key_size, h, computed_bounds, tuple_count, tuple_buffers)) {
+        return;
+    }
+
+    uint64_t offset = __atomic_load_n(&file->used, __ATOMIC_RELAXED);
+    if (offset + size > file->capacity) {
+        // Full. Start again from empty.
+        for (uint32_t i = 0; i < kPersistentSlots; i++) {
+            __atomic_store_n(&file->slots[i], 0, __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&file->generation, 1, __ATOMIC_RELEASE);
+        offset = first_offset;
+    }
+
+    uint8_t *base = (uint8_t *)file;
+    PersistentEntry e;
+    e.next = __atomic_load_n(&file->slots[h % kPersistentSlots], __ATOMIC_RELAXED);
+    e.checksum = persistent_checksum(key, key_size, computed_bounds, tuple_count, tuple_buffers);
+    e.hash = h;
+    e.key_size = key_size;
+    e.dimensions = computed_bounds->dimensions;
+    e.tuple_count = tuple_count;
+    e.size = size;
+    memcpy(base + offset, &e, sizeof(e));
+
+    const size_t shape_bytes = sizeof(halide_dimension_t) * computed_bounds->dimensions;
+    uint8_t *p = base + offset + sizeof(PersistentEntry);
+    memcpy(p, key, key_size);
+    p += pad8(key_size);
+    memcpy(p, computed_bounds->dim, shape_bytes);
+    p += pad8(shape_bytes);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        PersistentTuple t;
+        t.type = tuple_buffers[i]->type;
+        t.padding = 0;
+        t.bytes = tuple_buffers[i]->size_in_bytes();
+        memcpy(p, &t, sizeof(t));
+        p += sizeof(PersistentTuple);
+        memcpy(p, tuple_buffers[i]->dim, shape_bytes);
+        p += pad8(shape_bytes);
+    }
+    for (int32_t i = 0; i < tuple_count; i++) {
+        size_t bytes = tuple_buffers[i]->size_in_bytes();
+        memcpy(p, tuple_buffers[i]->host, bytes);
+        p += pad8(bytes);
+    }
+
+    __atomic_store_n(&file->used, offset + size, __ATOMIC_RELAXED);
+    // Publish the entry.
+    __atomic_store_n(&file->slots[h % kPersistentSlots], offset, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&persistent_stores, 1, __ATOMIC_RELAXED);
+}
+
+// Map the file at path, creating it with the given capacity if it is
+// empty. Must be called with persistent_file_lock held.
+WEAK PersistentHeader *persistent_open(void *user_context, const char *path, int64_t capacity) {
+    void *f = fopen(path, "a+b");
+    if (f == nullptr) {
+        error(user_context) << "Could not open memoization cache file " << path << "\n";
+        return nullptr;
+    }
+    int fd = fileno(f);
+    PersistentHeader *file = nullptr;
+    int64_t file_size = 0;
+    {
+        // Hold the lock on the file while checking its size and header,
+        // so that only one process sets it up.
+        ScopedPersistentFileLock lock(fd);
+        if (!lock.locked) {
+            fclose(f);
+            error(user_context) << "Memory-mapped files aren't supported on this platform\n";
+            return nullptr;
+        }
+        file_size = halide_file_get_size(fd);
+        if (file_size == 0) {
+            if (capacity < (int64_t)sizeof(PersistentHeader) * 2) {
+                capacity = (int64_t)sizeof(PersistentHeader) * 2;
             }
-            if (prune_candidate->less_recent != nullptr) {
-                prune_candidate->less_recent = more_recent;
+            if (halide_file_set_size(fd, capacity) != 0) {
+                fclose(f);
+                error(user_context) << "Could not resize memoization cache file " << path << "\n";
+                return nullptr;
             }
-
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
+            file_size = halide_file_get_size(fd);
+        }
+        if (file_size < (int64_t)sizeof(PersistentHeader)) {
+            fclose(f);
+            error(user_context) << "Memoization cache file " << path << " is not a memoization cache\n";
+            return nullptr;
+        }
+        file = (PersistentHeader *)halide_file_map(fd, 0, file_size);
+        if (file == nullptr) {
+            fclose(f);
+            error(user_context) << "Could not map memoization cache file " << path << "\n";
+            return nullptr;
+        }
+        if (file->state == 0) {
+            // A new file, or one whose creator died while setting it up.
+            file->magic = kPersistentMagic;
+            file->capacity = file_size;
+            file->used = pad8(sizeof(PersistentHeader));
+            file->generation = 0;
+            for (uint32_t i = 0; i < kPersistentSlots; i++) {
+                file->slots[i] = 0;
             }
-
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(nullptr, prune_candidate);
+            __atomic_store_n(&file->state, 1, __ATOMIC_RELEASE);
         }
+    }
+    if (file->magic != kPersistentMagic ||
+        file->capacity != (uint64_t)file_size) {
+        halide_file_unmap(file, file_size);
+        fclose(f);
+        error(user_context) << "Memoization cache file " << path << " is not a memoization cache\n";
+        return nullptr;
+    }
+    // Appends need the file to stay open, to lock it.
+    persistent_file_handle = f;
+    persistent_fd = fd;
+    return file;
+}
 
-        prune_candidate = more_recent;
+WEAK void persistent_close() {
+    if (persistent_file) {
+        halide_file_unmap(persistent_file, persistent_file->capacity);
+        __atomic_store_n(&persistent_file, nullptr, __ATOMIC_RELEASE);
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    if (persistent_file_handle) {
+        fclose(persistent_file_handle);
+        persistent_file_handle = nullptr;
+        persistent_fd = -1;
+    }
+}
+
+// The file to use, if any. The first call checks the environment
+// variables HL_MEMOIZATION_CACHE_FILE and
+// HL_MEMOIZATION_CACHE_FILE_SIZE.
+WEAK PersistentHeader *get_persistent_file(void *user_context) {
+    if (!__atomic_load_n(&persistent_file_checked_env, __ATOMIC_ACQUIRE)) {
+        ScopedMutexLock lock(&persistent_file_lock);
+        if (!persistent_file_checked_env) {
+            const char *path = getenv("HL_MEMOIZATION_CACHE_FILE");
+            if (path && *path && persistent_file == nullptr) {
+                const char *size_var = getenv("HL_MEMOIZATION_CACHE_FILE_SIZE");
+                int64_t size = size_var ? (int64_t)atoi(size_var) << 20 : 0;
+                __atomic_store_n(&persistent_file,
+                                 persistent_open(user_context, path, size ? size : kDefaultPersistentSize),
+                                 __ATOMIC_RELEASE);
+            }
+            __atomic_store_n(&persistent_file_checked_env, true, __ATOMIC_RELEASE);
+        }
+    }
+    return __atomic_load_n(&persistent_file, __ATOMIC_ACQUIRE);
 }
 
 }  // namespace Internal
@@ -326,78 +921,135 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
+    __atomic_store_n(&max_cache_size, size, __ATOMIC_RELEASE);
+    prune_cache(-1);
+}
+
+WEAK int halide_memoization_cache_set_pipeline_size(const char *pipeline_name, int64_t size) {
+    int pipeline = -1;
+    {
+        ScopedMutexLock lock(&pipeline_budget_lock);
+
+        for (int i = 0; i < pipeline_budget_count; i++) {
+            if (strcmp(pipeline_budgets[i].name, pipeline_name) == 0) {
+                pipeline = i;
+                break;
+            }
+        }
+        if (pipeline < 0) {
+            if (pipeline_budget_count == kMaxPipelineBudgets ||
+                strlen(pipeline_name) >= sizeof(pipeline_budgets[0].name)) {
+                error(nullptr) << "halide_memoization_cache_set_pipeline_size: can't add a budget for "
+                               << pipeline_name << "\n";
+                return -1;
+            }
+            pipeline = pipeline_budget_count;
+            strncpy(pipeline_budgets[pipeline].name, pipeline_name, sizeof(pipeline_budgets[pipeline].name));
+            pipeline_budgets[pipeline].current_size = 0;
+            // Entries already in the cache don't count against the new
+            // budget.
+            int new_count = pipeline_budget_count + 1;
+            __atomic_store_n(&pipeline_budget_count, new_count, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&pipeline_budgets[pipeline].max_size, size, __ATOMIC_RELEASE);
+    }
+
+    prune_cache(pipeline);
+    return 0;
+}
 
-    max_cache_size = size;
-    prune_cache();
+WEAK int halide_memoization_cache_set_file(void *user_context, const char *path, int64_t size) {
+    ScopedMutexLock lock(&persistent_file_lock);
+    // An explicit call overrides the environment.
+    __atomic_store_n(&persistent_file_checked_env, true, __ATOMIC_RELEASE);
+    persistent_close();
+    if (path == nullptr) {
+        return 0;
+    }
+    PersistentHeader *file = persistent_open(user_context, path, size ? size : kDefaultPersistentSize);
+    if (file == nullptr) {
+        return halide_error_code_generic_error;
+    }
+    __atomic_store_n(&persistent_file, file, __ATOMIC_RELEASE);
+    return 0;
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    uint32_t h = hash_key_and_bounds(cache_key, size, computed_bounds);
+    CacheShard &shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-            }
+        int size_bucket = key_size_bucket(size);
+        shard.lookups++;
+        shard.key_size_lookups[size_bucket]++;
 
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_assert(user_context, entry->more_recent != nullptr);
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_assert(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_assert(user_context, entry->more_recent != nullptr);
-                    entry->more_recent->less_recent = entry->less_recent;
+        CacheEntry *entry = shard.table_size ? *bucket_for_hash(shard, h) : nullptr;
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
 
-                    entry->more_recent = nullptr;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != nullptr) {
-                        most_recently_used->more_recent = entry;
-                    }
-                    most_recently_used = entry;
+                // Check all the tuple buffers have the same bounds (they should).
+                bool all_bounds_equal = true;
+                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
                 }
 
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    *buf = entry->buf[i];
-                }
+                if (all_bounds_equal) {
+                    if (entry != shard.most_recently_used) {
+                        halide_assert(user_context, entry->more_recent != nullptr);
+                        if (entry->less_recent != nullptr) {
+                            entry->less_recent->more_recent = entry->more_recent;
+                        } else {
+                            halide_assert(user_context, shard.least_recently_used == entry);
+                            shard.least_recently_used = entry->more_recent;
+                        }
+                        halide_assert(user_context, entry->more_recent != nullptr);
+                        entry->more_recent->less_recent = entry->less_recent;
+
+                        entry->more_recent = nullptr;
+                        entry->less_recent = shard.most_recently_used;
+                        if (shard.most_recently_used != nullptr) {
+                            shard.most_recently_used->more_recent = entry;
+                        }
+                        shard.most_recently_used = entry;
+                    }
+
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        *buf = entry->buf[i];
+                    }
 
-                entry->in_use_count += tuple_count;
+                    entry->in_use_count += tuple_count;
+                    shard.hits++;
+                    shard.key_size_hits[size_bucket]++;
 
-                return 0;
+                    return 0;
+                }
             }
+            entry = entry->next;
         }
-        entry = entry->next;
     }
 
+    // A miss. Allocate the buffers to compute into without holding
+    // the shard lock.
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -415,9 +1067,27 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         header->entry = nullptr;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    PersistentHeader *file = get_persistent_file(user_context);
+    if (file) {
+        uint8_t persistent_key[kPersistentMaxKeySize];
+        int32_t persistent_key_size = make_persistent_key(cache_key, size, persistent_key);
+        if (persistent_key_size >= 0) {
+            uint32_t persistent_hash = hash_key_and_bounds(persistent_key, persistent_key_size, computed_bounds);
+            if (persistent_load(file, persistent_key, persistent_key_size, persistent_hash,
+                                computed_bounds, tuple_count, tuple_buffers)) {
+                __atomic_fetch_add(&persistent_hits, 1, __ATOMIC_RELAXED);
+                {
+                    ScopedMutexLock lock(&shard.lock);
+                    shard.hits++;
+                    shard.key_size_hits[key_size_bucket(size)]++;
+                }
+                // Move it into the in-memory cache. To the caller
+                // this is a hit, so it won't store it itself.
+                return halide_memoization_cache_store(user_context, cache_key, size, computed_bounds,
+                                                      tuple_count, tuple_buffers, false, 0);
+            }
+        }
+    }
 
     return 1;
 }
@@ -428,107 +1098,138 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         bool has_eviction_key, uint64_t eviction_key) {
     debug(user_context) << "halide_memoization_cache_store has_eviction_key: " << has_eviction_key << " eviction_key " << eviction_key << " .\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    PersistentHeader *file = get_persistent_file(user_context);
+    if (file) {
+        uint8_t persistent_key[kPersistentMaxKeySize];
+        int32_t persistent_key_size = make_persistent_key(cache_key, size, persistent_key);
+        if (persistent_key_size >= 0) {
+            uint32_t persistent_hash = hash_key_and_bounds(persistent_key, persistent_key_size, computed_bounds);
+            persistent_save(file, persistent_key, persistent_key_size, persistent_hash,
+                            computed_bounds, tuple_count, tuple_buffers);
+        }
+    }
 
-    uint32_t index = h % kHashTableSize;
+    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheShard &shard = shard_for_hash(h);
+
+    int pipeline = -1;
+    int budget_count;
+    budget_count = __atomic_load_n(&pipeline_budget_count, __ATOMIC_ACQUIRE);
+    if (budget_count > 0) {
+        ScopedMutexLock lock(&pipeline_budget_lock);
+        pipeline = find_pipeline_budget(cache_key, size);
+    }
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
+        CacheEntry *entry = shard.table_size ? *bucket_for_hash(shard, h) : nullptr;
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                bool all_bounds_equal = true;
+                bool no_host_pointers_equal = true;
+                {
+                    for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                        if (entry->buf[i].host == buf->host) {
+                            no_host_pointers_equal = false;
+                        }
                     }
                 }
-            }
-            if (all_bounds_equal) {
-                halide_assert(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                if (all_bounds_equal) {
+                    halide_assert(user_context, no_host_pointers_equal);
+                    // This entry is still in use by the caller. Mark it as having no cache entry
+                    // so halide_memoization_cache_release can free the buffer.
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                    }
+                    return 0;
                 }
-                return 0;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
-    }
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
+        if (shard.entry_count >= shard.table_size) {
+            grow_table(shard);
         }
-    }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
-                                 has_eviction_key, eviction_key);
-    }
-    if (!inited) {
-        current_cache_size -= added_size;
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+        CacheEntry *new_entry = nullptr;
+        bool inited = false;
+        if (shard.table_size > 0) {
+            new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
+            if (new_entry) {
+                inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
+                                         has_eviction_key, eviction_key);
+            }
         }
+        if (!inited) {
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+            }
 
-        if (new_entry) {
-            halide_free(user_context, new_entry);
+            if (new_entry) {
+                halide_free(user_context, new_entry);
+            }
+            return 0;
         }
-        return 0;
-    }
+        new_entry->pipeline = pipeline;
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != nullptr) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == nullptr) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
+        CacheEntry **bucket = bucket_for_hash(shard, h);
+        new_entry->next = *bucket;
+        new_entry->less_recent = shard.most_recently_used;
+        if (shard.most_recently_used != nullptr) {
+            shard.most_recently_used->more_recent = new_entry;
+        }
+        shard.most_recently_used = new_entry;
+        if (shard.least_recently_used == nullptr) {
+            shard.least_recently_used = new_entry;
+        }
+        *bucket = new_entry;
+        shard.entry_count++;
 
-    new_entry->in_use_count = tuple_count;
+        // The new entry is in use, so it can't be evicted by the
+        // pruning below.
+        new_entry->in_use_count = tuple_count;
+        uint64_t new_entry_size = new_entry->size_in_bytes();
+        shard.bytes += new_entry_size;
+        add_to_cache_size(new_entry, new_entry_size);
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
-    }
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+        }
 
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_shard(shard);
 #endif
+    }
+
+    if (over_budget(-1)) {
+        prune_cache(-1);
+    }
+    if (pipeline >= 0 && over_budget(pipeline)) {
+        prune_cache(pipeline);
+    }
+
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return 0;
@@ -542,12 +1243,13 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == nullptr) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard &shard = shard_for_hash(header->hash);
+        ScopedMutexLock lock(&shard.lock);
 
         halide_assert(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        validate_shard(shard);
 #endif
     }
 
@@ -556,54 +1258,84 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
 
 WEAK void halide_memoization_cache_cleanup() {
     debug(nullptr) << "halide_memoization_cache_cleanup\n";
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        cache_entries[i] = nullptr;
-        while (entry != nullptr) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(nullptr, entry);
-            entry = next;
+    for (int s = 0; s < kCacheShards; s++) {
+        CacheShard &shard = cache_shards[s];
+        for (uint32_t i = 0; i < shard.table_size; i++) {
+            CacheEntry *entry = shard.entries[i];
+            while (entry != nullptr) {
+                CacheEntry *next = entry->next;
+                entry->destroy();
+                halide_free(nullptr, entry);
+                entry = next;
+            }
+        }
+        if (shard.entries) {
+            halide_free(nullptr, shard.entries);
+        }
+        shard.entries = nullptr;
+        shard.table_size = 0;
+        shard.entry_count = 0;
+        shard.most_recently_used = nullptr;
+        shard.least_recently_used = nullptr;
+        shard.lookups = 0;
+        shard.hits = 0;
+        shard.evictions = 0;
+        shard.bytes = 0;
+        for (int i = 0; i < HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS; i++) {
+            shard.key_size_lookups[i] = 0;
+            shard.key_size_hits[i] = 0;
         }
     }
     current_cache_size = 0;
-    most_recently_used = nullptr;
-    least_recently_used = nullptr;
+    persistent_hits = 0;
+    persistent_stores = 0;
+    for (int i = 0; i < pipeline_budget_count; i++) {
+        pipeline_budgets[i].current_size = 0;
+    }
 }
 
 WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
-    ScopedMutexLock lock(&memoization_lock);
+    for (int s = 0; s < kCacheShards; s++) {
+        CacheShard &shard = cache_shards[s];
+        ScopedMutexLock lock(&shard.lock);
 
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        if (entry != nullptr) {
-            CacheEntry **prev = &cache_entries[i];
+        for (uint32_t i = 0; i < shard.table_size; i++) {
+            CacheEntry *entry = shard.entries[i];
             while (entry != nullptr) {
                 CacheEntry *next = entry->next;
                 if (entry->has_eviction_key && entry->eviction_key == eviction_key) {
-                    *prev = next;
-                    if (entry->more_recent != nullptr) {
-                        entry->more_recent->less_recent = entry->less_recent;
-                    } else {
-                        most_recently_used = entry->less_recent;
-                    }
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        least_recently_used = entry->more_recent;
-                    }
-                    entry->destroy();
-                    halide_free(user_context, entry);
-                } else {
-                    prev = &entry->next;
+                    remove_entry(user_context, shard, entry);
                 }
                 entry = next;
             }
         }
-    }
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_shard(shard);
 #endif
+    }
+}
+
+WEAK int halide_memoization_cache_get_stats(struct halide_memoization_cache_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int s = 0; s < kCacheShards; s++) {
+        CacheShard &shard = cache_shards[s];
+        ScopedMutexLock lock(&shard.lock);
+
+        stats->lookups += shard.lookups;
+        stats->hits += shard.hits;
+        stats->evictions += shard.evictions;
+        stats->bytes_resident += shard.bytes;
+        stats->entries_resident += shard.entry_count;
+        for (int i = 0; i < HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS; i++) {
+            stats->key_size_lookups[i] += shard.key_size_lookups[i];
+            stats->key_size_hits[i] += shard.key_size_hits[i];
+        }
+    }
+    stats->misses = stats->lookups - stats->hits;
+    stats->max_bytes = __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+    stats->persistent_hits = __atomic_load_n(&persistent_hits, __ATOMIC_RELAXED);
+    stats->persistent_stores = __atomic_load_n(&persistent_stores, __ATOMIC_RELAXED);
+    return 0;
 }
 
 namespace {
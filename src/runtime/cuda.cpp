@@ -1244,6 +1244,54 @@ WEAK int halide_cuda_compute_capability(void *user_context, int *major, int *min
     return 0;
 }
 
+WEAK int halide_cuda_get_device_ordinal(void *user_context, uint64_t device_ptr, int *ordinal) {
+    Context ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    CUresult err;
+    if (device_ptr != 0) {
+        err = cuPointerGetAttribute(ordinal, CU_POINTER_ATTRIBUTE_DEVICE_ORDINAL, (CUdeviceptr)device_ptr);
+        if (err != CUDA_SUCCESS) {
+            error(user_context)
+                << "CUDA: cuPointerGetAttribute failed ("
+                << Halide::Runtime::Internal::Cuda::get_error_name(err)
+                << ")";
+        }
+        return err;
+    }
+
+    CUdevice dev;
+    err = cuCtxGetDevice(&dev);
+    if (err != CUDA_SUCCESS) {
+        error(user_context)
+            << "CUDA: cuCtxGetDevice failed ("
+            << Halide::Runtime::Internal::Cuda::get_error_name(err)
+            << ")";
+        return err;
+    }
+
+    int count = 0;
+    err = cuDeviceGetCount(&count);
+    for (int i = 0; err == CUDA_SUCCESS && i < count; i++) {
+        CUdevice d;
+        err = cuDeviceGet(&d, i);
+        if (err == CUDA_SUCCESS && d == dev) {
+            *ordinal = i;
+            return 0;
+        }
+    }
+    if (err == CUDA_SUCCESS) {
+        err = CUDA_ERROR_INVALID_DEVICE;
+    }
+    error(user_context)
+        << "CUDA: Could not find the ordinal of the current device ("
+        << Halide::Runtime::Internal::Cuda::get_error_name(err)
+        << ")";
+    return err;
+}
+
 namespace {
 WEAK __attribute__((destructor)) void halide_cuda_cleanup() {
     compilation_cache.release_all(nullptr, cuModuleUnload);
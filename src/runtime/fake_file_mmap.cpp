@@ -0,0 +1,30 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+WEAK int64_t halide_file_get_size(int fd) {
+    return -1;
+}
+
+WEAK int halide_file_set_size(int fd, uint64_t size) {
+    return -1;
+}
+
+WEAK void *halide_file_map(int fd, uint64_t offset, size_t size) {
+    return nullptr;
+}
+
+WEAK int halide_file_unmap(void *addr, size_t size) {
+    return -1;
+}
+
+WEAK int halide_file_lock(int fd) {
+    return -1;
+}
+
+WEAK int halide_file_unlock(int fd) {
+    return -1;
+}
+
+}  // extern "C"
@@ -0,0 +1,22 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    return 1;
+}
+
+WEAK int halide_bind_thread_to_numa_node(int node) {
+    return 0;
+}
+
+WEAK void *halide_numa_malloc(void *user_context, size_t x) {
+    return halide_default_malloc(user_context, x);
+}
+
+WEAK void halide_numa_free(void *user_context, void *ptr) {
+    halide_default_free(user_context, ptr);
+}
+
+}  // extern "C"
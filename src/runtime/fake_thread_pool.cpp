@@ -83,6 +83,10 @@ WEAK void halide_join_thread(halide_thread *thread_arg) {
     halide_error(nullptr, "halide_join_thread not implemented on this platform.");
 }
 
+WEAK bool halide_can_spawn_threads() {
+    return false;
+}
+
 // Don't need to do anything with mutexes since we are in a fake thread pool.
 WEAK void halide_mutex_lock(halide_mutex *mutex) {
 }
@@ -0,0 +1,122 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+extern size_t fread(void *, size_t, size_t, void *);
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern int posix_memalign(void **memptr, size_t alignment, size_t size);
+extern int madvise(void *addr, size_t length, int advice);
+extern int getpagesize();
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+#define MADV_DONTNEED 4
+
+// Enough for the largest cpu and node numbers we care about.
+#define MAX_NUMA_CPUS 1024
+
+// Read a small sysfs file into buf as a nul-terminated string. Returns
+// false if it can't be read.
+WEAK bool read_sysfs_file(const char *path, char *buf, size_t size) {
+    void *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    size_t bytes = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[bytes] = 0;
+    return bytes > 0;
+}
+
+// Parse a sysfs list like "0-7,16-23" and call f on each entry.
+template<typename F>
+ALWAYS_INLINE void for_each_in_sysfs_list(const char *list, F f) {
+    const char *p = list;
+    while (*p >= '0' && *p <= '9') {
+        int first = atoi(p);
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        int last = first;
+        if (*p == '-') {
+            p++;
+            last = atoi(p);
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        for (int i = first; i <= last; i++) {
+            f(i);
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    char buf[256];
+    if (!read_sysfs_file("/sys/devices/system/node/online", buf, sizeof(buf))) {
+        return 1;
+    }
+    int count = 0;
+    for_each_in_sysfs_list(buf, [&](int node) {
+        count = max(count, node + 1);
+    });
+    return max(count, 1);
+}
+
+WEAK int halide_bind_thread_to_numa_node(int node) {
+    char path[64];
+    char *end = path + sizeof(path);
+    char *dst = halide_string_to_string(path, end, "/sys/devices/system/node/node");
+    dst = halide_int64_to_string(dst, end, node, 1);
+    halide_string_to_string(dst, end, "/cpulist");
+
+    char buf[1024];
+    if (!read_sysfs_file(path, buf, sizeof(buf))) {
+        return -1;
+    }
+
+    uint64_t mask[MAX_NUMA_CPUS / 64];
+    memset(mask, 0, sizeof(mask));
+    for_each_in_sysfs_list(buf, [&](int cpu) {
+        if (cpu < MAX_NUMA_CPUS) {
+            mask[cpu / 64] |= ((uint64_t)1) << (cpu % 64);
+        }
+    });
+    return sched_setaffinity(0, sizeof(mask), mask);
+}
+
+WEAK void *halide_numa_malloc(void *user_context, size_t x) {
+    // Round up to whole pages so that no other allocation shares them,
+    // then drop any physical pages the allocator recycled. The memory
+    // is then placed on the node of whichever thread first writes to it.
+    const size_t page_size = getpagesize();
+    size_t size = (x + page_size - 1) & ~(page_size - 1);
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, page_size, size) != 0) {
+        return nullptr;
+    }
+    madvise(ptr, size, MADV_DONTNEED);
+    return ptr;
+}
+
+WEAK void halide_numa_free(void *user_context, void *ptr) {
+    free(ptr);
+}
+
+}  // extern "C"
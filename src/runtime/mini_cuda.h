@@ -230,6 +230,7 @@ typedef struct CUDA_MEMCPY3D_st {
 } CUDA_MEMCPY3D;
 
 #define CU_POINTER_ATTRIBUTE_CONTEXT 1
+#define CU_POINTER_ATTRIBUTE_DEVICE_ORDINAL 9
 
 }  // namespace Cuda
 }  // namespace Internal
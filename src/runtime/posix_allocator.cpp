@@ -2,28 +2,259 @@
 #include "runtime_internal.h"
 
 #include "printer.h"
+#include "scoped_mutex_lock.h"
 
 extern "C" {
 
 extern void *malloc(size_t);
 extern void free(void *);
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// An optional pool of host allocations, turned on with
+// halide_reuse_host_allocations or HL_REUSE_HOST_ALLOCATIONS=1. Requests
+// are rounded up to one of a set of size classes, four per power of
+// two, and freed blocks are kept on per-class free lists for reuse.
+//
+// The free lists are split into stripes, each with its own lock. A
+// thread uses the stripe picked by the address of its stack, so
+// threads usually get their own stripe, and a block freed by a thread
+// is handed back to the same thread by its next allocation of that
+// size.
+
+const int kMinPooledSizeLog2 = 6;
+const int kMaxPooledSizeLog2 = 25;
+const int kNumSizeClasses = 1 + (kMaxPooledSizeLog2 - kMinPooledSizeLog2) * 4;
+const int kHostPoolStripeBits = 4;
+const int kHostPoolStripes = 1 << kHostPoolStripeBits;
+
+// The most bytes the pool will hold on to, across all stripes, and
+// the most blocks of one size class a stripe will hold on to. Freed
+// blocks beyond these limits go straight back to the system.
+const int64_t kMaxPooledBytes = 256 * 1024 * 1024;
+const int kMaxPooledBlocksPerClass = 16;
+
+struct HostPoolStripe {
+    halide_mutex lock;
+    void *free_list[kNumSizeClasses];
+    int count[kNumSizeClasses];
+};
+
+WEAK HostPoolStripe host_pool_stripes[kHostPoolStripes];
+WEAK int64_t host_pool_bytes = 0;
+
+// For halide_host_allocation_get_stats.
+WEAK uint64_t host_pool_hits = 0;
+WEAK uint64_t host_system_mallocs = 0;
+WEAK uint64_t host_system_frees = 0;
+
+ALWAYS_INLINE void *system_malloc(size_t x) {
+    void *ptr = malloc(x);
+    if (ptr) {
+        __atomic_fetch_add(&host_system_mallocs, 1, __ATOMIC_RELAXED);
+    }
+    return ptr;
+}
+
+ALWAYS_INLINE void system_free(void *ptr) {
+    __atomic_fetch_add(&host_system_frees, 1, __ATOMIC_RELAXED);
+    free(ptr);
+}
+
+// -1 until HL_REUSE_HOST_ALLOCATIONS has been read.
+WEAK int host_pool_enabled = -1;
+
+ALWAYS_INLINE bool host_pool_is_enabled() {
+    int enabled = __atomic_load_n(&host_pool_enabled, __ATOMIC_RELAXED);
+    if (enabled < 0) {
+        const char *var = getenv("HL_REUSE_HOST_ALLOCATIONS");
+        enabled = (var && atoi(var) != 0) ? 1 : 0;
+        int unset = -1;
+        if (!__atomic_compare_exchange_n(&host_pool_enabled, &unset, enabled, false,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            enabled = unset;
+        }
+    }
+    return enabled != 0;
+}
+
+// Returns the size class for an allocation of x bytes, or -1 if it is
+// too large to pool, and sets *class_size to the bytes the class holds.
+ALWAYS_INLINE int size_class_of(size_t x, size_t *class_size) {
+    if (x <= ((size_t)1 << kMinPooledSizeLog2)) {
+        *class_size = (size_t)1 << kMinPooledSizeLog2;
+        return 0;
+    }
+    if (x > ((size_t)1 << kMaxPooledSizeLog2)) {
+        return -1;
+    }
+    // 2^k < x <= 2^(k+1). Round up to the next quarter step.
+    int k = 63 - __builtin_clzll((uint64_t)(x - 1));
+    size_t step = (size_t)1 << (k - 2);
+    size_t sub = (x - 1 - ((size_t)1 << k)) / step;
+    *class_size = ((size_t)1 << k) + (sub + 1) * step;
+    return 1 + (k - kMinPooledSizeLog2) * 4 + (int)sub;
+}
+
+// The inverse of size_class_of.
+ALWAYS_INLINE size_t class_size_of(int size_class) {
+    if (size_class == 0) {
+        return (size_t)1 << kMinPooledSizeLog2;
+    }
+    int k = (size_class - 1) / 4 + kMinPooledSizeLog2;
+    size_t sub = (size_class - 1) % 4;
+    return ((size_t)1 << k) + (sub + 1) * ((size_t)1 << (k - 2));
+}
+
+ALWAYS_INLINE HostPoolStripe &current_stripe() {
+    // Each thread's stack is a separate region, usually at least a
+    // megabyte in size, so the stack address is a cheap stand-in for
+    // a thread id.
+    uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+    uint32_t h = (uint32_t)(sp >> 20) * 0x9e3779b1u;
+    return host_pool_stripes[h >> (32 - kHostPoolStripeBits)];
+}
+
+// Allocations reserve two words before the returned pointer: the
+// pointer malloc returned, and the size class plus one (or zero for
+// blocks that don't belong to the pool).
+ALWAYS_INLINE void *aligned_block(void *orig, size_t size_class_plus_one) {
+    const size_t alignment = halide_malloc_alignment();
+    void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void *) - 1) & ~(alignment - 1));
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = size_class_plus_one;
+    return ptr;
+}
+
+ALWAYS_INLINE void *pop_block(HostPoolStripe &stripe, int size_class) {
+    ScopedMutexLock lock(&stripe.lock);
+    void *ptr = stripe.free_list[size_class];
+    if (ptr) {
+        stripe.free_list[size_class] = *(void **)ptr;
+        stripe.count[size_class]--;
+    }
+    return ptr;
+}
+
+WEAK void *pooled_malloc(size_t x) {
+    size_t class_size;
+    int size_class = size_class_of(x, &class_size);
+    if (size_class < 0) {
+        return nullptr;
+    }
+
+    HostPoolStripe &mine = current_stripe();
+    void *ptr = pop_block(mine, size_class);
+    for (int i = 0; !ptr && i < kHostPoolStripes; i++) {
+        // Other threads may have freed blocks of this size. Looking
+        // is still much cheaper than going to the system.
+        if (&host_pool_stripes[i] != &mine) {
+            ptr = pop_block(host_pool_stripes[i], size_class);
+        }
+    }
+    if (ptr) {
+        __atomic_fetch_sub(&host_pool_bytes, (int64_t)class_size, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&host_pool_hits, 1, __ATOMIC_RELAXED);
+        return ptr;
+    }
+
+    void *orig = system_malloc(class_size + halide_malloc_alignment() + sizeof(void *));
+    if (orig == nullptr) {
+        return nullptr;
+    }
+    return aligned_block(orig, size_class + 1);
+}
+
+// Returns true if the pool took ownership of the block.
+WEAK bool pooled_free(void *ptr, int size_class) {
+    size_t class_size = class_size_of(size_class);
+    int64_t new_total = __atomic_add_fetch(&host_pool_bytes, (int64_t)class_size, __ATOMIC_RELAXED);
+    if (new_total <= kMaxPooledBytes) {
+        HostPoolStripe &stripe = current_stripe();
+        ScopedMutexLock lock(&stripe.lock);
+        if (stripe.count[size_class] < kMaxPooledBlocksPerClass) {
+            *(void **)ptr = stripe.free_list[size_class];
+            stripe.free_list[size_class] = ptr;
+            stripe.count[size_class]++;
+            return true;
+        }
+    }
+    __atomic_fetch_sub(&host_pool_bytes, (int64_t)class_size, __ATOMIC_RELAXED);
+    return false;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
 
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
-    // Allocate enough space for aligning the pointer we return.
+    if (host_pool_is_enabled()) {
+        void *ptr = pooled_malloc(x);
+        if (ptr) {
+            return ptr;
+        }
+    }
+
+    // Allocate enough space for aligning the pointer we return, and
+    // for the two words of bookkeeping before it.
     const size_t alignment = halide_malloc_alignment();
-    void *orig = malloc(x + alignment);
+    void *orig = system_malloc(x + alignment + sizeof(void *));
     if (orig == nullptr) {
         // Will result in a failed assertion and a call to halide_error
         return nullptr;
     }
-    // We want to store the original pointer prior to the pointer we return.
-    void *ptr = (void *)(((size_t)orig + alignment + sizeof(void *) - 1) & ~(alignment - 1));
-    ((void **)ptr)[-1] = orig;
-    return ptr;
+    return aligned_block(orig, 0);
 }
 
 WEAK void halide_default_free(void *user_context, void *ptr) {
-    free(((void **)ptr)[-1]);
+    size_t size_class_plus_one = ((size_t *)ptr)[-2];
+    if (size_class_plus_one &&
+        host_pool_is_enabled() &&
+        pooled_free(ptr, (int)size_class_plus_one - 1)) {
+        return;
+    }
+    system_free(((void **)ptr)[-1]);
+}
+
+WEAK int halide_reuse_host_allocations(void *user_context, bool flag) {
+    __atomic_store_n(&host_pool_enabled, flag ? 1 : 0, __ATOMIC_RELAXED);
+    if (!flag) {
+        return halide_release_unused_host_allocations(user_context);
+    }
+    return 0;
+}
+
+WEAK int halide_release_unused_host_allocations(void *user_context) {
+    for (int i = 0; i < kHostPoolStripes; i++) {
+        HostPoolStripe &stripe = host_pool_stripes[i];
+        ScopedMutexLock lock(&stripe.lock);
+        for (int c = 0; c < kNumSizeClasses; c++) {
+            void *ptr = stripe.free_list[c];
+            while (ptr) {
+                void *next = *(void **)ptr;
+                system_free(((void **)ptr)[-1]);
+                __atomic_fetch_sub(&host_pool_bytes, (int64_t)class_size_of(c), __ATOMIC_RELAXED);
+                ptr = next;
+            }
+            stripe.free_list[c] = nullptr;
+            stripe.count[c] = 0;
+        }
+    }
+    return 0;
+}
+
+WEAK int halide_host_allocation_get_stats(struct halide_host_allocation_stats *stats) {
+    stats->pool_hits = __atomic_load_n(&host_pool_hits, __ATOMIC_RELAXED);
+    stats->system_mallocs = __atomic_load_n(&host_system_mallocs, __ATOMIC_RELAXED);
+    stats->system_frees = __atomic_load_n(&host_system_frees, __ATOMIC_RELAXED);
+    return 0;
 }
 }
 
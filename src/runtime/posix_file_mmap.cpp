@@ -0,0 +1,57 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+extern int ftruncate(int fd, long length);
+extern long lseek(int fd, long offset, int whence);
+extern int flock(int fd, int operation);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+#define PROT_READ 1
+#define PROT_WRITE 2
+#define MAP_SHARED 1
+#define MAP_FAILED ((void *)-1)
+#define SEEK_END 2
+#define LOCK_EX 2
+#define LOCK_UN 8
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+WEAK int64_t halide_file_get_size(int fd) {
+    return lseek(fd, 0, SEEK_END);
+}
+
+WEAK int halide_file_set_size(int fd, uint64_t size) {
+    return ftruncate(fd, (long)size);
+}
+
+WEAK void *halide_file_map(int fd, uint64_t offset, size_t size) {
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (long)offset);
+    return addr == MAP_FAILED ? nullptr : addr;
+}
+
+WEAK int halide_file_unmap(void *addr, size_t size) {
+    return munmap(addr, size);
+}
+
+WEAK int halide_file_lock(int fd) {
+    return flock(fd, LOCK_EX);
+}
+
+WEAK int halide_file_unlock(int fd) {
+    return flock(fd, LOCK_UN);
+}
+
+}  // extern "C"
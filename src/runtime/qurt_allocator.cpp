@@ -126,4 +126,28 @@ WEAK void *halide_malloc(void *user_context, size_t x) {
 WEAK void halide_free(void *user_context, void *ptr) {
     halide_default_free(user_context, ptr);
 }
+
+// The pre-allocated buffers above are always reused, so there is
+// nothing to turn on or off.
+WEAK int halide_reuse_host_allocations(void *user_context, bool flag) {
+    return 0;
+}
+
+WEAK int halide_release_unused_host_allocations(void *user_context) {
+    for (int i = 0; i < num_buffers; ++i) {
+        if (__sync_val_compare_and_swap(buf_is_used + i, 0, 1) == 0) {
+            aligned_free(mem_buf[i]);
+            mem_buf[i] = nullptr;
+            __sync_synchronize();
+            buf_is_used[i] = 0;
+        }
+    }
+    return 0;
+}
+
+// The pre-allocated buffers aren't tracked.
+WEAK int halide_host_allocation_get_stats(struct halide_host_allocation_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    return 0;
+}
 }
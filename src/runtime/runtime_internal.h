@@ -157,6 +157,22 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         int num_funcs,
                                         const uint64_t *func_names);
 WEAK int halide_host_cpu_count();
+WEAK int halide_host_numa_node_count();
+WEAK int halide_bind_thread_to_numa_node(int node);
+WEAK bool halide_can_spawn_threads();
+
+// Used by tracing to write into a memory-mapped trace file, and by
+// the memoization cache to share a memory-mapped file between
+// processes. The lock is an advisory lock on the whole file, which
+// the OS drops if the process holding it dies. Where memory-mapping
+// files isn't supported, halide_file_map returns nullptr and
+// the others fail.
+WEAK int64_t halide_file_get_size(int fd);
+WEAK int halide_file_set_size(int fd, uint64_t size);
+WEAK void *halide_file_map(int fd, uint64_t offset, size_t size);
+WEAK int halide_file_unmap(void *addr, size_t size);
+WEAK int halide_file_lock(int fd);
+WEAK int halide_file_unlock(int fd);
 
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
@@ -23,6 +23,16 @@ namespace Halide {
 namespace Runtime {
 namespace Internal {
 
+// A contiguous range of loop iterations [begin, end), relative to the
+// min of the owning job, packed into a single 64-bit word so that the
+// worker that owns it and any thieves can all claim iterations with one
+// compare-and-swap. Padded out to a cache line so that workers claiming
+// from neighboring ranges don't contend.
+struct steal_range {
+    uint64_t bounds;
+    uint8_t padding[64 - sizeof(uint64_t)];
+};
+
 struct work {
     halide_parallel_task_t task;
 
@@ -43,6 +53,16 @@ struct work {
     // which condition variable is the owner sleeping on. nullptr if it isn't sleeping.
     bool owner_is_sleeping;
 
+    // In work-stealing mode, the iterations of a plain data-parallel
+    // job are split across one range per potential worker. Workers
+    // claim iterations from their own range and steal from the others
+    // without holding the work queue lock. nullptr for jobs that go
+    // through the locked queue one iteration at a time.
+    steal_range *ranges;
+    int num_ranges;
+    // The next range to hand to a worker joining this job.
+    int next_range;
+
     ALWAYS_INLINE bool make_runnable() {
         for (; next_semaphore < task.num_semaphores; next_semaphore++) {
             if (!halide_default_semaphore_try_acquire(task.semaphores[next_semaphore].semaphore,
@@ -90,6 +110,20 @@ WEAK int default_desired_num_threads() {
     return desired_num_threads;
 }
 
+WEAK bool default_work_stealing() {
+    char *stealing_str = getenv("HL_THREAD_POOL_WORK_STEALING");
+    return stealing_str && atoi(stealing_str) != 0;
+}
+
+WEAK int default_numa_nodes() {
+    char *numa_str = getenv("HL_THREAD_POOL_NUMA");
+    if (!numa_str || atoi(numa_str) == 0) {
+        return 0;
+    }
+    int nodes = halide_host_numa_node_count();
+    return nodes > 1 ? nodes : 0;
+}
+
 // The work queue and thread pool is weak, so one big work queue is shared by all halide functions
 struct work_queue_t {
     // all fields are protected by this mutex.
@@ -132,6 +166,14 @@ struct work_queue_t {
     // whether the thread pool has been initialized.
     bool shutdown, initialized;
 
+    // Whether data-parallel jobs should be split into per-worker
+    // ranges that idle workers steal from (HL_THREAD_POOL_WORK_STEALING).
+    bool work_stealing;
+
+    // The number of NUMA nodes workers are spread across, or zero if
+    // NUMA mode (HL_THREAD_POOL_NUMA) is off.
+    int numa_nodes;
+
     // The number of threads that are currently commited to possibly block
     // via outstanding jobs queued or being actively worked on. Used to limit
     // the number of iterations of parallel for loops that are invoked so as
@@ -192,9 +234,192 @@ WEAK void dump_job_state() {
 #define dump_job_state()
 #endif
 
+ALWAYS_INLINE uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+ALWAYS_INLINE uint32_t range_begin(uint64_t bounds) {
+    return (uint32_t)bounds;
+}
+
+ALWAYS_INLINE uint32_t range_end(uint64_t bounds) {
+    return (uint32_t)(bounds >> 32);
+}
+
+ALWAYS_INLINE uint32_t range_size(uint64_t bounds) {
+    return range_begin(bounds) < range_end(bounds) ? range_end(bounds) - range_begin(bounds) : 0;
+}
+
+// How many iterations a worker claims at once from a range with n
+// iterations remaining. Claimed iterations can no longer be stolen, so
+// only take a fraction of what is left.
+ALWAYS_INLINE uint32_t claim_chunk_size(uint32_t n) {
+    return 1 + n / 8;
+}
+
+// Only jobs that can't block and that any thread may work on are
+// eligible for stealing. Everything else keeps going through the locked
+// queue, which is what implements min_threads reservation and the
+// semaphores used by async producers.
+ALWAYS_INLINE bool can_steal_from(const halide_parallel_task_t &task) {
+    return work_queue.work_stealing &&
+           !task.serial &&
+           task.min_threads == 0 &&
+           task.num_semaphores == 0 &&
+           task.extent > 1;
+}
+
+// In NUMA mode, range i of every job is processed by the same worker,
+// and consecutive ranges belong to workers pinned to the same node, so
+// a given part of the iteration space of a parallel loop stays on one
+// node from one loop to the next. Combined with first-touch page
+// placement, that keeps most memory accesses node-local.
+ALWAYS_INLINE int numa_node_of_range(int index, int num_ranges) {
+    return min(index * work_queue.numa_nodes / max(num_ranges, 1), work_queue.numa_nodes - 1);
+}
+
+// Split the iterations of a job evenly across num_ranges ranges. The
+// ranges must outlive the job.
+WEAK void init_steal_ranges(work *job, steal_range *ranges, int num_ranges) {
+    // In NUMA mode the ranges correspond to workers, so keep all of
+    // them even if some end up empty.
+    if (!work_queue.numa_nodes && num_ranges > job->task.extent) {
+        num_ranges = job->task.extent;
+    }
+    for (int i = 0; i < num_ranges; i++) {
+        uint32_t begin = (uint32_t)(((int64_t)job->task.extent * i) / num_ranges);
+        uint32_t end = (uint32_t)(((int64_t)job->task.extent * (i + 1)) / num_ranges);
+        ranges[i].bounds = pack_range(begin, end);
+    }
+    job->ranges = ranges;
+    job->num_ranges = num_ranges;
+    job->next_range = 0;
+}
+
+// Claim iterations from the front or back of a range. If steal_half is
+// set, take half of what remains instead of a chunk. Returns the number
+// of iterations claimed, which is zero if the range was empty.
+WEAK uint32_t claim_from_range(steal_range *range, bool from_front, bool steal_half, uint32_t *begin) {
+    uint64_t old_bounds;
+    Synchronization::atomic_load_relaxed(&range->bounds, &old_bounds);
+    while (true) {
+        uint32_t n = range_size(old_bounds);
+        if (n == 0) {
+            return 0;
+        }
+        uint32_t take = steal_half ? (n + 1) / 2 : claim_chunk_size(n);
+        uint64_t new_bounds;
+        if (from_front) {
+            *begin = range_begin(old_bounds);
+            new_bounds = pack_range(*begin + take, range_end(old_bounds));
+        } else {
+            *begin = range_end(old_bounds) - take;
+            new_bounds = pack_range(range_begin(old_bounds), *begin);
+        }
+        if (Synchronization::atomic_cas_weak_relacq_relaxed(&range->bounds, &old_bounds, &new_bounds)) {
+            return take;
+        }
+    }
+}
+
+// Steal iterations from the back of whichever range has the most left.
+// Thieves with a range of their own take half, so that they can be
+// stolen from in turn. In NUMA mode, ranges on the thief's own node are
+// preferred. Returns zero once every range is empty.
+WEAK uint32_t steal_iterations(work *job, steal_range *mine, uint32_t *begin) {
+    int node = -1;
+    if (work_queue.numa_nodes && mine) {
+        node = numa_node_of_range((int)(mine - job->ranges), job->num_ranges);
+    }
+    while (true) {
+        steal_range *victim = nullptr;
+        uint32_t most = 0;
+        for (int i = 0; i < job->num_ranges; i++) {
+            if (node >= 0 && numa_node_of_range(i, job->num_ranges) != node) {
+                continue;
+            }
+            uint64_t bounds;
+            Synchronization::atomic_load_relaxed(&job->ranges[i].bounds, &bounds);
+            if (range_size(bounds) > most) {
+                most = range_size(bounds);
+                victim = job->ranges + i;
+            }
+        }
+        if (!victim) {
+            if (node >= 0) {
+                // Nothing left on this node. Try the others.
+                node = -1;
+                continue;
+            }
+            return 0;
+        }
+        uint32_t iters = claim_from_range(victim, false, mine != nullptr, begin);
+        if (iters) {
+            return iters;
+        }
+        // Lost a race with the owner or another thief. Look again.
+    }
+}
+
+// Run iterations of a work-stealing job until there are none left to
+// claim or steal. Claims iterations from the given range first, or from
+// the next unclaimed one if index is negative. No two threads may work
+// on the same range at the same time. Called without the work queue
+// lock held.
+WEAK int work_on_steal_ranges(work *job, int index) {
+    if (index < 0) {
+        index = Synchronization::atomic_fetch_add_acquire_release(&job->next_range, 1);
+    }
+    steal_range *mine = index < job->num_ranges ? job->ranges + index : nullptr;
+
+    int result = 0;
+    while (result == 0) {
+        uint32_t begin = 0;
+        uint32_t iters = mine ? claim_from_range(mine, true, false, &begin) : 0;
+        if (iters == 0) {
+            iters = steal_iterations(job, mine, &begin);
+            if (iters == 0) {
+                break;
+            }
+            if (mine) {
+                // Our own range is empty and nobody else ever refills
+                // it, so it's safe to publish the stolen iterations
+                // there with a plain store.
+                uint64_t bounds = pack_range(begin, begin + iters);
+                Synchronization::atomic_store_release(&mine->bounds, &bounds);
+                continue;
+            }
+        }
+
+        log_message("Stealing job " << job->task.name << " running " << iters << " iterations at " << begin);
+        if (job->task_fn) {
+            for (uint32_t i = 0; i < iters && result == 0; i++) {
+                result = halide_do_task(job->user_context, job->task_fn,
+                                        job->task.min + (int)(begin + i), job->task.closure);
+            }
+        } else {
+            result = halide_do_loop_task(job->user_context, job->task.fn,
+                                         job->task.min + (int)begin, (int)iters,
+                                         job->task.closure, job);
+        }
+    }
+
+    if (result != 0) {
+        // Drain every range so the other workers stop promptly.
+        for (int i = 0; i < job->num_ranges; i++) {
+            uint32_t ignored;
+            while (claim_from_range(job->ranges + i, true, true, &ignored)) {
+            }
+        }
+    }
+    return result;
+}
+
 WEAK void worker_thread(void *);
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+// worker_index is the index of a thread spawned by the thread pool when
+// called from the top of that thread, and -1 otherwise.
+WEAK void worker_thread_already_locked(work *owned_job, int worker_index = -1) {
     int spin_count = 0;
     const int max_spin_count = 40;
 
@@ -327,7 +552,39 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
         int result = 0;
 
-        if (job->task.serial) {
+        if (job->ranges) {
+            // Release the lock and claim or steal iterations until
+            // there are none left.
+            int range_index = -1;
+            if (work_queue.numa_nodes) {
+                // Range 0 belongs to the thread that owns the job and
+                // range i + 1 to worker i. Any other thread only
+                // steals.
+                if (job == owned_job) {
+                    range_index = 0;
+                } else if (worker_index >= 0) {
+                    range_index = worker_index + 1;
+                } else {
+                    range_index = job->num_ranges;
+                }
+            }
+            halide_mutex_unlock(&work_queue.mutex);
+            result = work_on_steal_ranges(job, range_index);
+            halide_mutex_lock(&work_queue.mutex);
+
+            // This worker found every range empty, or failed, so
+            // there's no point in more workers joining. Take the job
+            // off the stack if nobody else already has. Iterations
+            // still in flight are covered by active_workers.
+            if (job->task.extent != 0) {
+                work **job_ptr = &work_queue.jobs;
+                while (*job_ptr != job) {
+                    job_ptr = &((*job_ptr)->next_job);
+                }
+                *job_ptr = job->next_job;
+                job->task.extent = 0;
+            }
+        } else if (job->task.serial) {
             // Remove it from the stack while we work on it
             *prev_ptr = job->next_job;
 
@@ -436,7 +693,24 @@ WEAK void worker_thread(void *arg) {
     halide_mutex_unlock(&work_queue.mutex);
 }
 
-WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+// The entry point for workers in NUMA mode. The argument is the index
+// of the worker.
+WEAK void numa_worker_thread(void *arg) {
+    int worker_index = (int)(intptr_t)arg;
+    halide_mutex_lock(&work_queue.mutex);
+    int node = numa_node_of_range(worker_index + 1, work_queue.desired_threads_working);
+    halide_mutex_unlock(&work_queue.mutex);
+
+    if (halide_bind_thread_to_numa_node(node) != 0) {
+        log_message("Failed to bind worker " << worker_index << " to NUMA node " << node);
+    }
+
+    halide_mutex_lock(&work_queue.mutex);
+    worker_thread_already_locked(nullptr, worker_index);
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
+WEAK void initialize_work_queue_already_locked() {
     if (!work_queue.initialized) {
         work_queue.assert_zeroed();
 
@@ -447,8 +721,19 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             work_queue.desired_threads_working = default_desired_num_threads();
         }
         work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
+        work_queue.work_stealing = default_work_stealing();
+        work_queue.numa_nodes = default_numa_nodes();
+        if (work_queue.numa_nodes) {
+            // NUMA mode hands out iterations through the per-worker
+            // ranges, so it implies work stealing.
+            work_queue.work_stealing = true;
+        }
         work_queue.initialized = true;
     }
+}
+
+WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+    initialize_work_queue_already_locked();
 
     // Gather some information about the work.
 
@@ -506,8 +791,14 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             // We might need to make some new threads, if work_queue.desired_threads_working has
             // increased, or if there aren't enough threads to complete this new task.
             work_queue.a_team_size++;
-            work_queue.threads[work_queue.threads_created++] =
-                halide_spawn_thread(worker_thread, nullptr);
+            int worker_index = work_queue.threads_created++;
+            if (work_queue.numa_nodes) {
+                work_queue.threads[worker_index] =
+                    halide_spawn_thread(numa_worker_thread, (void *)(intptr_t)worker_index);
+            } else {
+                work_queue.threads[worker_index] =
+                    halide_spawn_thread(worker_thread, nullptr);
+            }
         }
         log_message("enqueue_work_already_locked top level job " << jobs[0].task.name << " with min_threads " << min_threads << " work_queue.threads_created " << work_queue.threads_created << " work_queue.threads_reserved " << work_queue.threads_reserved);
         if (job_has_acquires || job_may_block) {
@@ -622,7 +913,15 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.siblings = &job;  // guarantees no other job points to the same siblings.
     job.sibling_count = 0;
     job.parent_job = nullptr;
+    job.ranges = nullptr;
+    job.num_ranges = 0;
+    job.next_range = 0;
     halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked();
+    if (can_steal_from(job.task)) {
+        int num_ranges = max(work_queue.desired_threads_working, work_queue.threads_created + 1);
+        init_steal_ranges(&job, (steal_range *)__builtin_alloca(sizeof(steal_range) * num_ranges), num_ranges);
+    }
     enqueue_work_already_locked(1, &job, nullptr);
     worker_thread_already_locked(&job);
     halide_mutex_unlock(&work_queue.mutex);
@@ -648,6 +947,9 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         jobs[i].next_semaphore = 0;
         jobs[i].owner_is_sleeping = false;
         jobs[i].parent_job = (work *)task_parent;
+        jobs[i].ranges = nullptr;
+        jobs[i].num_ranges = 0;
+        jobs[i].next_range = 0;
     }
 
     if (num_tasks == 0) {
@@ -655,6 +957,24 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     }
 
     halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked();
+    int num_stealable = 0;
+    for (int i = 0; i < num_tasks; i++) {
+        if (can_steal_from(jobs[i].task)) {
+            num_stealable++;
+        }
+    }
+    if (num_stealable > 0) {
+        // Allocate the ranges for all the tasks at once, like the jobs.
+        int num_ranges = max(work_queue.desired_threads_working, work_queue.threads_created + 1);
+        steal_range *ranges = (steal_range *)__builtin_alloca(sizeof(steal_range) * num_ranges * num_stealable);
+        for (int i = 0; i < num_tasks; i++) {
+            if (can_steal_from(jobs[i].task)) {
+                init_steal_ranges(jobs + i, ranges, num_ranges);
+                ranges += num_ranges;
+            }
+        }
+    }
     enqueue_work_already_locked(num_tasks, jobs, (work *)task_parent);
     int exit_status = 0;
     for (int i = 0; i < num_tasks; i++) {
@@ -686,6 +1006,10 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+WEAK bool halide_can_spawn_threads() {
+    return true;
+}
+
 WEAK void halide_shutdown_thread_pool() {
     if (work_queue.initialized) {
         // Wake everyone up and tell them the party's over and it's time
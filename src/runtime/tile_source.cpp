@@ -0,0 +1,19 @@
+#include "HalideRuntime.h"
+
+extern "C" {
+
+WEAK int halide_fetch_tile(void *user_context, const halide_tile_source_t *source,
+                           halide_buffer_t *dst) {
+    if (dst->is_bounds_query()) {
+        // There are no inputs to infer bounds on. The region wanted
+        // is already in dst.
+        return 0;
+    }
+    if (source == nullptr || source->fetch == nullptr) {
+        halide_error(user_context, "halide_fetch_tile called with no tile source\n");
+        return halide_error_code_generic_error;
+    }
+    return source->fetch(user_context, source->source_context, dst);
+}
+
+}  // extern "C"
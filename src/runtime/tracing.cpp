@@ -11,138 +11,364 @@ namespace Halide {
 namespace Runtime {
 namespace Internal {
 
-// A spinlock that allows for shared and exclusive access. It's
-// equivalent to a reader-writer lock, but in my case the "readers"
-// will actually be writing simultaneously to the trace buffer, so
-// that's a bad name. We use the __sync primitives used elsewhere in
-// the runtime for atomic work. They are well supported by clang.
-class SharedExclusiveSpinLock {
-    volatile uint32_t lock = 0;
-
-    // Covers a single bit indicating one owner has exclusive
-    // access. The waiting bit can be set while the exclusive bit is
-    // set, but the bits masked by shared_mask must be zero while this
-    // bit is set.
-    const static uint32_t exclusive_held_mask = 0x80000000;
-
-    // Set to indicate a thread needs to acquire exclusive
-    // access. Other fields of the lock may be set, but no shared
-    // access request will proceed while this bit is set.
-    const static uint32_t exclusive_waiting_mask = 0x40000000;
-
-    // Count of threads currently holding shared access. Must be zero
-    // if the exclusive bit is set. Cannot increase if the waiting bit
-    // is set.
-    const static uint32_t shared_mask = 0x3fffffff;
+// Binary trace packets are written into a ring buffer. Writers reserve
+// space with a single atomic add on the head of the ring, so threads
+// never wait for each other or for the file unless the ring is full,
+// and packets reach the file in the order they were reserved. That
+// keeps every packet after its parent (the parent's id was handed out
+// before the child was traced), which HalideTraceViz relies on.
+//
+// The ring is divided into chunks. Writers count the bytes they have
+// finished writing into each chunk, and a chunk is handed to the sink
+// once those account for everything reserved in it. Where threads are
+// available, a background thread does that; otherwise writers do it
+// themselves when they run out of space.
+
+const static uint32_t trace_chunk_size = 1024 * 1024;
+const static uint32_t trace_chunks = 16;
+const static uint64_t trace_ring_size = (uint64_t)trace_chunk_size * trace_chunks;
+
+// Packets larger than a chunk are truncated to this.
+const static uint32_t max_packet_size = trace_chunk_size;
+
+// Where flushed trace data goes: either written to the file
+// descriptor, or copied into a window of the file mapped into memory
+// (HL_TRACE_MMAP=1), which avoids a system call per chunk.
+class TraceSink {
+    int fd = -1;
+    uint8_t *map = nullptr;
+    uint64_t map_offset = 0;
+    uint64_t file_size = 0;
+    bool use_mmap = false;
+
+    // Whether the file currently extends to the end of the mapped
+    // window, as it must while data is copied into the window. It is
+    // trimmed back to the data written on each flush.
+    bool extended = false;
+
+    const static uint64_t map_window_size = 64 * 1024 * 1024;
+
+    bool map_window(uint64_t offset) {
+        if (map) {
+            halide_file_unmap(map, map_window_size);
+            map = nullptr;
+        }
+        if (halide_file_set_size(fd, offset + map_window_size) != 0) {
+            return false;
+        }
+        extended = true;
+        map = (uint8_t *)halide_file_map(fd, offset, map_window_size);
+        map_offset = offset;
+        if (!map) {
+            trim();
+            return false;
+        }
+        return true;
+    }
 
 public:
-    ALWAYS_INLINE void acquire_shared() {
-        while (true) {
-            uint32_t x = lock & shared_mask;
-            if (__sync_bool_compare_and_swap(&lock, x, x + 1)) {
-                return;
+    void init(int fd_arg, bool try_mmap) {
+        fd = fd_arg;
+        map = nullptr;
+        use_mmap = false;
+        extended = false;
+        if (try_mmap) {
+            int64_t size = halide_file_get_size(fd);
+            if (size >= 0) {
+                // Mappings must start at a page boundary, so start the
+                // window at a multiple of its size.
+                file_size = (uint64_t)size;
+                use_mmap = map_window(file_size & ~(map_window_size - 1));
+            }
+        }
+    }
+
+    bool write(const uint8_t *data, uint64_t size) {
+        if (!use_mmap) {
+            return size == (uint64_t)::write(fd, data, size);
+        }
+        if (!extended) {
+            if (halide_file_set_size(fd, map_offset + map_window_size) != 0) {
+                return false;
+            }
+            extended = true;
+        }
+        while (size > 0) {
+            if (file_size >= map_offset + map_window_size &&
+                !map_window(map_offset + map_window_size)) {
+                return false;
             }
+            uint64_t n = min(size, map_offset + map_window_size - file_size);
+            memcpy(map + (file_size - map_offset), data, n);
+            file_size += n;
+            data += n;
+            size -= n;
         }
+        return true;
     }
 
-    ALWAYS_INLINE void release_shared() {
-        __sync_fetch_and_sub(&lock, 1);
+    // Cut the file back to the data written, so that it can be read
+    // while tracing continues. The window stays mapped, and the file
+    // is extended again before anything more is copied into it.
+    void trim() {
+        if (extended) {
+            halide_file_set_size(fd, file_size);
+            extended = false;
+        }
     }
 
-    ALWAYS_INLINE void acquire_exclusive() {
-        while (true) {
-            // If multiple threads are trying to acquire exclusive
-            // ownership, we may need to rerequest exclusive waiting
-            // while we spin, as it gets unset whenever a thread
-            // acquires exclusive ownership.
-            __sync_fetch_and_or(&lock, exclusive_waiting_mask);
-            if (__sync_bool_compare_and_swap(&lock, exclusive_waiting_mask, exclusive_held_mask)) {
-                return;
+    void close() {
+        if (use_mmap) {
+            trim();
+            if (map) {
+                halide_file_unmap(map, map_window_size);
+                map = nullptr;
             }
+            use_mmap = false;
         }
     }
+};
 
-    ALWAYS_INLINE void release_exclusive() {
-        __sync_fetch_and_and(&lock, ~exclusive_held_mask);
+class TraceBuffer {
+    // Bytes reserved by writers, and bytes handed to the sink, since
+    // the buffer was created. Offsets into the ring are these modulo
+    // trace_ring_size.
+    uint64_t head, tail;
+
+    // The number of bytes writers have finished writing into each
+    // chunk on the current pass around the ring.
+    uint32_t committed[trace_chunks];
+
+    TraceSink sink;
+
+    // Nonzero while a thread is handing data to the sink. Writers that
+    // need space may be holding reservations the sink is waiting on,
+    // so they must never block on this.
+    uint32_t draining;
+
+    // Used to wake the flusher thread, and by threads waiting for it.
+    halide_mutex flusher_lock;
+    halide_cond flusher_wake, flusher_done;
+    halide_thread *flusher;
+    uint64_t flush_target;
+    bool flusher_should_stop;
+
+    uint8_t buf[trace_ring_size];
+
+    // Hand everything up to target, which must have been reserved, to
+    // the sink. Returns false without doing anything if another thread
+    // is already doing so, and sets *success to false if the sink
+    // failed.
+    bool try_drain(uint64_t target, bool *success) {
+        if (__atomic_exchange_n(&draining, 1, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        uint64_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        while (t < target) {
+            uint64_t chunk_base = t - t % trace_chunk_size;
+            uint64_t chunk_end = chunk_base + trace_chunk_size;
+            uint32_t c = (chunk_base / trace_chunk_size) % trace_chunks;
+
+            // Wait for the writers in this chunk to finish. Read the
+            // commit count before the head: then every byte counted
+            // was reserved below the head read, so if the count
+            // matches the bytes reserved, they are all written.
+            uint64_t limit;
+            while (true) {
+                uint32_t done = __atomic_load_n(&committed[c], __ATOMIC_ACQUIRE);
+                limit = min(__atomic_load_n(&head, __ATOMIC_ACQUIRE), chunk_end);
+                if (done == limit - chunk_base) {
+                    break;
+                }
+                halide_thread_yield();
+            }
+
+            if (!sink.write(buf + t % trace_ring_size, limit - t)) {
+                *success = false;
+            }
+            if (limit == chunk_end) {
+                // Writers on the next pass round the ring can't touch
+                // this chunk until the tail moves past it.
+                __atomic_store_n(&committed[c], 0, __ATOMIC_RELAXED);
+            }
+            t = limit;
+            __atomic_store_n(&tail, t, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+        return true;
     }
 
-    ALWAYS_INLINE void init() {
-        lock = 0;
+    // Hand everything up to target to the sink, waiting for any other
+    // thread doing so.
+    bool drain(uint64_t target) {
+        bool success = true;
+        while (__atomic_load_n(&tail, __ATOMIC_ACQUIRE) < target &&
+               !try_drain(target, &success)) {
+            halide_thread_yield();
+        }
+        return success;
     }
 
-    SharedExclusiveSpinLock() = default;
-};
+    // The start of the first chunk that hasn't been completely handed
+    // to the sink.
+    ALWAYS_INLINE uint64_t free_chunks_begin() {
+        uint64_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+        return t - t % trace_chunk_size;
+    }
 
-const static int buffer_size = 1024 * 1024;
+    // The amount of data in full chunks.
+    ALWAYS_INLINE uint64_t full_chunks_end() {
+        uint64_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        return h - h % trace_chunk_size;
+    }
 
-class TraceBuffer {
-    SharedExclusiveSpinLock lock;
-    uint32_t cursor = 0, overage = 0;
-    uint8_t buf[buffer_size];
-
-    // Attempt to atomically acquire space in the buffer to write a
-    // packet. Returns nullptr if the buffer was full.
-    ALWAYS_INLINE halide_trace_packet_t *try_acquire_packet(void *user_context, uint32_t size) {
-        lock.acquire_shared();
-        halide_assert(user_context, size <= buffer_size);
-        uint32_t my_cursor = __sync_fetch_and_add(&cursor, size);
-        if (my_cursor + size > sizeof(buf)) {
-            // Don't try to back it out: instead, just allow this request to fail
-            // (along with all subsequent requests) and record the 'overage'
-            // that was added and should be ignored; then, in the next flush,
-            // remove the overage.
-            __sync_fetch_and_add(&overage, size);
-            lock.release_shared();
-            return nullptr;
-        } else {
-            return (halide_trace_packet_t *)(buf + my_cursor);
+    static void flusher_thread(void *arg) {
+        ((TraceBuffer *)arg)->flusher_loop();
+    }
+
+    void flusher_loop() {
+        halide_mutex_lock(&flusher_lock);
+        while (true) {
+            uint64_t target = max(flush_target, full_chunks_end());
+            if (target > __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) {
+                halide_mutex_unlock(&flusher_lock);
+                bool success = drain(target);
+                halide_mutex_lock(&flusher_lock);
+                halide_cond_broadcast(&flusher_done);
+                if (!success) {
+                    halide_print(nullptr, "Could not write to trace file\n");
+                }
+            } else if (flusher_should_stop) {
+                break;
+            } else {
+                halide_cond_wait(&flusher_wake, &flusher_lock);
+            }
         }
+        halide_mutex_unlock(&flusher_lock);
+    }
+
+    void wake_flusher(uint64_t target) {
+        halide_mutex_lock(&flusher_lock);
+        flush_target = max(flush_target, target);
+        halide_cond_signal(&flusher_wake);
+        halide_mutex_unlock(&flusher_lock);
     }
 
 public:
-    // Wait for all writers to finish with their packets, stall any
-    // new writers, and flush the buffer to the fd.
-    ALWAYS_INLINE void flush(void *user_context, int fd) {
-        lock.acquire_exclusive();
+    void init(int fd, bool use_mmap, bool use_flusher_thread) {
+        head = 0;
+        tail = 0;
+        for (uint32_t i = 0; i < trace_chunks; i++) {
+            committed[i] = 0;
+        }
+        draining = 0;
+        memset(&flusher_lock, 0, sizeof(flusher_lock));
+        memset(&flusher_wake, 0, sizeof(flusher_wake));
+        memset(&flusher_done, 0, sizeof(flusher_done));
+        flush_target = 0;
+        flusher_should_stop = false;
+        flusher = nullptr;
+        sink.init(fd, use_mmap);
+        if (use_flusher_thread) {
+            flusher = halide_spawn_thread(flusher_thread, this);
+        }
+    }
+
+    // Write everything traced so far to the sink, and wait for it to
+    // get there.
+    void flush(void *user_context) {
+        uint64_t target = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
         bool success = true;
-        if (cursor) {
-            cursor -= overage;
-            success = (cursor == (uint32_t)write(fd, buf, cursor));
-            cursor = 0;
-            overage = 0;
+        if (flusher) {
+            wake_flusher(target);
+            halide_mutex_lock(&flusher_lock);
+            while (__atomic_load_n(&tail, __ATOMIC_ACQUIRE) < target) {
+                halide_cond_wait(&flusher_done, &flusher_lock);
+            }
+            halide_mutex_unlock(&flusher_lock);
+        } else {
+            success = drain(target);
         }
-        lock.release_exclusive();
         halide_assert(user_context, success && "Could not write to trace file");
+
+        // Nothing else may use the sink while it is trimmed.
+        while (__atomic_exchange_n(&draining, 1, __ATOMIC_ACQUIRE)) {
+            halide_thread_yield();
+        }
+        sink.trim();
+        __atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+    }
+
+    // Flush everything, stop the flusher thread, and close the sink.
+    void shutdown(void *user_context) {
+        flush(user_context);
+        if (flusher) {
+            halide_mutex_lock(&flusher_lock);
+            flusher_should_stop = true;
+            halide_cond_signal(&flusher_wake);
+            halide_mutex_unlock(&flusher_lock);
+            halide_join_thread(flusher);
+            flusher = nullptr;
+        }
+        sink.close();
     }
 
-    // Acquire and return a packet's worth of space in the trace
-    // buffer, flushing the trace buffer to the given fd to make space
-    // if necessary. The region acquired is protected from other
-    // threads writing or reading to it, so it must be released before
-    // a flush can occur.
-    ALWAYS_INLINE halide_trace_packet_t *acquire_packet(void *user_context, int fd, uint32_t size) {
-        halide_trace_packet_t *packet = nullptr;
-        while (!(packet = try_acquire_packet(user_context, size))) {
-            // Couldn't acquire space to write a packet. Flush and try again.
-            flush(user_context, fd);
+    // Reserve size bytes of the ring, waiting for space if necessary,
+    // and return the offset of the reservation.
+    ALWAYS_INLINE uint64_t acquire(void *user_context, uint32_t size) {
+        uint64_t pos = __atomic_fetch_add(&head, size, __ATOMIC_ACQ_REL);
+        // A chunk can only be reused once all of it has gone to the
+        // sink, so round the tail down to a chunk boundary.
+        uint64_t needed = pos + size - trace_ring_size;
+        while (pos + size > trace_ring_size &&
+               free_chunks_begin() < needed) {
+            // The ring is full.
+            if (flusher) {
+                wake_flusher(0);
+                halide_thread_yield();
+            } else {
+                // Drain just enough to make room. Draining any further
+                // could wait on this packet, which isn't written yet.
+                bool success = true;
+                uint64_t target = needed + (trace_chunk_size - 1);
+                target -= target % trace_chunk_size;
+                if (!try_drain(target, &success)) {
+                    halide_thread_yield();
+                }
+                halide_assert(user_context, success && "Could not write to trace file");
+            }
         }
-        return packet;
+        return pos;
     }
 
-    // Release a packet, allowing it to be written out with flush
-    ALWAYS_INLINE void release_packet(halide_trace_packet_t *) {
-        // Need a memory barrier to guarantee all the writes are done.
-        __sync_synchronize();
-        lock.release_shared();
+    // Returns a pointer to write a packet at the given offset to, if
+    // it doesn't wrap around the end of the ring.
+    ALWAYS_INLINE uint8_t *contiguous(uint64_t pos, uint32_t size) {
+        uint64_t offset = pos % trace_ring_size;
+        return offset + size <= trace_ring_size ? buf + offset : nullptr;
     }
 
-    ALWAYS_INLINE void init() {
-        cursor = 0;
-        overage = 0;
-        lock.init();
+    // Copy a packet that wraps around the end of the ring into place.
+    ALWAYS_INLINE void copy_in(uint64_t pos, const uint8_t *data, uint32_t size) {
+        uint64_t offset = pos % trace_ring_size;
+        uint32_t first = (uint32_t)min((uint64_t)size, trace_ring_size - offset);
+        memcpy(buf + offset, data, first);
+        memcpy(buf, data + first, size - first);
     }
 
-    TraceBuffer() = default;
+    // Mark the packet at the given offset as written.
+    ALWAYS_INLINE void release(uint64_t pos, uint32_t size) {
+        uint32_t c = (pos / trace_chunk_size) % trace_chunks;
+        uint32_t first = (uint32_t)min((uint64_t)size, trace_chunk_size - pos % trace_chunk_size);
+        __atomic_fetch_add(&committed[c], first, __ATOMIC_RELEASE);
+        if (first < size) {
+            __atomic_fetch_add(&committed[(c + 1) % trace_chunks], size - first, __ATOMIC_RELEASE);
+        }
+        if (flusher && (pos + size) / trace_chunk_size != pos / trace_chunk_size) {
+            // This packet finished off a chunk.
+            wake_flusher(0);
+        }
+    }
 };
 
 WEAK TraceBuffer *halide_trace_buffer = nullptr;
@@ -151,6 +377,27 @@ WEAK ScopedSpinLock::AtomicFlag halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = nullptr;
 
+WEAK void write_trace_packet(halide_trace_packet_t *packet, int32_t id, uint32_t total_size,
+                             const halide_trace_event_t *e,
+                             uint32_t value_bytes, uint32_t coords_bytes,
+                             uint32_t name_bytes, uint32_t trace_tag_bytes) {
+    packet->size = total_size;
+    packet->id = id;
+    packet->type = e->type;
+    packet->event = e->event;
+    packet->parent_id = e->parent_id;
+    packet->value_index = e->value_index;
+    packet->dimensions = e->dimensions;
+    if (e->coordinates) {
+        memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
+    }
+    if (e->value) {
+        memcpy((void *)packet->value(), e->value, value_bytes);
+    }
+    memcpy((void *)packet->func(), e->func, name_bytes);
+    memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -174,37 +421,33 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         uint32_t total_size_without_padding = header_bytes + value_bytes + coords_bytes + name_bytes + trace_tag_bytes;
         uint32_t total_size = (total_size_without_padding + 3) & ~3;
 
-        // Claim some space to write to in the trace buffer
-        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
+        halide_assert(user_context, total_size <= max_packet_size && "Trace packet too large");
 
-        if (total_size > 4096) {
-            print(nullptr) << total_size << "\n";
-        }
-
-        // Write a packet into it
-        packet->size = total_size;
-        packet->id = my_id;
-        packet->type = e->type;
-        packet->event = e->event;
-        packet->parent_id = e->parent_id;
-        packet->value_index = e->value_index;
-        packet->dimensions = e->dimensions;
-        if (e->coordinates) {
-            memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
-        }
-        if (e->value) {
-            memcpy((void *)packet->value(), e->value, value_bytes);
+        // Claim some space to write to in the trace buffer
+        uint64_t pos = halide_trace_buffer->acquire(user_context, total_size);
+
+        // Write a packet into it. Packets that wrap around the end of
+        // the ring are built on the side and copied in.
+        uint8_t *dst = halide_trace_buffer->contiguous(pos, total_size);
+        if (dst) {
+            write_trace_packet((halide_trace_packet_t *)dst, my_id, total_size, e,
+                               value_bytes, coords_bytes, name_bytes, trace_tag_bytes);
+        } else {
+            uint8_t *tmp = (uint8_t *)malloc(total_size);
+            halide_assert(user_context, tmp && "Out of memory while tracing");
+            write_trace_packet((halide_trace_packet_t *)tmp, my_id, total_size, e,
+                               value_bytes, coords_bytes, name_bytes, trace_tag_bytes);
+            halide_trace_buffer->copy_in(pos, tmp, total_size);
+            free(tmp);
         }
-        memcpy((void *)packet->func(), e->func, name_bytes);
-        memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
 
         // Release it
-        halide_trace_buffer->release_packet(packet);
+        halide_trace_buffer->release(pos, total_size);
 
         // We should also flush the trace buffer if we hit an event
         // that might be the end of the trace.
         if (e->event == halide_trace_end_pipeline) {
-            halide_trace_buffer->flush(user_context, fd);
+            halide_trace_buffer->flush(user_context);
         }
 
     } else {
@@ -349,18 +592,28 @@ WEAK int halide_get_trace_file(void *user_context) {
     if (halide_trace_file < 0) {
         const char *trace_file_name = getenv("HL_TRACE_FILE");
         if (trace_file_name) {
-            void *file = fopen(trace_file_name, "ab");
+            // Memory-mapping the file needs read access too.
+            const char *mmap_var = getenv("HL_TRACE_MMAP");
+            bool use_mmap = mmap_var && atoi(mmap_var);
+            void *file = fopen(trace_file_name, use_mmap ? "a+b" : "ab");
             halide_assert(user_context, file && "Failed to open trace file\n");
             halide_set_trace_file(fileno(file));
             halide_trace_file_internally_opened = file;
-            if (!halide_trace_buffer) {
-                halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
-                halide_trace_buffer->init();
-            }
         } else {
             halide_set_trace_file(0);
         }
     }
+    if (halide_trace_file > 0 && !halide_trace_buffer) {
+        // Only files we opened ourselves can be memory-mapped: a file
+        // descriptor passed to halide_set_trace_file may be a pipe.
+        const char *mmap_var = getenv("HL_TRACE_MMAP");
+        bool use_mmap = halide_trace_file_internally_opened && mmap_var && atoi(mmap_var);
+        const char *thread_var = getenv("HL_TRACE_FLUSH_THREAD");
+        bool use_thread = halide_can_spawn_threads() && !(thread_var && !atoi(thread_var));
+        halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
+        halide_assert(user_context, halide_trace_buffer && "Could not allocate trace buffer\n");
+        halide_trace_buffer->init(halide_trace_file, use_mmap, use_thread);
+    }
     return halide_trace_file;
 }
 
@@ -369,14 +622,16 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
 }
 
 WEAK int halide_shutdown_trace() {
+    if (halide_trace_buffer) {
+        halide_trace_buffer->shutdown(nullptr);
+        free(halide_trace_buffer);
+        halide_trace_buffer = nullptr;
+    }
     if (halide_trace_file_internally_opened) {
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = nullptr;
-        if (halide_trace_buffer) {
-            free(halide_trace_buffer);
-        }
         return ret;
     } else {
         return 0;
@@ -212,6 +212,67 @@ void test_compile_to_everything(Func j, bool do_object) {
     }
 }
 
+std::vector<std::vector<char>> compile_to_object_files_with_threads(int num_threads) {
+    std::string fname = get_fname("c7");
+    const char *o = get_host_target().os == Target::Windows ? ".obj" : ".o";
+
+    std::vector<std::string> target_strings = {
+        "host-profile-no_bounds_query",
+        "host-no_asserts",
+        "host-profile",
+    };
+
+    std::vector<Target> targets;
+    for (auto s : target_strings) {
+        targets.emplace_back(s);
+    }
+
+    std::vector<std::string> files;
+    files.push_back(fname + "_runtime" + o);
+    files.push_back(fname + "_wrapper" + o);
+    for (auto s : target_strings) {
+        files.push_back(fname + "-" + s + o);
+    }
+
+    for (auto f : files) {
+        Internal::ensure_no_file_exists(f);
+    }
+
+    // The targets may be compiled concurrently, so each one gets its own
+    // pipeline.
+    auto module_producer = [](const std::string &name, const Target &target) -> Module {
+        Param<float> factor("factor");
+        Func f("f"), g("g");
+        Var x("x"), y("y");
+        f(x, y) = x + y;
+        g(x, y) = cast<float>(f(x, y) + f(x + 1, y)) * factor;
+        f.compute_root().parallel(y);
+        g.vectorize(x, 4);
+        return g.compile_to_module(g.infer_arguments(), name, target);
+    };
+    std::map<Output, std::string> outputs = {
+        {Output::object, fname + o},
+    };
+    compile_multitarget(fname, outputs, targets, target_strings, module_producer, nullptr, num_threads);
+
+    std::vector<std::vector<char>> contents;
+    for (auto f : files) {
+        Internal::assert_file_exists(f);
+        contents.push_back(Internal::read_entire_file(f));
+    }
+    return contents;
+}
+
+void test_compile_to_object_files_in_parallel() {
+    // The outputs mustn't depend on how many targets are compiled at once.
+    auto serial = compile_to_object_files_with_threads(1);
+    auto parallel = compile_to_object_files_with_threads(3);
+    if (serial != parallel) {
+        printf("Compiling the targets in parallel changed the output\n");
+        exit(-1);
+    }
+}
+
 int main(int argc, char **argv) {
     Param<float> factor("factor");
     Func f, g, h, j;
@@ -231,6 +292,7 @@ int main(int argc, char **argv) {
     test_compile_to_object_files_single_target(j);
     test_compile_to_everything(j, /*do_object*/ true);
     test_compile_to_everything(j, /*do_object*/ false);
+    test_compile_to_object_files_in_parallel();
 
     printf("Success!\n");
     return 0;
@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+// Counts how many times the Pipeline gets lowered.
+class CountLowerings : public Internal::IRMutator {
+public:
+    std::atomic<int> count{0};
+
+    using IRMutator::mutate;
+    Internal::Stmt mutate(const Internal::Stmt &s) override {
+        count++;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    // Wasm JIT is substantially slower than others,
+    // so do fewer iterations to avoid timing out.
+    const bool is_wasm = get_jit_target_from_environment().arch == Target::WebAssembly;
+    const int iters = is_wasm ? 16 : 64;
+    constexpr int num_threads = 8;
+
+    // Realize one Pipeline from many threads at once, without
+    // compiling it first. Each thread passes its own inputs in a
+    // ParamMap.
+    Param<int> p;
+    ImageParam in(Int(32), 1);
+    Var x;
+    Func f;
+    f(x) = in(x) * p + x;
+    f.vectorize(x, 4);
+
+    Pipeline pipeline(f);
+    CountLowerings counter;
+    pipeline.add_custom_lowering_pass(&counter, nullptr);
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            Buffer<int> input(100);
+            input.for_each_element([&](int x) { input(x) = x * t; });
+            for (int i = 0; i < iters; i++) {
+                Buffer<int> out(100);
+                pipeline.realize(out, Target(), {{p, i}, {in, input}});
+                for (int x = 0; x < 100; x++) {
+                    if (out(x) != x * t * i + x) {
+                        printf("out(%d) = %d instead of %d in thread %d\n",
+                               x, out(x), x * t * i + x, t);
+                        failures++;
+                        return;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    if (failures) {
+        return -1;
+    }
+
+    if (counter.count != 1) {
+        printf("Pipeline was lowered %d times instead of once\n", (int)counter.count);
+        return -1;
+    }
+
+    printf("Success!\n");
+
+    return 0;
+}
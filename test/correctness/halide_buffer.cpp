@@ -3,9 +3,28 @@
 #include "HalideBuffer.h"
 
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 using namespace Halide::Runtime;
 
+// A minimal parallel for loop to hand to BufferParallelFor. Runs the
+// tasks on a few threads of its own.
+int test_par_for(void *user_context, halide_task_t f, int min, int extent, uint8_t *closure) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([=]() {
+            for (int i = min + t; i < min + extent; i += 4) {
+                f(user_context, i, closure);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    return 0;
+}
+
 template<typename T1, typename T2>
 void check_equal_shape(const Buffer<T1> &a, const Buffer<T2> &b) {
     if (a.dimensions() != b.dimensions()) abort();
@@ -94,6 +113,64 @@ int main(int argc, char **argv) {
         test_copy(a, b);
     }
 
+    {
+        // Check copy_from and fill with every ordering of the
+        // dimensions on each side, for a few element sizes, with and
+        // without a parallel for loop.
+        for (int par = 0; par < 2; par++) {
+            BufferParallelFor::set(par ? test_par_for : nullptr, 0);
+            for (int src_order = 0; src_order < 6; src_order++) {
+                for (int dst_order = 0; dst_order < 6; dst_order++) {
+                    const int orders[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+                    const int extents[3] = {67, 45, 3};
+                    int src_extents[3], dst_extents[3];
+                    for (int i = 0; i < 3; i++) {
+                        src_extents[i] = extents[orders[src_order][i]];
+                        dst_extents[i] = extents[orders[dst_order][i]];
+                    }
+
+                    Buffer<uint16_t> src(src_extents[0], src_extents[1], src_extents[2]);
+                    src.transpose({orders[src_order][0], orders[src_order][1], orders[src_order][2]});
+                    Buffer<uint8_t> src8(src_extents[0], src_extents[1], src_extents[2]);
+                    src8.transpose({orders[src_order][0], orders[src_order][1], orders[src_order][2]});
+                    // Make the source a window of itself so that it isn't dense.
+                    src.crop(0, 1, 64);
+                    src8.crop(0, 1, 64);
+
+                    Buffer<uint16_t> dst(dst_extents[0], dst_extents[1], dst_extents[2]);
+                    dst.transpose({orders[dst_order][0], orders[dst_order][1], orders[dst_order][2]});
+                    Buffer<uint8_t> dst8(dst_extents[0], dst_extents[1], dst_extents[2]);
+                    dst8.transpose({orders[dst_order][0], orders[dst_order][1], orders[dst_order][2]});
+
+                    src.for_each_element([&](int x, int y, int c) {
+                        src(x, y, c) = (uint16_t)(x + y * 256 + c * 4096);
+                        src8(x, y, c) = (uint8_t)(x * 3 + y * 7 + c);
+                    });
+                    dst.fill(7);
+                    dst8.fill(9);
+                    dst.for_each_value([&](uint16_t v) { assert(v == 7); });
+                    dst8.for_each_value([&](uint8_t v) { assert(v == 9); });
+
+                    dst.copy_from(src);
+                    dst8.copy_from(src8);
+                    dst.for_each_element([&](int x, int y, int c) {
+                        uint16_t correct = (x >= 1 && x <= 64) ? src(x, y, c) : 7;
+                        if (dst(x, y, c) != correct) {
+                            printf("dst(%d, %d, %d) = %d instead of %d\n", x, y, c, dst(x, y, c), correct);
+                            abort();
+                        }
+                        uint8_t correct8 = (x >= 1 && x <= 64) ? src8(x, y, c) : 9;
+                        if (dst8(x, y, c) != correct8) {
+                            printf("dst8(%d, %d, %d) = %d instead of %d\n", x, y, c, dst8(x, y, c), correct8);
+                            abort();
+                        }
+                    });
+                }
+            }
+        }
+        BufferParallelFor::set(nullptr);
+    }
+
     {
         // Check copying a buffer, using the halide_dimension_t pointer ctors
         halide_dimension_t shape_a[] = {{0, 100, 1},
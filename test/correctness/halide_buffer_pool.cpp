@@ -0,0 +1,112 @@
+// Don't include Halide.h: it is not necessary for this test.
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    BufferAllocationPool::enable(16 * 1024 * 1024, 4);
+    BufferAllocationPool::reset_stats();
+
+    {
+        // Freed storage is reused by the next Buffer of the same shape.
+        const float *first_host;
+        {
+            Buffer<float> a(100, 100, 3);
+            a.fill(1.0f);
+            first_host = a.begin();
+        }
+        Buffer<float> b(100, 100, 3);
+        if (b.begin() != first_host) {
+            printf("Buffer of the same shape did not reuse the pooled storage\n");
+            return -1;
+        }
+        b.fill(2.0f);
+        if (!b.all_equal(2.0f)) {
+            printf("Pooled Buffer has the wrong contents\n");
+            return -1;
+        }
+
+        BufferAllocationPool::Stats stats = BufferAllocationPool::stats();
+        if (stats.hits != 1 || stats.misses != 1 || stats.recycled != 1) {
+            printf("Unexpected stats: %d hits, %d misses, %d recycled\n",
+                   (int)stats.hits, (int)stats.misses, (int)stats.recycled);
+            return -1;
+        }
+    }
+
+    {
+        // A Buffer of a different shape gets fresh storage, and only
+        // four blocks of each size are retained.
+        Buffer<uint8_t> c(64, 64);
+        std::vector<Buffer<float>> bufs;
+        for (int i = 0; i < 8; i++) {
+            bufs.emplace_back(100, 100, 3);
+        }
+        bufs.clear();
+        BufferAllocationPool::Stats stats = BufferAllocationPool::stats();
+        if (stats.blocks_retained != 4 || stats.discarded != 4) {
+            printf("Expected 4 blocks retained and 4 discarded, got %d and %d\n",
+                   (int)stats.blocks_retained, (int)stats.discarded);
+            return -1;
+        }
+    }
+
+    {
+        // Buffers with a custom allocator don't use the pool.
+        Buffer<int> d(10, 10);
+        d.deallocate();
+        BufferAllocationPool::reset_stats();
+        d.allocate(malloc, free);
+        if (BufferAllocationPool::stats().hits != 0 ||
+            BufferAllocationPool::stats().misses != 0) {
+            printf("Buffer with a custom allocator used the pool\n");
+            return -1;
+        }
+    }
+
+    {
+        // Threads churning through buffers of a few shapes.
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([t]() {
+                for (int i = 0; i < 1000; i++) {
+                    Buffer<int> buf(32 + (i % 3), 32);
+                    buf.fill(t);
+                    if (!buf.all_equal(t)) {
+                        printf("Buffer has the wrong contents\n");
+                        abort();
+                    }
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        if (BufferAllocationPool::stats().hits == 0) {
+            printf("Buffers made on other threads were not recycled\n");
+            return -1;
+        }
+    }
+
+    BufferAllocationPool::disable();
+    if (BufferAllocationPool::stats().blocks_retained != 0 ||
+        BufferAllocationPool::stats().bytes_retained != 0) {
+        printf("Disabling the pool did not release its storage\n");
+        return -1;
+    }
+
+    // Storage allocated while the pool was disabled is freed normally.
+    {
+        Buffer<float> e(100, 100, 3);
+    }
+    if (BufferAllocationPool::stats().blocks_retained != 0) {
+        printf("The pool retained storage while disabled\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check the pool of host allocations behind halide_default_malloc, by
+// watching the counters it keeps of allocations it hands out and of
+// its calls to the system allocator.
+
+halide_host_allocation_stats get_stats() {
+    halide_host_allocation_stats stats;
+    if (!Internal::JITSharedRuntime::host_allocation_get_stats(&stats)) {
+        printf("Could not get host allocation stats\n");
+        exit(-1);
+    }
+    return stats;
+}
+
+bool check(const Buffer<int> &out) {
+    for (int x = 0; x < out.width(); x++) {
+        int correct = x * 2 + (x + 1) * 2;
+        if (out(x) != correct) {
+            printf("out(%d) = %d instead of %d\n", x, out(x), correct);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not use the host allocation pool.\n");
+        return 0;
+    }
+
+    // f is big enough to go on the heap, and small enough to pool.
+    Func f("f"), g("g");
+    Var x("x");
+    f(x) = x * 2;
+    g(x) = f(x) + f(x + 1);
+    f.compute_root();
+    g.compile_jit();
+
+    const int size = 100000;
+    Buffer<int> out(size);
+
+    Internal::JITSharedRuntime::reuse_host_allocations(true);
+
+    // The first run allocates f from the system, and the pool keeps it
+    // when it's freed.
+    g.realize(out);
+    halide_host_allocation_stats before = get_stats();
+
+    // The second run gets the same size class back from the pool.
+    g.realize(out);
+    halide_host_allocation_stats after = get_stats();
+    if (!check(out)) {
+        return -1;
+    }
+    if (after.pool_hits <= before.pool_hits) {
+        printf("The second allocation of f was not served from the pool\n");
+        return -1;
+    }
+    if (after.system_mallocs != before.system_mallocs ||
+        after.system_frees != before.system_frees) {
+        printf("The pool called the system allocator for a block it held: %d mallocs, %d frees\n",
+               (int)(after.system_mallocs - before.system_mallocs),
+               (int)(after.system_frees - before.system_frees));
+        return -1;
+    }
+
+    // Releasing the pool hands f's block back to the system.
+    before = after;
+    Internal::JITSharedRuntime::release_unused_host_allocations();
+    after = get_stats();
+    if (after.system_frees <= before.system_frees) {
+        printf("halide_release_unused_host_allocations did not free anything\n");
+        return -1;
+    }
+
+    // With the pool off, every run goes to the system.
+    Internal::JITSharedRuntime::reuse_host_allocations(false);
+    before = get_stats();
+    g.realize(out);
+    g.realize(out);
+    after = get_stats();
+    if (!check(out)) {
+        return -1;
+    }
+    if (after.pool_hits != before.pool_hits) {
+        printf("The pool was used after halide_reuse_host_allocations(false)\n");
+        return -1;
+    }
+    if (after.system_mallocs < before.system_mallocs + 2 ||
+        after.system_frees < before.system_frees + 2) {
+        printf("Allocations did not go to the system with the pool off\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
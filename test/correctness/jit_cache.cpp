@@ -0,0 +1,118 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+// Count the entries in the JIT cache directory, removing them if asked
+// to. Returns -1 where we can't list directories.
+int jit_cache_entries(const std::string &dir, bool remove) {
+#ifdef _WIN32
+    return -1;
+#else
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        return 0;
+    }
+    int count = 0;
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 4 && name.substr(name.size() - 4) == ".jit") {
+            if (remove) {
+                unlink((dir + "/" + name).c_str());
+            }
+            count++;
+        }
+    }
+    closedir(d);
+    return remove ? 0 : count;
+#endif
+}
+
+// Make a pipeline whose code differs from that for another scale
+// factor only in the low bits of a constant.
+Pipeline make_pipeline(float scale) {
+    Func f("f");
+    Var x("x");
+    f(x) = cast<float>(x) * scale;
+    return Pipeline(f);
+}
+
+bool check(Pipeline p, float scale) {
+    Buffer<float> out = p.realize({1 << 20});
+    for (int x = 0; x < out.width(); x++) {
+        float correct = (float)x * scale;
+        if (out(x) != correct) {
+            printf("out(%d) = %.9g instead of %.9g\n", x, out(x), correct);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] The JIT cache is not used for WebAssembly.\n");
+        return 0;
+    }
+
+    const std::string dir = Internal::get_test_tmp_dir() + "jit_cache";
+    static std::string env = "HL_JIT_CACHE_DIR=" + dir;
+    putenv(&env[0]);
+    jit_cache_entries(dir, true);
+
+    const float scale_a = 1.0000001f, scale_b = 1.0000002f;
+
+    // Populate the cache.
+    Pipeline a = make_pipeline(scale_a);
+    if (!check(a, scale_a)) {
+        return -1;
+    }
+    int entries = jit_cache_entries(dir, false);
+    if (entries == 0) {
+        printf("Compiling did not add a JIT cache entry\n");
+        return -1;
+    }
+
+    // Throw away the compiled code and recompile. This should load the
+    // object code from the cache, even though lowering picks different
+    // names for temporaries the second time.
+    const int hits = Internal::JITModule::jit_cache_hits();
+    a.invalidate_cache();
+    if (!check(a, scale_a)) {
+        return -1;
+    }
+    if (Internal::JITModule::jit_cache_hits() != hits + 1) {
+        printf("Recompiling the same pipeline did not load it from the JIT cache\n");
+        return -1;
+    }
+
+    // A pipeline that differs only by a constant must not hit the same entry.
+    entries = jit_cache_entries(dir, false);
+    Pipeline b = make_pipeline(scale_b);
+    if (!check(b, scale_b)) {
+        return -1;
+    }
+    if (entries != -1 && jit_cache_entries(dir, false) <= entries) {
+        printf("Pipelines with different constants shared a JIT cache entry\n");
+        return -1;
+    }
+    if (Internal::JITModule::jit_cache_hits() != hits + 1) {
+        printf("A pipeline with a different constant was loaded from the JIT cache\n");
+        return -1;
+    }
+
+    jit_cache_entries(dir, true);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "Halide.h"
+
+#include <cstdio>
+#include <sstream>
+
+using namespace Halide;
+
+// Lower a pipeline with the given target and return what the
+// CompilerLogger recorded.
+std::string lower_and_log(Func f, const Target &t) {
+    Internal::set_compiler_logger(std::unique_ptr<Internal::CompilerLogger>(new Internal::JSONCompilerLogger()));
+    f.compile_to_module(f.infer_arguments(), "f", t);
+    std::ostringstream log;
+    Internal::set_compiler_logger(nullptr)->emit_to_stream(log);
+    return log.str();
+}
+
+int main(int argc, char **argv) {
+    Func f, g;
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_at(g, y);
+    g.vectorize(x, 8).parallel(y);
+
+    Target t = get_host_target();
+
+    std::string log = lower_and_log(g, t);
+    if (log.find("lowering_passes") != std::string::npos) {
+        printf("Lowering passes were recorded without profiling enabled:\n%s\n", log.c_str());
+        return -1;
+    }
+
+    log = lower_and_log(g, t.with_feature(Target::ProfileLowering));
+    for (const char *pass : {"\"lowering_passes\"",
+                             "\"name\" : \"creating initial loop nests\"",
+                             "\"name\" : \"vectorizing\"",
+                             "\"name\" : \"partitioning loops\"",
+                             "\"ir_nodes\" : "}) {
+        if (log.find(pass) == std::string::npos) {
+            printf("Did not find %s in the compiler log:\n%s\n", pass, log.c_str());
+            return -1;
+        }
+    }
+
+    // With no CompilerLogger active, the profile goes to stderr.
+    g.compile_to_module(g.infer_arguments(), "g", t.with_feature(Target::ProfileLowering));
+    if (Internal::get_compiler_logger() != nullptr) {
+        printf("Lowering left a CompilerLogger active\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
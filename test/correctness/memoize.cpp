@@ -82,6 +82,15 @@ void record_error(void *user_context, const char *msg) {
     error_occured = true;
 }
 
+halide_memoization_cache_stats get_cache_stats() {
+    halide_memoization_cache_stats stats;
+    if (!Internal::JITSharedRuntime::memoization_cache_get_stats(&stats)) {
+        printf("Could not get memoization cache stats\n");
+        exit(-1);
+    }
+    return stats;
+}
+
 int main(int argc, char **argv) {
 
     {
@@ -95,12 +104,20 @@ int main(int argc, char **argv) {
         f_memoized.compute_root().memoize();
 
         Buffer<uint8_t> result1 = f.realize();
+        halide_memoization_cache_stats before = get_cache_stats();
         Buffer<uint8_t> result2 = f.realize();
+        halide_memoization_cache_stats after = get_cache_stats();
 
         assert(result1(0) == 42);
         assert(result2(0) == 42);
 
         assert(call_count == 1);
+
+        // The second realization is one lookup that hits.
+        assert(after.lookups == before.lookups + 1);
+        assert(after.hits == before.hits + 1);
+        assert(after.misses == before.misses);
+        assert(after.evictions == before.evictions);
     }
 
     {
@@ -379,6 +396,7 @@ int main(int argc, char **argv) {
         Func g;
         g(x, y) = f(x, y) + f(x - 1, y) + f(x + 1, y);
         Internal::JITSharedRuntime::memoization_cache_set_size(1000000);
+        halide_memoization_cache_stats before = get_cache_stats();
 
         for (int v = 0; v < 1000; v++) {
             int r = rand() % 256;
@@ -391,9 +409,20 @@ int main(int argc, char **argv) {
                 }
             }
         }
-        // TODO work out an assertion on call count here.
+        halide_memoization_cache_stats after = get_cache_stats();
         printf("Call count is %d.\n", call_count_with_arg);
 
+        // Every realization is one lookup, and every miss calls the
+        // extern stage once. The 256 possible results don't fit in
+        // the cache, so some of them must have been evicted.
+        uint64_t lookups = after.lookups - before.lookups;
+        uint64_t hits = after.hits - before.hits;
+        uint64_t misses = after.misses - before.misses;
+        assert(lookups == 1000);
+        assert(hits + misses == lookups);
+        assert(misses == (uint64_t)call_count_with_arg);
+        assert(after.evictions > before.evictions);
+
         // Return cache size to default.
         Internal::JITSharedRuntime::memoization_cache_set_size(0);
     }
@@ -0,0 +1,156 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+
+extern "C" DLLEXPORT int count_calls_with_arg(uint8_t val, halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        call_count++;
+        Halide::Runtime::Buffer<uint8_t> b(*out);
+        b.for_each_element([&](int x, int y) {
+            b(x, y) = (uint8_t)(val + x + y);
+        });
+    }
+    return 0;
+}
+
+// Make a pipeline whose memoized stage is passed val + offset. The
+// names don't depend on the offset, so only the code tells the
+// pipelines apart.
+Func make_pipeline(Param<uint8_t> &val, int offset) {
+    Func count_calls("count_calls");
+    Expr arg = offset == 0 ? Expr(val) : cast<uint8_t>(val + offset);
+    count_calls.define_extern("count_calls_with_arg", {arg}, UInt(8), 2);
+
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = count_calls(x, y) * 2;
+    count_calls.compute_root().memoize();
+    return f;
+}
+
+void check(const Buffer<uint8_t> &out, int v) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            uint8_t correct = (uint8_t)((v + x + y) * 2);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                exit(-1);
+            }
+        }
+    }
+}
+
+halide_memoization_cache_stats get_cache_stats() {
+    halide_memoization_cache_stats stats;
+    if (!Internal::JITSharedRuntime::memoization_cache_get_stats(&stats)) {
+        printf("Could not get memoization cache stats\n");
+        exit(-1);
+    }
+    return stats;
+}
+
+void check_call_count(int expected, const char *when) {
+    if (call_count != expected) {
+        printf("call_count = %d instead of %d %s\n", call_count, expected, when);
+        exit(-1);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support memory-mapped files.\n");
+        return 0;
+    }
+
+    // The test runs itself a second time with this argument, to check
+    // that the results are shared between processes.
+    const bool second_process = argc > 1 && strcmp(argv[1], "--second-process") == 0;
+
+    // The runtime reads this at the first memoization cache lookup.
+    std::string path = Internal::get_test_tmp_dir() + "memoize_persistent.cache";
+    if (!second_process) {
+        Internal::ensure_no_file_exists(path);
+    }
+    static std::string env = "HL_MEMOIZATION_CACHE_FILE=" + path;
+    putenv(&env[0]);
+
+    Param<uint8_t> val("val");
+    Func f = make_pipeline(val, 0);
+
+    if (second_process) {
+        // Everything the first process computed should come from the file.
+        for (int v = 0; v < 4; v++) {
+            val.set(v);
+            check(f.realize({64, 64}), v);
+        }
+        check_call_count(0, "in the second process");
+
+        // A pipeline with the same names but different code must not
+        // get the first pipeline's results.
+        Func g = make_pipeline(val, 100);
+        for (int v = 0; v < 4; v++) {
+            val.set(v);
+            check(g.realize({64, 64}), v + 100);
+        }
+        check_call_count(4, "for a changed pipeline in the second process");
+        return 0;
+    }
+
+    for (int v = 0; v < 4; v++) {
+        val.set(v);
+        check(f.realize({64, 64}), v);
+    }
+    check_call_count(4, "");
+
+    // Empty the in-memory cache. The results should come back from
+    // the file.
+    Internal::JITSharedRuntime::memoization_cache_set_size(1);
+    Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+    halide_memoization_cache_stats before = get_cache_stats();
+    for (int v = 0; v < 4; v++) {
+        val.set(v);
+        check(f.realize({64, 64}), v);
+    }
+    check_call_count(4, "after emptying the in-memory cache");
+
+    // Results loaded from the file count as hits, not misses.
+    halide_memoization_cache_stats after = get_cache_stats();
+    if (after.persistent_hits - before.persistent_hits != 4 ||
+        after.hits - before.hits != 4 ||
+        after.misses != before.misses) {
+        printf("Persistent hits were not counted as hits: "
+               "persistent_hits %d, hits %d, misses %d\n",
+               (int)(after.persistent_hits - before.persistent_hits),
+               (int)(after.hits - before.hits),
+               (int)(after.misses - before.misses));
+        return -1;
+    }
+
+    // A different region isn't in the file.
+    val.set(0);
+    check(f.realize({32, 32}), 0);
+    check_call_count(5, "");
+
+    std::string command = std::string("\"") + argv[0] + "\" --second-process";
+    if (system(command.c_str()) != 0) {
+        printf("The second process failed\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
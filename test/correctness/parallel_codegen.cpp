@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Halide;
+
+// Compile a static library with HL_LLVM_CODEGEN_THREADS set, so that
+// the LLVM module is split and compiled on several threads.
+std::vector<char> compile_library(Func f, const std::string &name) {
+    const char *a = get_host_target().os == Target::Windows ? ".lib" : ".a";
+    std::string fname = Internal::get_test_tmp_dir() + "halide_test_correctness_parallel_codegen_" + name;
+    Internal::ensure_no_file_exists(fname + ".h");
+    Internal::ensure_no_file_exists(fname + a);
+
+    f.compile_to_static_library(fname, f.infer_arguments(), name);
+
+    Internal::assert_file_exists(fname + ".h");
+    Internal::assert_file_exists(fname + a);
+    return Internal::read_entire_file(fname + a);
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly does not support static libraries.\n");
+        return 0;
+    }
+
+    // Lots of stages, each with its own parallel closure.
+    ImageParam in(Float(32), 2);
+    Var x, y;
+    Func f = BoundaryConditions::repeat_edge(in);
+    for (int i = 0; i < 16; i++) {
+        Func g;
+        g(x, y) = (f(x - 1, y) + f(x, y) * 2 + f(x + 1, y + i % 3)) / 4;
+        g.compute_root().parallel(y).vectorize(x, 8);
+        f = g;
+    }
+
+    static char env[] = "HL_LLVM_CODEGEN_THREADS=4";
+    putenv(env);
+
+    // The partitioning must be deterministic, so the same pipeline
+    // compiled twice (with the same function name) must give the same
+    // library.
+    std::vector<char> first = compile_library(f, "parallel_codegen");
+    std::vector<char> second = compile_library(f, "parallel_codegen");
+    if (first != second) {
+        printf("Compiling the same pipeline twice gave different libraries\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
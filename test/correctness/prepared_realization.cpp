@@ -0,0 +1,115 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+template<typename T>
+bool check(const Buffer<T> &buf, std::function<T(int, int)> expected) {
+    for (int y = 0; y < buf.height(); y++) {
+        for (int x = 0; x < buf.width(); x++) {
+            T correct = expected(x, y);
+            if (buf(x, y) != correct) {
+                printf("buf(%d, %d) = %d instead of %d\n", x, y, (int)buf(x, y), (int)correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        // Params and ImageParams are read at each call.
+        ImageParam in(Int(32), 2);
+        Param<int> offset;
+        Func f;
+        f(x, y) = in(x, y) + offset;
+
+        Buffer<int> in1(16, 16), in2(16, 16);
+        in1.for_each_element([&](int x, int y) { in1(x, y) = x + y; });
+        in2.for_each_element([&](int x, int y) { in2(x, y) = x * y; });
+
+        Buffer<int> out(16, 16);
+        in.set(in1);
+        offset.set(3);
+        Pipeline p(f);
+        Pipeline::PreparedRealization prepared = p.prepare_realize(out);
+        if (!prepared.defined()) {
+            printf("prepare_realize returned an undefined handle\n");
+            return -1;
+        }
+
+        prepared.realize();
+        if (!check<int>(out, [](int x, int y) { return x + y + 3; })) {
+            return -1;
+        }
+
+        offset.set(-7);
+        prepared.realize();
+        if (!check<int>(out, [](int x, int y) { return x + y - 7; })) {
+            return -1;
+        }
+
+        in.set(in2);
+        prepared.realize();
+        if (!check<int>(out, [](int x, int y) { return x * y - 7; })) {
+            return -1;
+        }
+
+        // The handle keeps working after the Pipeline is recompiled.
+        f.vectorize(x, 4);
+        p.invalidate_cache();
+        p.compile_jit();
+        offset.set(1);
+        prepared.realize();
+        if (!check<int>(out, [](int x, int y) { return x * y + 1; })) {
+            return -1;
+        }
+    }
+
+    {
+        // Multiple outputs, and Params given by a ParamMap.
+        Param<int> k;
+        Func f, g;
+        f(x, y) = x * k;
+        g(x, y) = cast<uint8_t>(y + k);
+
+        ParamMap pm;
+        pm.set(k, 5);
+
+        Buffer<int> f_out(8, 8);
+        Buffer<uint8_t> g_out(8, 8);
+        Pipeline p({f, g});
+        Pipeline::PreparedRealization prepared = p.prepare_realize({f_out, g_out}, Target(), pm);
+        prepared.realize();
+
+        if (!check<int>(f_out, [](int x, int y) { return x * 5; }) ||
+            !check<uint8_t>(g_out, [](int x, int y) { return (uint8_t)(y + 5); })) {
+            return -1;
+        }
+    }
+
+    {
+        // The handle holds on to what it needs to run.
+        Func f;
+        f(x, y) = x - y;
+
+        Pipeline::PreparedRealization prepared;
+        Buffer<int> out;
+        {
+            // The Realization and the Pipeline go out of scope before the call.
+            out = Buffer<int>(10, 10);
+            Realization r(out);
+            prepared = Pipeline(f).prepare_realize(r);
+        }
+        prepared.realize();
+        if (!check<int>(out, [](int x, int y) { return x - y; })) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int batch_size = 37;
+
+    for (int parallel = 0; parallel < 2; parallel++) {
+        Param<int> k;
+        ImageParam in(Int(32), 2);
+        Var x, y;
+        Func f, g;
+        f(x, y) = in(x, y) * k;
+        g(x, y) = cast<float>(in(x, y) + y);
+        if (parallel) {
+            // Parallel loops inside the pipeline run nested in the batch.
+            f.parallel(y);
+            g.parallel(y);
+        }
+        Pipeline p({f, g});
+
+        std::vector<Buffer<int>> inputs;
+        std::vector<Realization> outputs;
+        std::vector<ParamMap> param_maps;
+        for (int i = 0; i < batch_size; i++) {
+            Buffer<int> input(8, 8);
+            input.for_each_element([&](int x, int y) { input(x, y) = x + y * i; });
+            inputs.push_back(input);
+
+            Buffer<int> f_out(8, 8);
+            Buffer<float> g_out(8, 8);
+            outputs.emplace_back(f_out, g_out);
+
+            ParamMap pm;
+            pm.set(k, i);
+            pm.set(in, inputs.back());
+            param_maps.push_back(pm);
+        }
+
+        p.realize_batch(outputs, param_maps);
+
+        for (int i = 0; i < batch_size; i++) {
+            Buffer<int> f_out = outputs[i][0];
+            Buffer<float> g_out = outputs[i][1];
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 8; x++) {
+                    int input = x + y * i;
+                    if (f_out(x, y) != input * i) {
+                        printf("f_out[%d](%d, %d) = %d instead of %d\n",
+                               i, x, y, f_out(x, y), input * i);
+                        return -1;
+                    }
+                    if (g_out(x, y) != (float)(input + y)) {
+                        printf("g_out[%d](%d, %d) = %f instead of %f\n",
+                               i, x, y, g_out(x, y), (float)(input + y));
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    {
+        // Without ParamMaps, every call sees the bound Params.
+        Param<int> k;
+        Var x;
+        Func f;
+        f(x) = x + k;
+        k.set(17);
+
+        std::vector<Realization> outputs;
+        for (int i = 0; i < batch_size; i++) {
+            Buffer<int> out(16);
+            outputs.emplace_back(out);
+        }
+        Pipeline(f).realize_batch(outputs);
+
+        for (int i = 0; i < batch_size; i++) {
+            Buffer<int> out = outputs[i][0];
+            for (int x = 0; x < 16; x++) {
+                if (out(x) != x + 17) {
+                    printf("out[%d](%d) = %d instead of %d\n", i, x, out(x), x + 17);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
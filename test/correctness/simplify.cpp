@@ -2026,6 +2026,36 @@ void check_invariant() {
     }
 }
 
+void check_memoization() {
+    // simplify() memoizes its results. Structurally equal but distinct
+    // Exprs should simplify the same way, and an Expr the simplifier
+    // leaves alone should come back as the same object every time.
+    Expr x = Var("x"), y = Var("y"), z = Var("z"), w = Var("w");
+    for (int i = 0; i < 2; i++) {
+        Expr e = (x * 2 + 3) * 4 - (y + x * 8);
+        Expr expected = 12 - y;
+        Expr result = simplify(e);
+        internal_assert(equal(result, expected))
+            << "Simplification failure on iteration " << i << ":\n"
+            << "Input: " << e << "\n"
+            << "Output: " << result << "\n"
+            << "Expected output: " << expected << "\n";
+        check_inv(select(x == y, z, w));
+    }
+
+    // The bounds of the free variables are part of the key.
+    Scope<Interval> bounds;
+    bounds.push("x", Interval(0, 10));
+    for (int i = 0; i < 2; i++) {
+        Expr e = max(x + 1, 0) + y;
+        check_in_bounds(e, simplify(x + y + 1), bounds);
+        Expr unbounded = simplify(e);
+        internal_assert(!equal(unbounded, simplify(e, true, bounds)))
+            << "Simplifying " << e << " without bounds should not remove the max: "
+            << unbounded << "\n";
+    }
+}
+
 int main(int argc, char **argv) {
     check_invariant();
     check_casts();
@@ -2037,6 +2067,7 @@ int main(int argc, char **argv) {
     check_overflow();
     check_bitwise();
     check_lets();
+    check_memoization();
 
     // Miscellaneous cases that don't fit into one of the categories above.
     Expr x = Var("x"), y = Var("y");
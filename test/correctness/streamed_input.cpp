@@ -0,0 +1,108 @@
+#include "Halide.h"
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+// A virtual image that's never in memory all at once. Records the
+// regions asked for.
+struct VirtualImage {
+    std::atomic<int> fetches{0};
+    std::atomic<int> max_rows{0};
+};
+
+int fetch_virtual_image(void *user_context, void *source_context, halide_buffer_t *dst) {
+    VirtualImage *image = (VirtualImage *)source_context;
+    Runtime::Buffer<uint16_t> tile(*dst);
+    tile.for_each_element([&](int x, int y) {
+        tile(x, y) = (uint16_t)(x + y * 3);
+    });
+    image->fetches++;
+    int rows = tile.height();
+    int old = image->max_rows;
+    while (rows > old && !image->max_rows.compare_exchange_weak(old, rows)) {
+    }
+    return 0;
+}
+
+size_t largest_allocation = 0;
+
+void *tracking_malloc(void *user_context, size_t size) {
+    largest_allocation = std::max(largest_allocation, size);
+    void *ptr = malloc(size + 128);
+    void *aligned = (void *)(((size_t)ptr + 128) & ~(size_t)127);
+    ((void **)aligned)[-1] = ptr;
+    return aligned;
+}
+
+void tracking_free(void *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly does not support async() yet.\n");
+        return 0;
+    }
+
+    const int W = 512, H = 2048, strip = 32;
+
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+
+    StreamedInput in(UInt(16), 2, "in");
+    Func blur("blur");
+    blur(x, y) = (in(x, y - 1) + in(x, y) + in(x, y + 1)) / 3;
+
+    for (int streamed = 0; streamed < 2; streamed++) {
+        VirtualImage image;
+        halide_tile_source_t source = {fetch_virtual_image, &image};
+        in.set(&source);
+        largest_allocation = 0;
+
+        Pipeline p(blur);
+        if (streamed) {
+            blur.split(y, yo, yi, strip);
+            in.stream_at(blur, yo, 1, strip + 2);
+        }
+        p.set_custom_allocator(tracking_malloc, tracking_free);
+
+        Buffer<uint16_t> out = p.realize({W, H});
+
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                uint16_t correct = (uint16_t)((3 * (xx + yy * 3)) / 3);
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+
+        if (!streamed) {
+            if (image.fetches != 1 || image.max_rows != H + 2) {
+                printf("Expected the whole input in one fetch. Got %d fetches of up to %d rows\n",
+                       (int)image.fetches, (int)image.max_rows);
+                return -1;
+            }
+        } else {
+            // One fetch per strip.
+            if (image.fetches != H / strip || image.max_rows > strip + 2) {
+                printf("Expected %d fetches of up to %d rows. Got %d fetches of up to %d rows\n",
+                       H / strip, strip + 2, (int)image.fetches, (int)image.max_rows);
+                return -1;
+            }
+            // Only two strips of the input should be in memory at
+            // once. Leave some slack for padding.
+            const size_t limit = 2 * (strip + 2) * W * sizeof(uint16_t) + 1024;
+            if (largest_allocation > limit) {
+                printf("Largest allocation was %d bytes, but should be at most %d\n",
+                       (int)largest_allocation, (int)limit);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+// Check that with HL_THREAD_POOL_WORK_STEALING set, every iteration of
+// a parallel loop runs exactly once, however the iterations get stolen.
+
+const int size = 1024;
+std::atomic<int> visits[size * 16];
+
+// Record a visit to the given index, after doing an amount of work
+// that depends on cost, so that some ranges finish well before others.
+extern "C" DLLEXPORT int visit(int index, int cost) {
+    volatile int sink = 0;
+    for (int i = 0; i < cost * 16; i++) {
+        sink = sink + i;
+    }
+    visits[index]++;
+    return index * 2;
+}
+HalideExtern_2(int, visit, int, int);
+
+bool check_visits(int count, const char *what) {
+    for (int i = 0; i < count; i++) {
+        if (visits[i] != 1) {
+            printf("%s: index %d was visited %d times\n", what, i, (int)visits[i]);
+            return false;
+        }
+        visits[i] = 0;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly does not support threads.\n");
+        return 0;
+    }
+
+    // The thread pool reads this when it starts.
+    static char env[] = "HL_THREAD_POOL_WORK_STEALING=1";
+    putenv(env);
+
+    for (int i = 0; i < size * 16; i++) {
+        visits[i] = 0;
+    }
+
+    Var x("x"), y("y");
+
+    // An unbalanced parallel loop, where the later iterations cost more.
+    {
+        Func f("f");
+        f(y) = visit(y, y);
+        f.parallel(y);
+        f.compile_jit();
+
+        for (int trial = 0; trial < 20; trial++) {
+            Buffer<int> out = f.realize({size});
+            for (int i = 0; i < size; i++) {
+                if (out(i) != i * 2) {
+                    printf("unbalanced: out(%d) = %d instead of %d\n", i, out(i), i * 2);
+                    return -1;
+                }
+            }
+            if (!check_visits(size, "unbalanced")) {
+                return -1;
+            }
+        }
+    }
+
+    // Nested parallel loops, each of which may be stolen from.
+    {
+        Func g("g");
+        g(x, y) = visit(x + y * 16, (x * 7 + y * 3) % 64);
+        g.parallel(x).parallel(y);
+        g.compile_jit();
+
+        for (int trial = 0; trial < 20; trial++) {
+            Buffer<int> out = g.realize({16, size});
+            for (int j = 0; j < size; j++) {
+                for (int i = 0; i < 16; i++) {
+                    int correct = (i + j * 16) * 2;
+                    if (out(i, j) != correct) {
+                        printf("nested: out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                        return -1;
+                    }
+                }
+            }
+            if (!check_visits(size * 16, "nested")) {
+                return -1;
+            }
+        }
+    }
+
+    // A loop with fewer iterations than there are threads.
+    {
+        Func h("h");
+        h(y) = visit(y, 1000);
+        h.parallel(y);
+        h.compile_jit();
+
+        for (int trial = 0; trial < 20; trial++) {
+            Buffer<int> out = h.realize({3});
+            for (int i = 0; i < 3; i++) {
+                if (out(i) != i * 2) {
+                    printf("short: out(%d) = %d instead of %d\n", i, out(i), i * 2);
+                    return -1;
+                }
+            }
+            if (!check_visits(3, "short")) {
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
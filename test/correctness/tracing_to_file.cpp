@@ -0,0 +1,109 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <set>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Trace a parallel pipeline into a binary trace file, with and without
+// memory-mapping the file, and check that every packet arrives intact
+// and after the packet for the realization it belongs to, and that the
+// file holds nothing but packets.
+
+bool check_trace_file(const std::string &filename, int expected_stores) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) {
+        printf("Could not open %s\n", filename.c_str());
+        return false;
+    }
+    std::set<int> ids;
+    int stores = 0;
+    long packet_bytes = 0;
+    std::vector<uint8_t> packet;
+    uint32_t size;
+    while (fread(&size, sizeof(size), 1, f) == 1) {
+        packet_bytes += size;
+        if (size < sizeof(halide_trace_packet_t)) {
+            printf("Bad packet size %u\n", size);
+            fclose(f);
+            return false;
+        }
+        packet.resize(size);
+        memcpy(packet.data(), &size, sizeof(size));
+        if (fread(packet.data() + sizeof(size), size - sizeof(size), 1, f) != 1) {
+            printf("Truncated packet\n");
+            fclose(f);
+            return false;
+        }
+        halide_trace_packet_t *p = (halide_trace_packet_t *)packet.data();
+        if (p->event == halide_trace_store) {
+            stores++;
+        }
+        if (p->event != halide_trace_begin_pipeline && !ids.count(p->parent_id)) {
+            printf("Packet %d for %s arrived before its parent %d\n", p->id, p->func(), p->parent_id);
+            fclose(f);
+            return false;
+        }
+        ids.insert(p->id);
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fclose(f);
+    if (file_size != packet_bytes) {
+        printf("The trace file is %ld bytes, but the packets in it are %ld bytes\n", file_size, packet_bytes);
+        return false;
+    }
+    if (stores != expected_stores) {
+        printf("Found %d stores instead of %d\n", stores, expected_stores);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support tracing to a file.\n");
+        return 0;
+    }
+
+    for (int use_mmap = 0; use_mmap < 2; use_mmap++) {
+        std::string filename = Internal::get_test_tmp_dir() + "tracing_to_file_" + std::to_string(use_mmap) + ".bin";
+        Internal::ensure_no_file_exists(filename);
+
+        static char trace_file_var[1024], mmap_var[64];
+        snprintf(trace_file_var, sizeof(trace_file_var), "HL_TRACE_FILE=%s", filename.c_str());
+        snprintf(mmap_var, sizeof(mmap_var), "HL_TRACE_MMAP=%d", use_mmap);
+        putenv(trace_file_var);
+        putenv(mmap_var);
+        // The trace file is opened when the runtime first traces.
+        Internal::JITSharedRuntime::release_all();
+
+        Func f("f"), g("g");
+        Var x("x"), y("y");
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        f.compute_at(g, y).trace_stores().trace_realizations();
+        g.parallel(y).trace_stores().trace_realizations();
+
+        const int w = 100, h = 300;
+        g.realize({w, h});
+
+        // The end of the pipeline flushes the trace, so the file should
+        // be complete even though it is still open.
+        if (!check_trace_file(filename, w * h + (w + 1) * h)) {
+            return -1;
+        }
+
+        // Shut down the runtime, which closes the trace file.
+        Internal::JITSharedRuntime::release_all();
+
+        if (!check_trace_file(filename, w * h + (w + 1) * h)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -49,6 +49,29 @@ int main(int argc, char **argv) {
     }
     verify(output, arg0, arg1);
 
+    // and so does the _batch entry point, which takes the
+    // argument lists one after another.
+    const int kBatchSize = 5;
+    float batch_f1[kBatchSize], batch_f2[kBatchSize];
+    Buffer<int32_t> batch_outputs[kBatchSize];
+    void *batch_args[kBatchSize * 3];
+    for (int i = 0; i < kBatchSize; i++) {
+        batch_f1[i] = 1.0f + i;
+        batch_f2[i] = 2.5f;
+        batch_outputs[i] = Buffer<int32_t>(kSize, kSize, 3);
+        batch_args[i * 3 + 0] = &batch_f1[i];
+        batch_args[i * 3 + 1] = &batch_f2[i];
+        batch_args[i * 3 + 2] = (halide_buffer_t *)batch_outputs[i];
+    }
+    result = argvcall_batch(batch_args, kBatchSize);
+    if (result != 0) {
+        fprintf(stderr, "Result: %d\n", result);
+        exit(-1);
+    }
+    for (int i = 0; i < kBatchSize; i++) {
+        verify(batch_outputs[i], batch_f1[i], batch_f2[i]);
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,79 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "numa_allocator.h"
+
+using namespace Halide::Runtime;
+
+std::atomic<int> mallocs{0};
+std::atomic<int> frees{0};
+std::atomic<bool> misaligned{false};
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *ptr = halide_numa_malloc(user_context, x);
+#ifdef __linux__
+    // On Linux the allocation is rounded up to whole pages.
+    if ((uintptr_t)ptr % 4096 != 0) {
+        misaligned = true;
+    }
+#endif
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    frees++;
+    halide_numa_free(user_context, ptr);
+}
+
+int main(int argc, char **argv) {
+    // The thread pool reads this when it starts. Where there is no
+    // NUMA support, or only one node, the thread pool and the
+    // allocator fall back to their usual behavior, and the results
+    // must not change.
+    static char numa_env[] = "HL_THREAD_POOL_NUMA=1";
+    putenv(numa_env);
+
+    halide_set_custom_malloc(my_malloc);
+    halide_set_custom_free(my_free);
+
+    Buffer<int> out(1024, 1024);
+    for (int i = 0; i < 10; i++) {
+        int ret = numa_allocator(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return -1;
+        }
+    }
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x + y * 2) + (x + 1 + y * 2);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (mallocs == 0) {
+        printf("halide_numa_malloc was never called\n");
+        return -1;
+    }
+    if (mallocs != frees) {
+        printf("%d allocations but %d frees\n", (int)mallocs, (int)frees);
+        return -1;
+    }
+    if (misaligned) {
+        printf("halide_numa_malloc returned memory that was not page aligned\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
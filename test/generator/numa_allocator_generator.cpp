@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+class NumaAllocator : public Halide::Generator<NumaAllocator> {
+public:
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        // A parallel stage big enough to go on the heap, read by
+        // another parallel stage.
+        Func f;
+        f(x, y) = x + y * 2;
+        output(x, y) = f(x, y) + f(x + 1, y);
+
+        f.compute_root().parallel(y);
+        output.parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(NumaAllocator, numa_allocator)
@@ -0,0 +1,45 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "split_codegen.h"
+#include "split_codegen_unsplit.h"
+
+using namespace Halide::Runtime;
+
+const int kWidth = 123;
+const int kHeight = 45;
+
+// split_codegen was compiled to a static library in several
+// partitions, each its own archive member. Linking it must bring in
+// everything the unsplit build has, and compute the same thing.
+int main(int argc, char **argv) {
+    Buffer<uint8_t> input(kWidth, kHeight);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint8_t)(x * 7 + y * 13);
+    });
+
+    Buffer<float> split_output(kWidth, kHeight), unsplit_output(kWidth, kHeight);
+    if (split_codegen(input, split_output) != 0) {
+        printf("split_codegen failed\n");
+        return -1;
+    }
+    if (split_codegen_unsplit(input, unsplit_output) != 0) {
+        printf("split_codegen_unsplit failed\n");
+        return -1;
+    }
+
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < kWidth; x++) {
+            if (split_output(x, y) != unsplit_output(x, y)) {
+                printf("split_output(%d, %d) = %f instead of %f\n",
+                       x, y, split_output(x, y), unsplit_output(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
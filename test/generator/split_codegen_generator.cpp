@@ -0,0 +1,43 @@
+#include "Halide.h"
+
+#include <stdlib.h>
+
+namespace {
+
+class SplitCodegen : public Halide::Generator<SplitCodegen> {
+public:
+    // The number of partitions to split the module into when it is
+    // compiled to a static library.
+    GeneratorParam<int> codegen_threads{"codegen_threads", 4};
+
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        // Module::compile reads this once the pipeline has been built.
+        static std::string env;
+        env = "HL_LLVM_CODEGEN_THREADS=" + std::to_string((int)codegen_threads);
+        putenv(&env[0]);
+
+        Var x("x"), y("y");
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+
+        // Each parallel stage gets its own closure, so there are
+        // several functions for the partitions to share out.
+        Func blur_x("blur_x"), blur_y("blur_y"), sharpen("sharpen");
+        blur_x(x, y) = (cast<uint16_t>(clamped(x - 1, y)) + clamped(x, y) * 2 + clamped(x + 1, y)) / 4;
+        blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) * 2 + blur_x(x, y + 1)) / 4;
+        sharpen(x, y) = cast<int16_t>(clamped(x, y)) * 2 - cast<int16_t>(blur_y(x, y));
+        output(x, y) = sqrt(cast<float>(max(sharpen(x, y), 0))) + cast<float>(blur_y(x, y)) / 255.0f;
+
+        blur_x.compute_root().parallel(y).vectorize(x, 8);
+        blur_y.compute_root().parallel(y).vectorize(x, 8);
+        sharpen.compute_root().parallel(y).vectorize(x, 8);
+        output.parallel(y).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(SplitCodegen, split_codegen)
+HALIDE_REGISTER_GENERATOR_ALIAS(split_codegen_unsplit, split_codegen, {{"codegen_threads", "1"}})
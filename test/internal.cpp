@@ -9,7 +9,9 @@
 #include "Func.h"
 #include "Generator.h"
 #include "IR.h"
+#include "IRArena.h"
 #include "IREquality.h"
+#include "IRIntern.h"
 #include "IRMatch.h"
 #include "IRPrinter.h"
 #include "Interval.h"
@@ -27,6 +29,8 @@ int main(int argc, const char **argv) {
     CodeGen_C::test();
     CodeGen_PyTorch::test();
     ir_equality_test();
+    ir_intern_test();
+    ir_arena_test();
     bounds_test();
     expr_match_test();
     deinterleave_vector_test();
@@ -0,0 +1,112 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compare Runtime::Buffer::copy_from and fill against the
+// element-at-a-time loops they used to be, for a few common layouts.
+
+int num_threads() {
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+int thread_par_for(void *user_context, halide_task_t f, int min, int extent, uint8_t *closure) {
+    std::vector<std::thread> threads;
+    const int n = num_threads();
+    for (int t = 0; t < n; t++) {
+        threads.emplace_back([=]() {
+            for (int i = min + t; i < min + extent; i += n) {
+                f(user_context, i, closure);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    return 0;
+}
+
+template<typename T>
+void reference_copy(Runtime::Buffer<T> &dst, const Runtime::Buffer<T> &src) {
+    Runtime::Buffer<T> d = dst, s = src;
+    for (int i = 0; i < d.dimensions(); i++) {
+        d.crop(i, s.dim(i).min(), s.dim(i).extent());
+    }
+    d.for_each_value([](T &a, T b) { a = b; }, s);
+}
+
+bool check_copy(const char *name, Runtime::Buffer<uint8_t> dst, Runtime::Buffer<uint8_t> src) {
+    double t_old = benchmark([&]() { reference_copy(dst, src); });
+    Runtime::BufferParallelFor::set(nullptr);
+    double t_new = benchmark([&]() { dst.copy_from(src); });
+    Runtime::BufferParallelFor::set(thread_par_for);
+    double t_par = benchmark([&]() { dst.copy_from(src); });
+    Runtime::BufferParallelFor::set(nullptr);
+
+    printf("%-24s element-wise: %8.3f ms  copy_from: %8.3f ms  parallel copy_from: %8.3f ms\n",
+           name, t_old * 1e3, t_new * 1e3, t_par * 1e3);
+
+    bool ok = true;
+    src.for_each_element([&](const int *pos) {
+        ok = ok && dst(pos) == src(pos);
+    });
+    if (!ok) {
+        printf("%s: copy_from gave the wrong answer\n", name);
+        return false;
+    }
+    if (t_new > t_old * 1.5) {
+        printf("WARNING: %s: copy_from is slower than an element-wise copy\n", name);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    const int W = 1920, H = 1080, C = 3;
+
+    Runtime::Buffer<uint8_t> planar(W, H, C), interleaved = Runtime::Buffer<uint8_t>::make_interleaved(W, H, C);
+    planar.fill([](int x, int y, int c) { return (uint8_t)(x + y * 3 + c * 7); });
+    interleaved.fill([](int x, int y, int c) { return (uint8_t)(x * 5 + y + c); });
+
+    Runtime::Buffer<uint8_t> planar_out(W, H, C);
+    Runtime::Buffer<uint8_t> interleaved_out = Runtime::Buffer<uint8_t>::make_interleaved(W, H, C);
+
+    // A crop is dense along rows but not overall.
+    Runtime::Buffer<uint8_t> cropped = planar.cropped(0, 16, W - 32);
+
+    if (!check_copy("dense", planar_out, planar) ||
+        !check_copy("cropped rows", planar_out, cropped) ||
+        !check_copy("interleaved to planar", planar_out, interleaved) ||
+        !check_copy("planar to interleaved", interleaved_out, planar)) {
+        return -1;
+    }
+
+    Runtime::Buffer<float> f(W, H, C);
+    double t_old = benchmark([&]() { f.for_each_value([](float &v) { v = 3.0f; }); });
+    double t_new = benchmark([&]() { f.fill(3.0f); });
+    Runtime::BufferParallelFor::set(thread_par_for);
+    double t_par = benchmark([&]() { f.fill(3.0f); });
+    Runtime::BufferParallelFor::set(nullptr);
+    printf("%-24s element-wise: %8.3f ms  fill: %8.3f ms  parallel fill: %8.3f ms\n",
+           "fill", t_old * 1e3, t_new * 1e3, t_par * 1e3);
+    if (!f.all_equal(3.0f)) {
+        printf("fill gave the wrong answer\n");
+        return -1;
+    }
+    if (t_new > t_old * 1.5) {
+        printf("WARNING: fill is slower than an element-wise fill\n");
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compare heap allocations of intermediates with and without the pool
+// of host allocations (halide_reuse_host_allocations).
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    Var x("x"), xo("xo"), xi("xi");
+
+    // A chain of Funcs each heap-allocated per tile of the output, with
+    // the tiles spread over the thread pool.
+    std::vector<Func> chain;
+    Func in;
+    in(x) = x;
+    chain.push_back(in);
+    for (int j = 0; j < 20; j++) {
+        Func next;
+        Expr prev = chain.back()(x);
+        next(x) = select(prev % 2 == 0, prev / 2, 3 * prev + 1);
+        chain.push_back(next);
+    }
+    Func out = chain.back();
+    out.split(x, xo, xi, 4096).parallel(xo).vectorize(xi, 8);
+    for (size_t j = 0; j < chain.size() - 1; j++) {
+        chain[j].compute_at(out, xo).vectorize(x, 8);
+    }
+    Pipeline pipeline(out);
+
+    double times[2];
+    Buffer<int> result[2];
+    for (int reuse = 0; reuse < 2; reuse++) {
+        Internal::JITSharedRuntime::reuse_host_allocations(reuse);
+        pipeline.compile_jit();
+        result[reuse] = Buffer<int>(4 * 1000 * 1000);
+        times[reuse] = benchmark([&]() { pipeline.realize(result[reuse]); });
+        printf("%s pooled host allocations %f ms\n", reuse ? "With" : "Without", times[reuse] * 1e3);
+    }
+    Internal::JITSharedRuntime::reuse_host_allocations(false);
+
+    for (int i = 0; i < result[0].width(); i++) {
+        if (result[0](i) != result[1](i)) {
+            printf("result(%d) = %d instead of %d\n", i, result[1](i), result[0](i));
+            return -1;
+        }
+    }
+
+    if (times[1] > times[0]) {
+        printf("Pooling host allocations was slower!\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
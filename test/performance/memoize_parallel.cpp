@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    Var x, y;
+
+    // Enough room for every row of both pipelines.
+    Internal::JITSharedRuntime::memoization_cache_set_size(64 * 1024 * 1024);
+
+    double times[2];
+
+    for (int use_parallel = 0; use_parallel < 2; use_parallel++) {
+        // Every row of g looks up a memoized row of f. The cache is
+        // sharded, so once it's warm, doing the lookups from several
+        // threads at once should be faster than doing them serially.
+        Func f, g;
+        f(x, y) = sqrt(cast<float>(x * y));
+        g(x, y) = f(x, y) + f(x + 1, y);
+        f.compute_at(g, y).memoize();
+        if (use_parallel) {
+            g.parallel(y);
+        }
+
+        g.compile_jit();
+
+        Buffer<float> out(64, 1024);
+        // Warm up the cache.
+        g.realize(out);
+        double t = benchmark([&]() {
+            g.realize(out);
+        });
+
+        times[use_parallel] = t;
+
+        printf("%s parallel %f\n", use_parallel ? "With" : "Without", t);
+    }
+
+    Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+    if (times[0] < times[1]) {
+        printf("Parallel memoized lookups were slower!\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Run a pipeline over many tiny inputs, first with a loop of realize
+// calls and then with one realize_batch call.
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    const int batch_size = 1024;
+
+    ImageParam in(Float(32), 2);
+    Var x, y;
+    Func f;
+    f(x, y) = sqrt(in(x, y) * in(x, y) + 1.0f);
+    f.vectorize(x, 8);
+
+    Pipeline p(f);
+    p.compile_jit();
+
+    std::vector<Buffer<float>> inputs, serial_outputs;
+    std::vector<Realization> batch_outputs;
+    std::vector<ParamMap> param_maps;
+    for (int i = 0; i < batch_size; i++) {
+        Buffer<float> input(16, 4);
+        input.for_each_element([&](int x, int y) { input(x, y) = (float)(x + y + i); });
+        inputs.push_back(input);
+        serial_outputs.emplace_back(16, 4);
+        Buffer<float> out(16, 4);
+        batch_outputs.emplace_back(out);
+        ParamMap pm;
+        pm.set(in, inputs.back());
+        param_maps.push_back(pm);
+    }
+
+    double serial_time = benchmark([&]() {
+        for (int i = 0; i < batch_size; i++) {
+            p.realize(serial_outputs[i], target, param_maps[i]);
+        }
+    });
+
+    double batch_time = benchmark([&]() {
+        p.realize_batch(batch_outputs, param_maps, target);
+    });
+
+    for (int i = 0; i < batch_size; i++) {
+        Buffer<float> batch_out = batch_outputs[i][0];
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 16; x++) {
+                if (batch_out(x, y) != serial_outputs[i](x, y)) {
+                    printf("batch_out[%d](%d, %d) = %f instead of %f\n",
+                           i, x, y, batch_out(x, y), serial_outputs[i](x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Loop of %d realize calls: %f ms\n", batch_size, serial_time * 1e3);
+    printf("One realize_batch call:   %f ms\n", batch_time * 1e3);
+
+    if (batch_time > serial_time) {
+        fprintf(stderr, "WARNING: realize_batch should not be slower than a loop of realize calls\n");
+        return 0;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -135,6 +135,34 @@ int main(int argc, char **argv) {
         std::cout << "One argument Pipeline realize reusing Realization/Target/ParamMap time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        f() = 42;
+
+        Pipeline p(f);
+        auto buf = Buffer<int32_t>::make_scalar();
+        Pipeline::PreparedRealization prepared = p.prepare_realize(buf);
+
+        double t = benchmark([&]() { prepared.realize(); });
+        std::cout << "No argument PreparedRealization realize time " << t * 1e6 << "us.\n";
+    }
+
+    {
+        Func f;
+        Param<int> in;
+
+        f() = in + 42;
+
+        in.set(0);
+
+        Pipeline p(f);
+        auto buf = Buffer<int32_t>::make_scalar();
+        Pipeline::PreparedRealization prepared = p.prepare_realize(buf);
+
+        double t = benchmark([&]() { prepared.realize(); });
+        std::cout << "One argument PreparedRealization realize time " << t * 1e6 << "us.\n";
+    }
+
     for (int i = 10; i < 100; i += 10) {
         Func f;
         std::vector<Param<int>> params(i);
@@ -151,6 +179,10 @@ int main(int argc, char **argv) {
         auto buf = Buffer<int32_t>::make_scalar();
         double t = benchmark([&]() { f.realize(buf); });
         std::cout << std::to_string(i) << "-argument Func realize to Buffer time " << t * 1e6 << "us.\n";
+
+        Pipeline::PreparedRealization prepared = Pipeline(f).prepare_realize(buf);
+        t = benchmark([&]() { prepared.realize(); });
+        std::cout << std::to_string(i) << "-argument PreparedRealization realize time " << t * 1e6 << "us.\n";
     }
 
     std::cout << "Success!\n";
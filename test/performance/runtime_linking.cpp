@@ -0,0 +1,59 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compile the same small pipeline to bitcode over and over, first
+// linking the runtime from scratch each time, and then reusing the
+// cached pre-linked runtime.
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    ImageParam in(Float(32), 2);
+    Var x, y;
+    Func f;
+    f(x, y) = in(x, y) * 2.0f + 1.0f;
+    f.vectorize(x, 8).parallel(y);
+
+    // Lower once, so that only code generation and runtime linking are
+    // timed. Use the AOT target, which links in the whole runtime.
+    Target aot_target = target.without_feature(Target::JIT);
+    Module m = f.compile_to_module({in}, "runtime_linking", aot_target);
+    std::string path = Internal::get_test_tmp_dir() + "halide_test_performance_runtime_linking.bc";
+
+    auto compile = [&]() {
+        m.compile({{Output::bitcode, path}});
+    };
+
+    double times[2];
+    for (int use_cache = 0; use_cache < 2; use_cache++) {
+        static char buf[64];
+        snprintf(buf, sizeof(buf), "HL_RUNTIME_MODULE_CACHE=%d", use_cache);
+        putenv(buf);
+        // Populate the cache, if there is one.
+        compile();
+        times[use_cache] = benchmark(5, 1, compile);
+        printf("%s the cached runtime: %f ms per compilation\n",
+               use_cache ? "With" : "Without", times[use_cache] * 1e3);
+    }
+
+    Internal::assert_file_exists(path);
+
+    if (times[1] > times[0]) {
+        printf("Caching the runtime was slower!\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -109,6 +109,35 @@ void same_func_per_thread() {
     }
 }
 
+// Let the threads race to compile a shared Pipeline. Only the first
+// one compiles it; the rest wait for it and then share the code.
+void shared_pipeline_per_thread() {
+    std::thread threads[16];
+    test_func test;
+    Pipeline p(test.f);
+
+    for (auto &thread : threads) {
+        int index = (int)(&thread - threads);
+        thread = std::thread([&p, &test, index]() {
+            for (int i = 0; i < 10; i++) {
+                Buffer<int32_t> result = p.realize({10}, get_jit_target_from_environment(),
+                                                   {{test.p, index},
+                                                    {test.in, bufs[index]}});
+                for (int j = 0; j < 10; j++) {
+                    int64_t left = ((j - 1) * (int64_t)bufs[index](std::min(std::max(0, j - 1), 9)) + index * 75);
+                    int64_t middle = (j * (int64_t)bufs[index](std::min(std::max(0, j), 9)) + index * 75);
+                    int64_t right = ((j + 1) * (int64_t)bufs[index](std::min(std::max(0, j + 1), 9)) + index * 75);
+                    assert(result(j) == (int32_t)(left + middle + right));
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
 int main(int argc, char **argv) {
     Target target = get_jit_target_from_environment();
     if (target.arch == Target::WebAssembly) {
@@ -129,7 +158,11 @@ int main(int argc, char **argv) {
     double same_time = benchmark(same_func_per_thread);
     printf("One compilation time: %fs.\n", same_time);
 
+    double shared_time = benchmark(shared_pipeline_per_thread);
+    printf("One compilation under contention time: %fs.\n", shared_time);
+
     assert(same_time < separate_time);
+    assert(shared_time < separate_time);
 
     printf("Success!\n");
     return 0;
@@ -0,0 +1,93 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    Var x, y;
+
+    // One parallel loop where the cost of a row grows with y. Idle
+    // threads should steal the expensive rows.
+    Func unbalanced;
+    RDom r(0, 1024);
+    unbalanced(x, y) = 0.0f;
+    unbalanced(x, y) += select(r < y * 4, sin(cast<float>(x + r)), 0.0f);
+    unbalanced.parallel(y);
+    Pipeline unbalanced_pipeline(unbalanced);
+
+    // Lots of cheap parallel loops in a row. Work stealing shouldn't
+    // add much overhead to these.
+    Func small[8];
+    small[0](x, y) = x + y;
+    for (int i = 1; i < 8; i++) {
+        small[i](x, y) = small[i - 1](x, y) * 3 + small[i - 1](x + 1, y);
+    }
+    for (int i = 0; i < 8; i++) {
+        small[i].compute_root().parallel(y);
+    }
+    Pipeline small_pipeline(small[7]);
+
+    double unbalanced_times[2], small_times[2];
+    Buffer<float> unbalanced_out[2];
+    Buffer<int> small_out[2];
+
+    for (int stealing = 0; stealing < 2; stealing++) {
+        // The thread pool reads this when it starts up.
+        static char buf[64];
+        snprintf(buf, sizeof(buf), "HL_THREAD_POOL_WORK_STEALING=%d", stealing);
+        putenv(buf);
+        unbalanced_pipeline.invalidate_cache();
+        small_pipeline.invalidate_cache();
+        Halide::Internal::JITSharedRuntime::release_all();
+
+        unbalanced_out[stealing] = Buffer<float>(64, 256);
+        small_out[stealing] = Buffer<int>(64, 64);
+        unbalanced_times[stealing] = benchmark([&]() { unbalanced_pipeline.realize(unbalanced_out[stealing]); });
+        small_times[stealing] = benchmark([&]() { small_pipeline.realize(small_out[stealing]); });
+
+        printf("%s work stealing: unbalanced loop %f ms, small loops %f ms\n",
+               stealing ? "With" : "Without", unbalanced_times[stealing] * 1e3, small_times[stealing] * 1e3);
+    }
+
+    // Both modes should compute exactly the same thing.
+    for (int y = 0; y < unbalanced_out[0].height(); y++) {
+        for (int x = 0; x < unbalanced_out[0].width(); x++) {
+            if (unbalanced_out[0](x, y) != unbalanced_out[1](x, y)) {
+                printf("unbalanced(%d, %d) = %f with work stealing instead of %f\n",
+                       x, y, unbalanced_out[1](x, y), unbalanced_out[0](x, y));
+                return -1;
+            }
+        }
+    }
+    for (int y = 0; y < small_out[0].height(); y++) {
+        for (int x = 0; x < small_out[0].width(); x++) {
+            if (small_out[0](x, y) != small_out[1](x, y)) {
+                printf("small(%d, %d) = %d with work stealing instead of %d\n",
+                       x, y, small_out[1](x, y), small_out[0](x, y));
+                return -1;
+            }
+        }
+    }
+
+    if (unbalanced_times[1] > unbalanced_times[0]) {
+        printf("Work stealing was slower on an unbalanced loop!\n");
+        return -1;
+    }
+
+    if (small_times[1] > small_times[0] * 1.5) {
+        printf("Unacceptable overhead from work stealing on small loops: %f ms vs %f ms\n",
+               small_times[1] * 1e3, small_times[0] * 1e3);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1314,6 +1314,50 @@ public:
         }
     }
 
+    void print_memoization_cache_stats() {
+        halide_memoization_cache_stats stats;
+        if (halide_memoization_cache_get_stats(&stats) != 0) {
+            fail() << "halide_memoization_cache_get_stats() failed";
+        }
+
+        double hit_rate = stats.lookups ? (double)stats.hits / stats.lookups : 0.0;
+        if (!parsable_output) {
+            out() << "Memoization cache: " << stats.lookups << " lookups, "
+                  << stats.hits << " hits, "
+                  << stats.misses << " misses (hit rate " << std::setprecision(3) << (hit_rate * 100.0) << "%), "
+                  << stats.evictions << " evictions.\n"
+                  << "Memoization cache holds " << stats.entries_resident << " entries in "
+                  << stats.bytes_resident << " of " << stats.max_bytes << " bytes.\n";
+            if (stats.persistent_hits || stats.persistent_stores) {
+                out() << "Memoization cache file: " << stats.persistent_hits << " hits, "
+                      << stats.persistent_stores << " stores.\n";
+            }
+            for (int i = 0; i < HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS; i++) {
+                if (stats.key_size_lookups[i] == 0) {
+                    continue;
+                }
+                bool last = i == HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS - 1;
+                out() << "  keys of " << (last ? "more than " : "at most ") << (16 << (last ? i - 1 : i)) << " bytes: "
+                      << stats.key_size_lookups[i] << " lookups, "
+                      << stats.key_size_hits[i] << " hits\n";
+            }
+        } else {
+            out() << md->name << "  MEMOIZATION_LOOKUPS      " << stats.lookups << "\n"
+                  << md->name << "  MEMOIZATION_HITS         " << stats.hits << "\n"
+                  << md->name << "  MEMOIZATION_MISSES       " << stats.misses << "\n"
+                  << md->name << "  MEMOIZATION_EVICTIONS    " << stats.evictions << "\n"
+                  << md->name << "  MEMOIZATION_BYTES        " << stats.bytes_resident << "\n"
+                  << md->name << "  MEMOIZATION_ENTRIES      " << stats.entries_resident << "\n"
+                  << md->name << "  MEMOIZATION_MAX_BYTES    " << stats.max_bytes << "\n"
+                  << md->name << "  MEMOIZATION_FILE_HITS    " << stats.persistent_hits << "\n"
+                  << md->name << "  MEMOIZATION_FILE_STORES  " << stats.persistent_stores << "\n";
+            for (int i = 0; i < HALIDE_MEMOIZATION_CACHE_KEY_SIZE_BUCKETS; i++) {
+                out() << md->name << "  MEMOIZATION_KEY_SIZE_" << i << "   "
+                      << stats.key_size_lookups[i] << " " << stats.key_size_hits[i] << "\n";
+            }
+        }
+    }
+
     struct Output {
         std::string name;
         Buffer<> actual;
@@ -144,6 +144,12 @@ Flags:
         allocation during run; note that this may slow down execution, so
         benchmarks may be inaccurate if you combine --benchmark with this.
 
+    --memoization_stats:
+        After running (or benchmarking) the filter, print the lookup, hit,
+        miss and eviction counts of the memoization cache, how much it
+        holds, and a histogram of lookups and hits by cache key size. Use
+        this to choose a value for halide_memoization_cache_set_size().
+
     --default_input_buffers=VALUE:
         Specify the value for all otherwise-unspecified buffer inputs, in the
         same syntax in use above. If you omit =VALUE, "zero:auto" will be used.
@@ -376,6 +382,7 @@ int main(int argc, char **argv) {
     std::set<std::string> seen_args;
     bool benchmark = false;
     bool track_memory = false;
+    bool memoization_stats = false;
     bool describe = false;
     double benchmark_min_time = BenchmarkConfig().min_time;
     std::string default_input_buffers;
@@ -434,6 +441,13 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &track_memory)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "memoization_stats") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &memoization_stats)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "benchmarks") {
                 benchmarks_flag_value = flag_value;
                 benchmark = true;
@@ -532,6 +546,10 @@ int main(int argc, char **argv) {
                   << " bytes for output of " << r.megapixels_out() << " mpix.\n";
     }
 
+    if (memoization_stats) {
+        r.print_memoization_cache_stats();
+    }
+
     // Save the output(s), if necessary.
     r.save_outputs();
 